@@ -1,12 +1,35 @@
 #version 150 core
 
 in vec3 position;
+in mat4 instanceMVP;  //per instance, proj * view * model
+in int instanceMesh;  //per instance, index into the Meshes block
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 proj;
+//camera and frame constants (FrameBlock in UniformBuffers.h)
+layout(std140) uniform FrameData
+{
+  mat4 view;
+  mat4 proj;
+  vec4 frameLightDir;  //view space
+  float time;
+  bool octNormals;
+};
+
+//packed vertex formats : attribute * scale + bias
+//a meshes[] entry per mesh drawn (MeshBlock in UniformBuffers.h)
+struct MeshData
+{
+  vec4 posScale;
+  vec4 posBias;
+  vec4 uvScaleBias;  //scale in xy, bias in zw
+};
+
+layout(std140) uniform Meshes
+{
+  MeshData meshes[256];  //MAX_DRAW_MESHES
+};
 
 void main()
 {
-  gl_Position = proj * view * model * vec4(position, 1.0);
+  MeshData mesh = meshes[instanceMesh];
+  gl_Position = instanceMVP * vec4(position * mesh.posScale.xyz + mesh.posBias.xyz, 1.0);
 }
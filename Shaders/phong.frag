@@ -3,15 +3,23 @@
 // Lighting
 const vec3 Color = vec3(0.5,0.5,0.5);
 
-// Material parameters
-uniform vec3 ka;
-uniform vec3 kd;
-uniform vec3 ks;
-uniform float s;
+// Material parameters : every material in the scene (MaterialBlock in UniformBuffers.h), picked per instance
+struct MaterialData
+{
+	vec4 ka;
+	vec4 kd;
+	vec4 ks_s;	//specular color, phong exponent in w
+};
+
+layout(std140) uniform Materials
+{
+	MaterialData materials[256];	//MAX_MATERIALS
+};
 
 in vec3 normal;
 in vec3 pos;
 in vec3 lightDir;
+flat in int materialIndex;
 
 out vec4 outColor;
 
@@ -19,6 +27,12 @@ out vec4 outColor;
 
 void main()
 {
+	MaterialData m = materials[materialIndex];
+	vec3 ka = m.ka.xyz;
+	vec3 kd = m.kd.xyz;
+	vec3 ks = m.ks_s.xyz;
+	float s = m.ks_s.w;
+
 	vec3 diffuseC = Color*kd*max(dot(-lightDir, normal), 0);
 	vec3 ambC = Color*ka;
 
@@ -3,22 +3,62 @@
 in vec3 position;
 in vec3 inNormal;
 
+//per instance, worked out once per object on the CPU (InstanceData in RenderQueue.h)
+in mat4 instanceMVP;
+in mat4 instanceModelView;
+in mat3 instanceNormalMatrix;	//inverse transpose of instanceModelView
+in int instanceMaterial;	//index into the Materials block
+in int instanceMesh;	//index into the Meshes block
+
 out vec3 normal;
 out vec3 pos;
 out vec3 lightDir;
+flat out int materialIndex;
+
+//camera and frame constants (FrameBlock in UniformBuffers.h)
+layout(std140) uniform FrameData
+{
+	mat4 view;
+	mat4 proj;
+	vec4 frameLightDir;	//view space
+	float time;
+	bool octNormals;
+};
+
+//packed vertex formats : attribute * scale + bias, octahedral normals in inNormal.xy
+//a meshes[] entry per mesh drawn (MeshBlock in UniformBuffers.h), picked per instance
+struct MeshData
+{
+	vec4 posScale;
+	vec4 posBias;
+	vec4 uvScaleBias;	//scale in xy, bias in zw
+};
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 proj;
+layout(std140) uniform Meshes
+{
+	MeshData meshes[256];	//MAX_DRAW_MESHES
+};
 
-const vec3 inLightDir = normalize(vec3(-1,1,-1));
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+	{
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return n;
+}
 
 void main()
 {
-	gl_Position = proj * view * model * vec4(position, 1.0);
-	vec4 norm4 = transpose(inverse(view*model)) * vec4(inNormal, 0.0);
-	normal = normalize(norm4.xyz);
-	pos = (view * model * vec4(position,1.0)).xyz;
+	MeshData mesh = meshes[instanceMesh];
+	vec3 position3 = position * mesh.posScale.xyz + mesh.posBias.xyz;
+	vec3 normal3 = octNormals ? octDecode(inNormal.xy) : inNormal;
+
+	gl_Position = instanceMVP * vec4(position3, 1.0);
+	normal = normalize(instanceNormalMatrix * normal3);
+	pos = (instanceModelView * vec4(position3, 1.0)).xyz;
 
-	lightDir = (view * vec4(inLightDir,0.0)).xyz; //It's a vector!
+	lightDir = frameLightDir.xyz;
+	materialIndex = instanceMaterial;
 }
\ No newline at end of file
@@ -3,11 +3,18 @@
 // Lighting
 const vec3 Color = vec3(0.5,0.5,0.5);
 
-// Material parameters
-uniform vec3 ka;
-uniform vec3 kd;
-uniform vec3 ks;
-uniform float s;
+// Material parameters : every material in the scene (MaterialBlock in UniformBuffers.h), picked per instance
+struct MaterialData
+{
+	vec4 ka;
+	vec4 kd;
+	vec4 ks_s;	//specular color, phong exponent in w
+};
+
+layout(std140) uniform Materials
+{
+	MaterialData materials[256];	//MAX_MATERIALS
+};
 
 //texture parameters
 uniform sampler2D tex0;
@@ -17,6 +24,7 @@ uniform int texID;
 in vec3 normal;
 in vec3 pos;
 in vec3 lightDir;
+flat in int materialIndex;
 in vec2 texcoord;
 
 out vec4 outColor;
@@ -25,6 +33,12 @@ out vec4 outColor;
 
 void main()
 {
+	MaterialData m = materials[materialIndex];
+	vec3 ka = m.ka.xyz;
+	vec3 kd = m.kd.xyz;
+	vec3 ks = m.ks_s.xyz;
+	float s = m.ks_s.w;
+
 	vec3 color;
 
 	if (texID == -1 || texcoord == vec2(-1,-1)) //no texture
@@ -0,0 +1,545 @@
+//////////////////////////////////
+//Asset loading micro-benchmark
+//--------------------------------
+//times the model, OBJ, texture and shader loaders on the files the
+//project ships plus generated OBJs and models of growing size,
+//cold (nothing cached) and warm
+//////////////////////////////////
+
+#include "glad.h"  //Include order can matter here
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Headless.h"
+#include "Profiler.h"
+#include "ShaderCache.h"
+#include "TextureCache.h"
+#include "Util.h"
+#include "tiny_obj_loader.h"
+
+using namespace std;
+
+/*=============================*/
+// Global Default Parameters
+/*=============================*/
+int runs = 5;							//timed runs per case and mode
+int max_faces = 1000000;	//largest generated input, the others are 1/100 and 1/10 of it
+bool synthetic = true;
+bool keep_synthetic = false;
+string tmp_dir = "build/loadbench";
+string out_file = "";			//JSON results, not written if empty
+
+//what the project ships
+const char* model_files[] = { "models/cube.txt", "models/sphere.txt", "models/teapot.txt", "models/knot.txt" };
+const char* texture_files[] = { "textures/wood.bmp", "textures/grey_stones.bmp", "textures/brick.bmp" };
+const char* shader_files[][2] = { { "Shaders/phong.vert", "Shaders/phong.frag" },
+	{ "Shaders/phongTex.vert", "Shaders/phongTex.frag" }, { "Shaders/flat.vert", "Shaders/flat.frag" } };
+
+/*=============================*/
+// Cases
+/*=============================*/
+//one loader on one input
+struct LoadCase
+{
+	string name;				//loader
+	string input;
+	string unit;				//what items counts
+	vector<string> files;			//sources, MB/s counts their bytes, dropped from the page cache for cold runs
+	function<void()> uncache;	//removes derived caches (.tcache, .pbin) for cold runs
+	function<bool(double& items)> run;
+};
+
+struct LoadResult
+{
+	string name;
+	string input;
+	string mode;
+	string unit;
+	int runs;
+	double median_ms;
+	double min_ms;
+	double mb_per_sec;
+	double items_per_sec;
+	double peak_rss_mb;
+};
+
+/*=============================*/
+// Helper Functions
+/*=============================*/
+bool parseOptions(int argc, char *argv[]);
+double fileSize(const string& path);
+bool fileExists(const string& path);
+void dropPageCache(const string& path);
+void resetPeakRSS();
+double peakRSS();
+void quiet(bool on);
+bool writeSyntheticObj(const string& path, int faces);
+bool writeSyntheticModel(const string& path, int faces);
+void addCases(vector<LoadCase>& cases, bool have_gl);
+bool measure(const LoadCase& c, bool cold, LoadResult& r);
+bool writeResults(const string& path, const vector<LoadResult>& results);
+
+/*==============================================================*/
+//							  MAIN
+/*==============================================================*/
+int main(int argc, char *argv[]) {
+	if (!parseOptions(argc, argv))
+	{
+		printf("\nERROR: Incorrect usage. Expected ./loadbench [--runs N] [--faces N] [--no-synthetic] [--keep] [--tmp DIR] [--out FILE.json]\n");
+		return 1;
+	}
+
+	//shader compiles and texture uploads need a context, nothing else does
+	bool have_gl = headless::initContext();
+	if (!have_gl) printf("No headless GL context, skipping the shader and texture upload cases\n");
+
+	vector<LoadCase> cases;
+	addCases(cases, have_gl);
+
+	printf("%-16s %-38s %-5s %4s %11s %11s %10s %14s %9s\n", "loader", "input", "mode", "runs", "median ms", "min ms",
+		"MB/s", "items/s", "peak MB");
+
+	vector<LoadResult> results;
+	bool ok = true;
+	for (size_t i = 0; i < cases.size(); i++)
+	{
+		for (int cold = 1; cold >= 0; cold--)
+		{
+			LoadResult r;
+			if (!measure(cases[i], cold != 0, r))
+			{
+				printf("%-16s %-38s %-5s FAILED\n", cases[i].name.c_str(), cases[i].input.c_str(), cold ? "cold" : "warm");
+				ok = false;
+				continue;
+			}
+			printf("%-16s %-38s %-5s %4d %11.3f %11.3f %10.1f %10.3g %-3s %9.1f\n", r.name.c_str(), r.input.c_str(),
+				r.mode.c_str(), r.runs, r.median_ms, r.min_ms, r.mb_per_sec, r.items_per_sec, r.unit.c_str(), r.peak_rss_mb);
+			fflush(stdout);
+			results.push_back(r);
+		}
+	}
+
+	if (out_file != "" && !writeResults(out_file, results)) ok = false;
+
+	if (synthetic && !keep_synthetic)
+	{
+		for (size_t i = 0; i < cases.size(); i++)
+		{
+			if (cases[i].input.compare(0, tmp_dir.size(), tmp_dir) == 0) remove(cases[i].input.c_str());
+		}
+	}
+
+	headless::shutdown();
+	return ok ? 0 : 1;
+}//END MAIN
+
+/*--------------------------------------------------------------*/
+// parseOptions : reads the flags into the globals
+/*--------------------------------------------------------------*/
+bool parseOptions(int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		bool has_value = (i + 1 < argc);
+
+		if (arg == "--runs" && has_value) runs = atoi(argv[++i]);
+		else if (arg == "--faces" && has_value) max_faces = atoi(argv[++i]);
+		else if (arg == "--no-synthetic") synthetic = false;
+		else if (arg == "--keep") keep_synthetic = true;
+		else if (arg == "--tmp" && has_value) tmp_dir = argv[++i];
+		else if (arg == "--out" && has_value) out_file = argv[++i];
+		else
+		{
+			printf("\nERROR: Unknown option %s\n", arg.c_str());
+			return false;
+		}
+	}
+	return runs > 0 && max_faces >= 100;
+}
+
+/*--------------------------------------------------------------*/
+// addCases : every loader on every input it takes
+/*--------------------------------------------------------------*/
+void addCases(vector<LoadCase>& cases, bool have_gl)
+{
+	vector<string> models(model_files, model_files + sizeof(model_files) / sizeof(model_files[0]));
+	vector<string> objs;
+
+	//the same triangle counts as both an OBJ and a model file
+	if (synthetic)
+	{
+		string mkdir = "mkdir -p " + tmp_dir;
+		if (system(mkdir.c_str()) != 0) printf("ERROR: Could not create %s\n", tmp_dir.c_str());
+
+		for (int faces = max_faces / 100; faces <= max_faces; faces *= 10)
+		{
+			string obj = tmp_dir + "/grid_" + to_string(faces) + ".obj";
+			string txt = tmp_dir + "/grid_" + to_string(faces) + ".txt";
+			printf("Generating %d face inputs in %s\n", faces, tmp_dir.c_str());
+			if (writeSyntheticObj(obj, faces)) objs.push_back(obj);
+			if (writeSyntheticModel(txt, faces)) models.push_back(txt);
+		}
+	}
+
+	for (size_t i = 0; i < models.size(); i++)
+	{
+		string file = models[i];
+
+		LoadCase c;
+		c.name = "loadModel";
+		c.input = file;
+		c.unit = "vtx";
+		c.files.push_back(file);
+		c.run = [file](double& items) {
+			int num_verts = 0;
+			float* data = util::loadModel(file, num_verts);
+			delete[] data;
+			items = num_verts;
+			return data != nullptr;
+		};
+		cases.push_back(c);
+
+		//the ifstream loader it replaced, for reference
+		c.name = "loadModelStream";
+		c.run = [file](double& items) {
+			int num_verts = 0;
+			float* data = util::loadModelStream(file, num_verts);
+			delete[] data;
+			items = num_verts;
+			return data != nullptr;
+		};
+		cases.push_back(c);
+	}
+
+	for (size_t i = 0; i < objs.size(); i++)
+	{
+		string file = objs[i];
+
+		LoadCase c;
+		c.name = "LoadObj";
+		c.input = file;
+		c.unit = "tri";
+		c.files.push_back(file);
+		c.run = [file](double& items) {
+			tinyobj::attrib_t attrib;
+			vector<tinyobj::shape_t> shapes;
+			vector<tinyobj::material_t> materials;
+			string err;
+			bool ok = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, file.c_str());
+			items = 0;
+			for (size_t s = 0; s < shapes.size(); s++) items += shapes[s].mesh.num_face_vertices.size();
+			return ok;
+		};
+		cases.push_back(c);
+
+		//what the ResourceManager actually calls
+		c.name = "LoadObjParallel";
+		c.run = [file](double& items) {
+			tinyobj::attrib_t attrib;
+			vector<tinyobj::shape_t> shapes;
+			vector<tinyobj::material_t> materials;
+			string err;
+			bool ok = tinyobj::LoadObjParallel(&attrib, &shapes, &materials, &err, file.c_str());
+			items = 0;
+			for (size_t s = 0; s < shapes.size(); s++) items += shapes[s].mesh.num_face_vertices.size();
+			return ok;
+		};
+		cases.push_back(c);
+	}
+
+	for (size_t i = 0; i < sizeof(texture_files) / sizeof(texture_files[0]); i++)
+	{
+		string file = texture_files[i];
+		if (!fileExists(file)) continue;
+
+		LoadCase c;
+		c.name = "DecodeTexture";
+		c.input = file;
+		c.unit = "pix";
+		c.files.push_back(file);
+		c.run = [file](double& items) {
+			SDL_Surface* surface = util::DecodeTexture(file.c_str());
+			if (surface == NULL) return false;
+			items = (double)surface->w * surface->h;
+			SDL_FreeSurface(surface);
+			return true;
+		};
+		cases.push_back(c);
+
+		//cold : decode, mip chain and cache write, warm : the mapped cache
+		if (!have_gl) continue;
+		c.name = "LoadTexture";
+		c.unit = "tex";
+		c.uncache = [file]() { remove(texcache::cachePath(file).c_str()); };
+		c.run = [file](double& items) {
+			GLuint tex = util::LoadTexture(file.c_str());
+			if (tex == (GLuint)-1) return false;
+			glDeleteTextures(1, &tex);
+			glFinish();
+			items = 1;
+			return true;
+		};
+		cases.push_back(c);
+	}
+
+	if (!have_gl) return;
+	for (size_t i = 0; i < sizeof(shader_files) / sizeof(shader_files[0]); i++)
+	{
+		string vert = shader_files[i][0], frag = shader_files[i][1];
+
+		//cold : compile and link, warm : the program binary cache when the driver has one
+		LoadCase c;
+		c.name = "LoadShader";
+		c.input = vert + "|" + frag.substr(frag.rfind('/') + 1);
+		c.unit = "prg";
+		c.files.push_back(vert);
+		c.files.push_back(frag);
+		c.uncache = [vert, frag]() {
+			if (!shadercache::supported()) return;
+			string v = util::ReadShaderFile(vert.c_str()), f = util::ReadShaderFile(frag.c_str());
+			remove(shadercache::cachePath(shadercache::programKey(v.c_str(), f.c_str())).c_str());
+		};
+		c.run = [vert, frag](double& items) {
+			GLuint program = util::LoadShader(vert.c_str(), frag.c_str());
+			if (program == 0 || program == (GLuint)-1) return false;
+			glDeleteProgram(program);
+			items = 1;
+			return true;
+		};
+		cases.push_back(c);
+	}
+}
+
+/*--------------------------------------------------------------*/
+// measure : times runs runs of c, each after dropping every
+//				cache (cold) or after one untimed run (warm)
+/*--------------------------------------------------------------*/
+bool measure(const LoadCase& c, bool cold, LoadResult& r)
+{
+	double bytes = 0;
+	for (size_t i = 0; i < c.files.size(); i++) bytes += fileSize(c.files[i]);
+
+	double items = 0;
+	if (!cold)
+	{
+		quiet(true);
+		bool ok = c.run(items);
+		quiet(false);
+		if (!ok) return false;
+	}
+
+	vector<double> times;
+	double peak = 0;
+	for (int i = 0; i < runs; i++)
+	{
+		quiet(true);
+		if (cold)
+		{
+			if (c.uncache) c.uncache();
+			for (size_t f = 0; f < c.files.size(); f++) dropPageCache(c.files[f]);
+		}
+
+		resetPeakRSS();
+		uint64_t start = profiler::now();
+		bool ok = c.run(items);
+		uint64_t end = profiler::now();
+		quiet(false);
+		if (!ok) return false;
+
+		times.push_back((end - start) / 1e6);
+		peak = max(peak, peakRSS());
+	}
+	sort(times.begin(), times.end());
+
+	r.name = c.name;
+	r.input = c.input;
+	r.mode = cold ? "cold" : "warm";
+	r.unit = c.unit;
+	r.runs = runs;
+	r.median_ms = times[times.size() / 2];
+	r.min_ms = times[0];
+	r.mb_per_sec = bytes / (1024.0 * 1024.0) / (r.median_ms / 1000.0);
+	r.items_per_sec = items / (r.median_ms / 1000.0);
+	r.peak_rss_mb = peak / 1024.0;
+	return true;
+}
+
+/*--------------------------------------------------------------*/
+// writeResults : one case and mode per line, like the scene bench
+/*--------------------------------------------------------------*/
+bool writeResults(const string& path, const vector<LoadResult>& results)
+{
+	FILE* f = fopen(path.c_str(), "w");
+	if (f == nullptr)
+	{
+		printf("ERROR: Could not write %s\n", path.c_str());
+		return false;
+	}
+
+	fprintf(f, "{\n\"runs\":%d,\n\"cases\":[\n", runs);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const LoadResult& r = results[i];
+		fprintf(f, "{\"loader\":\"%s\",\"input\":\"%s\",\"mode\":\"%s\",\"median_ms\":%.4f,\"min_ms\":%.4f,"
+			"\"mb_per_sec\":%.2f,\"items_per_sec\":%.2f,\"unit\":\"%s\",\"peak_rss_mb\":%.1f}%s\n", r.name.c_str(),
+			r.input.c_str(), r.mode.c_str(), r.median_ms, r.min_ms, r.mb_per_sec, r.items_per_sec, r.unit.c_str(),
+			r.peak_rss_mb, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(f, "]\n}\n");
+
+	bool ok = (ferror(f) == 0);
+	fclose(f);
+	if (ok) printf("Wrote %s\n", path.c_str());
+	else printf("ERROR: Could not write %s\n", path.c_str());
+	return ok;
+}
+
+/*--------------------------------------------------------------*/
+// writeSyntheticObj : an n x n grid of quads, split in two
+//				triangles, with positions, texcoords and normals
+/*--------------------------------------------------------------*/
+bool writeSyntheticObj(const string& path, int faces)
+{
+	FILE* f = fopen(path.c_str(), "w");
+	if (f == nullptr) return false;
+
+	int n = max(1, (int)sqrt(faces / 2.0));
+	fprintf(f, "# %d x %d grid, %d triangles\n", n, n, 2 * n * n);
+	for (int y = 0; y <= n; y++)
+	{
+		for (int x = 0; x <= n; x++)
+		{
+			float u = x / (float)n, v = y / (float)n;
+			fprintf(f, "v %f %f %f\n", u, 0.1f * sin(6.2832f * u) * cos(6.2832f * v), v);
+			fprintf(f, "vt %f %f\n", u, v);
+			fprintf(f, "vn 0 1 0\n");
+		}
+	}
+	for (int y = 0; y < n; y++)
+	{
+		for (int x = 0; x < n; x++)
+		{
+			int a = y * (n + 1) + x + 1, b = a + 1, c = a + n + 1, d = c + 1;	//1-based
+			fprintf(f, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, c, c, c, b, b, b);
+			fprintf(f, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", b, b, b, c, c, c, d, d, d);
+		}
+	}
+
+	bool ok = (ferror(f) == 0);
+	fclose(f);
+	return ok;
+}
+
+/*--------------------------------------------------------------*/
+// writeSyntheticModel : the same grid in the models/*.txt layout,
+//				a float count then 8 floats per unindexed vertex
+/*--------------------------------------------------------------*/
+bool writeSyntheticModel(const string& path, int faces)
+{
+	FILE* f = fopen(path.c_str(), "w");
+	if (f == nullptr) return false;
+
+	int n = max(1, (int)sqrt(faces / 2.0));
+	fprintf(f, "%d\n", 2 * n * n * 3 * 8);
+	for (int y = 0; y < n; y++)
+	{
+		for (int x = 0; x < n; x++)
+		{
+			int corners[6][2] = { { x, y }, { x, y + 1 }, { x + 1, y }, { x + 1, y }, { x, y + 1 }, { x + 1, y + 1 } };
+			for (int k = 0; k < 6; k++)
+			{
+				float u = corners[k][0] / (float)n, v = corners[k][1] / (float)n;
+				fprintf(f, "%f\n%f\n%f\n%f\n%f\n0\n1\n0\n", u, 0.1f * sin(6.2832f * u) * cos(6.2832f * v), v, u, v);
+			}
+		}
+	}
+
+	bool ok = (ferror(f) == 0);
+	fclose(f);
+	return ok;
+}
+
+/*--------------------------------------------------------------*/
+// File and process helpers
+/*--------------------------------------------------------------*/
+double fileSize(const string& path)
+{
+	FILE* f = fopen(path.c_str(), "rb");
+	if (f == nullptr) return 0;
+	fseek(f, 0, SEEK_END);
+	double size = (double)ftell(f);
+	fclose(f);
+	return size;
+}
+
+bool fileExists(const string& path)
+{
+	return access(path.c_str(), R_OK) == 0;
+}
+
+//the kernel drops clean pages of a file on request, no root needed
+void dropPageCache(const string& path)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) return;
+#ifdef POSIX_FADV_DONTNEED
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+	close(fd);
+}
+
+//the high water mark starts again from the current RSS (Linux 4.0+)
+void resetPeakRSS()
+{
+	FILE* f = fopen("/proc/self/clear_refs", "w");
+	if (f == nullptr) return;
+	fputs("5", f);
+	fclose(f);
+}
+
+//in KB
+double peakRSS()
+{
+	FILE* f = fopen("/proc/self/status", "r");
+	if (f == nullptr) return 0;
+
+	char line[256];
+	double kb = 0;
+	while (fgets(line, sizeof(line), f))
+	{
+		if (strncmp(line, "VmHWM:", 6) == 0) kb = atof(line + 6);
+	}
+	fclose(f);
+	return kb;
+}
+
+//the loaders print as they go, which would end up in the timings and the table
+void quiet(bool on)
+{
+	static int saved_stdout = -1;
+	fflush(stdout);
+	if (on && saved_stdout < 0)
+	{
+		saved_stdout = dup(STDOUT_FILENO);
+		int null_fd = open("/dev/null", O_WRONLY);
+		dup2(null_fd, STDOUT_FILENO);
+		close(null_fd);
+	}
+	else if (!on && saved_stdout >= 0)
+	{
+		dup2(saved_stdout, STDOUT_FILENO);
+		close(saved_stdout);
+		saved_stdout = -1;
+	}
+}
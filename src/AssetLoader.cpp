@@ -0,0 +1,210 @@
+#include "AssetLoader.h"
+#include "Profiler.h"
+
+#include <chrono>
+#include <cstdio>
+
+/*----------------------------*/
+// CONSTRUCTORS AND DESTRUCTORS
+/*----------------------------*/
+AssetLoader::AssetLoader()
+{
+	start(0);
+}
+
+AssetLoader::AssetLoader(int num_workers)
+{
+	start(num_workers);
+}
+
+AssetLoader::~AssetLoader()
+{
+	{
+		unique_lock<mutex> guard(lock);
+		stopping = true;
+	}
+	work_ready.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+
+	while (!pending.empty())
+	{
+		delete pending.top();
+		pending.pop();
+	}
+	for (size_t i = 0; i < decoded.size(); i++) delete decoded[i];
+}
+
+/*----------------------------*/
+// GETTERS
+/*----------------------------*/
+int AssetLoader::getTotal()
+{
+	unique_lock<mutex> guard(lock);
+	return total;
+}
+
+int AssetLoader::getCompleted()
+{
+	unique_lock<mutex> guard(lock);
+	return completed;
+}
+
+int AssetLoader::getFailed()
+{
+	unique_lock<mutex> guard(lock);
+	return failed;
+}
+
+float AssetLoader::getProgress()
+{
+	unique_lock<mutex> guard(lock);
+	if (total == 0) return 1.0f;
+	return completed / (float)total;
+}
+
+bool AssetLoader::isDone()
+{
+	unique_lock<mutex> guard(lock);
+	return completed == total;
+}
+
+/*----------------------------*/
+// OTHERS
+/*----------------------------*/
+void AssetLoader::queue(string name, int priority, function<bool()> decode, function<bool()> upload)
+{
+	Job* job = new Job();
+	job->name = name;
+	job->priority = priority;
+	job->decode = decode;
+	job->upload = upload;
+	job->decoded = false;
+
+	{
+		unique_lock<mutex> guard(lock);
+		job->seq = next_seq++;
+		total++;
+		pending.push(job);
+	}
+	work_ready.notify_one();
+}
+
+int AssetLoader::pump(double budget_ms)
+{
+	chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+	int finished = 0;
+
+	while (true)
+	{
+		Job* job = nullptr;
+		{
+			unique_lock<mutex> guard(lock);
+			if (decoded.empty()) break;
+			job = decoded.front();
+			decoded.pop_front();
+		}
+
+		finishJob(job);
+		finished++;
+
+		double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+		if (elapsed >= budget_ms) break;
+	}
+
+	return finished;
+}
+
+void AssetLoader::finish()
+{
+	while (true)
+	{
+		Job* job = nullptr;
+		{
+			unique_lock<mutex> guard(lock);
+			job_decoded.wait(guard, [this]() { return !decoded.empty() || completed == total; });
+			if (decoded.empty()) return;
+			job = decoded.front();
+			decoded.pop_front();
+		}
+
+		finishJob(job);
+	}
+}
+
+/*----------------------------*/
+// PRIVATE FUNCTIONS
+/*----------------------------*/
+bool AssetLoader::JobOrder::operator()(const Job* a, const Job* b) const
+{
+	if (a->priority != b->priority) return a->priority < b->priority;
+	return a->seq > b->seq;
+}
+
+void AssetLoader::start(int num_workers)
+{
+	next_seq = 0;
+	total = 0;
+	completed = 0;
+	failed = 0;
+	stopping = false;
+
+	if (num_workers <= 0) num_workers = (int)thread::hardware_concurrency() - 1;
+	if (num_workers <= 0) num_workers = 1;
+
+	for (int i = 0; i < num_workers; i++) workers.push_back(thread(&AssetLoader::workerLoop, this));
+}
+
+void AssetLoader::workerLoop()
+{
+	profiler::setThreadName("loader");
+	while (true)
+	{
+		Job* job = nullptr;
+		{
+			unique_lock<mutex> guard(lock);
+			work_ready.wait(guard, [this]() { return stopping || !pending.empty(); });
+			if (stopping) return;
+			job = pending.top();
+			pending.pop();
+		}
+
+		{
+			PROFILE_ZONE("Decode");
+			job->decoded = job->decode ? job->decode() : true;
+		}
+
+		{
+			unique_lock<mutex> guard(lock);
+			decoded.push_back(job);
+		}
+		job_decoded.notify_all();
+	}
+}
+
+//GL thread : uploads a decoded job and retires it
+bool AssetLoader::finishJob(Job* job)
+{
+	bool ok = job->decoded;
+	if (ok && job->upload)
+	{
+		PROFILE_ZONE("Upload asset");
+		ok = job->upload();
+	}
+
+	int done, count;
+	{
+		unique_lock<mutex> guard(lock);
+		completed++;
+		if (!ok) failed++;
+		done = completed;
+		count = total;
+	}
+	job_decoded.notify_all();
+
+	if (ok) printf("Loaded %s (%d/%d)\n", job->name.c_str(), done, count);
+	else printf("ERROR: Failed to load %s (%d/%d)\n", job->name.c_str(), done, count);
+
+	delete job;
+	return ok;
+}
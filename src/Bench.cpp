@@ -0,0 +1,272 @@
+#include "Bench.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include "Camera.h"
+#include "Profiler.h"
+#include "World.h"
+
+/*----------------------------*/
+// HELPERS
+/*----------------------------*/
+namespace
+{
+	const char* percentile_names[3] = { "p50", "p95", "p99" };
+	const double percentile_values[3] = { 50, 95, 99 };
+
+	//the number after "key": in a results line
+	bool readNumber(const string& line, const char* key, double& value)
+	{
+		size_t at = line.find(string("\"") + key + "\":");
+		if (at == string::npos) return false;
+		value = atof(line.c_str() + at + strlen(key) + 3);
+		return true;
+	}
+
+	//the string after "key": in a results line (no escapes, names are ours)
+	bool readString(const string& line, const char* key, string& value)
+	{
+		size_t at = line.find(string("\"") + key + "\":\"");
+		if (at == string::npos) return false;
+		size_t begin = at + strlen(key) + 4;
+		size_t end = line.find('"', begin);
+		if (end == string::npos) return false;
+		value = line.substr(begin, end - begin);
+		return true;
+	}
+
+	//draws options.frames frames of scene after warming up, timing each
+	BenchResult runScene(BenchScene scene, ResourceManager* resources, AssetLoader* loader, SDL_Window* window,
+		const BenchOptions& options)
+	{
+		//the meshes and textures the last scene kept stay loaded, the rest is loaded again
+		//from the caches. Once this scene is built whatever it doesn't draw is evicted,
+		//which compacts the model buffers around the meshes it does
+		World* world = new World(resources);
+		world->setViewport(options.width, options.height);
+		world->loadModelData();
+		world->setupGraphics();
+		world->initBench(scene, options.count);
+		loader->finish();
+		resources->evictUnused();
+
+		//where main puts it
+		Camera cam;
+		cam.setDir(Vec3D(0, 0, -1));
+		cam.setPos(Vec3D(0, 0, 10));
+		cam.setUp(Vec3D(0, 1, 0));
+		cam.setRight(Vec3D(1, 0, 0));
+		cam.setHA(22.5f);
+
+		const double counter_freq = (double)SDL_GetPerformanceFrequency();
+		vector<double> cpu;
+		for (int i = 0; i < BENCH_WARMUP_FRAMES + options.frames; i++)
+		{
+			Uint64 start = SDL_GetPerformanceCounter();
+			profiler::beginFrame();
+			world->update(1.0f / 120);
+			world->draw(&cam, 1.0f);
+			if (window != NULL) SDL_GL_SwapWindow(window);
+			profiler::endFrame();
+			if (i >= BENCH_WARMUP_FRAMES) cpu.push_back(1000.0 * (SDL_GetPerformanceCounter() - start) / counter_freq);
+		}
+		glFinish();
+		profiler::resolveAll();
+
+		vector<double> gpu;
+		for (int back = 0; back < options.frames; back++)
+		{
+			const ProfileFrame* frame = profiler::getFrame(back);
+			if (frame != nullptr && frame->gpu_resolved) gpu.push_back(frame->gpu_time / 1e6);
+		}
+
+		BenchResult r;
+		r.scene = World::bench_scenes[scene];
+		r.count = options.count;
+		r.frames = options.frames;
+		for (int p = 0; p < 3; p++)
+		{
+			r.cpu[p] = bench::percentile(cpu, percentile_values[p]);
+			r.gpu[p] = gpu.empty() ? -1 : bench::percentile(gpu, percentile_values[p]);
+		}
+		r.draws = world->getRenderStats().draws;
+		r.triangles = world->getRenderStats().triangles;
+
+		delete world;
+		return r;
+	}
+}
+
+/*----------------------------*/
+// RUNNING
+/*----------------------------*/
+bool bench::run(ResourceManager* resources, AssetLoader* loader, SDL_Window* window, const BenchOptions& options)
+{
+	BenchOptions opts = options;
+	if (opts.frames > PROFILER_FRAMES)
+	{
+		//GPU times are read back from the profiler's ring
+		printf("Bench: %d frames is more than the profiler keeps, measuring %d\n", opts.frames, PROFILER_FRAMES);
+		opts.frames = PROFILER_FRAMES;
+	}
+
+	printf("Bench: %d scenes, %d instances, %d frames each, %dx%d %s\n", NUM_BENCH_SCENES, opts.count, opts.frames,
+		opts.width, opts.height, window == NULL ? "headless" : "windowed");
+
+	vector<BenchResult> results;
+	for (int s = 0; s < NUM_BENCH_SCENES; s++)
+	{
+		BenchResult r = runScene((BenchScene)s, resources, loader, window, opts);
+		printf("  %-10s cpu p50 %8.3f p95 %8.3f p99 %8.3f  gpu p50 %8.3f p95 %8.3f p99 %8.3f  draws %d, triangles %d\n",
+			r.scene.c_str(), r.cpu[0], r.cpu[1], r.cpu[2], r.gpu[0], r.gpu[1], r.gpu[2], r.draws, r.triangles);
+		results.push_back(r);
+	}
+	resources->evictUnused();	//the last scene's
+
+	bool ok = true;
+	if (opts.out != "") ok = writeResults(opts.out, results);
+
+	if (opts.baseline != "")
+	{
+		vector<BenchResult> baseline;
+		string renderer;
+		if (!readResults(opts.baseline, baseline, renderer))
+		{
+			printf("Bench: no baseline in %s, nothing to compare against\n", opts.baseline.c_str());
+		}
+		else
+		{
+			if (renderer != (const char*)glGetString(GL_RENDERER))
+				printf("Bench: WARNING baseline is from \"%s\", times may not compare\n", renderer.c_str());
+			if (!compare(results, baseline, opts.threshold)) ok = false;
+		}
+	}
+	return ok;
+}
+
+double bench::percentile(vector<double> values, double p)
+{
+	if (values.empty()) return 0;
+
+	sort(values.begin(), values.end());
+	int rank = (int)ceil(p / 100.0 * values.size());
+	rank = max(1, min(rank, (int)values.size()));
+	return values[rank - 1];
+}
+
+/*----------------------------*/
+// RESULTS FILES
+/*----------------------------*/
+bool bench::writeResults(string filename, const vector<BenchResult>& results)
+{
+	FILE* f = fopen(filename.c_str(), "w");
+	if (f == nullptr)
+	{
+		printf("ERROR: Could not write bench results to %s\n", filename.c_str());
+		return false;
+	}
+
+	fprintf(f, "{\n\"renderer\":\"");
+	for (const char* c = (const char*)glGetString(GL_RENDERER); c != nullptr && *c; c++)
+	{
+		if (*c != '"' && *c != '\\') fputc(*c, f);
+	}
+	fprintf(f, "\",\n\"scenes\":[\n");
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult& r = results[i];
+		fprintf(f, "{\"scene\":\"%s\",\"count\":%d,\"frames\":%d", r.scene.c_str(), r.count, r.frames);
+		for (int p = 0; p < 3; p++) fprintf(f, ",\"cpu_%s\":%.4f", percentile_names[p], r.cpu[p]);
+		for (int p = 0; p < 3; p++) fprintf(f, ",\"gpu_%s\":%.4f", percentile_names[p], r.gpu[p]);
+		fprintf(f, ",\"draws\":%d,\"triangles\":%d}%s\n", r.draws, r.triangles, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(f, "]\n}\n");
+
+	bool ok = (ferror(f) == 0);
+	fclose(f);
+	if (ok) printf("Bench: wrote %s\n", filename.c_str());
+	else printf("ERROR: Could not write bench results to %s\n", filename.c_str());
+	return ok;
+}
+
+//only reads what writeResults writes : one scene per line
+bool bench::readResults(string filename, vector<BenchResult>& results, string& renderer)
+{
+	ifstream file(filename.c_str());
+	if (!file) return false;
+
+	results.clear();
+	string line;
+	while (getline(file, line))
+	{
+		readString(line, "renderer", renderer);
+
+		BenchResult r;
+		if (!readString(line, "scene", r.scene)) continue;
+
+		double v = 0;
+		if (readNumber(line, "count", v)) r.count = (int)v;
+		if (readNumber(line, "frames", v)) r.frames = (int)v;
+		for (int p = 0; p < 3; p++)
+		{
+			readNumber(line, (string("cpu_") + percentile_names[p]).c_str(), r.cpu[p]);
+			readNumber(line, (string("gpu_") + percentile_names[p]).c_str(), r.gpu[p]);
+		}
+		if (readNumber(line, "draws", v)) r.draws = (int)v;
+		if (readNumber(line, "triangles", v)) r.triangles = (int)v;
+		results.push_back(r);
+	}
+	return !results.empty();
+}
+
+bool bench::compare(const vector<BenchResult>& results, const vector<BenchResult>& baseline, double threshold)
+{
+	printf("Bench: against baseline (regression over %.1f%%)\n", threshold);
+
+	int regressions = 0;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult& r = results[i];
+		const BenchResult* b = nullptr;
+		for (size_t j = 0; j < baseline.size(); j++)
+		{
+			if (baseline[j].scene == r.scene && baseline[j].count == r.count) b = &baseline[j];
+		}
+		if (b == nullptr)
+		{
+			printf("  %-10s not in baseline\n", r.scene.c_str());
+			continue;
+		}
+
+		//p99 is printed but not gated, a couple of slow frames would flip it
+		const char* names[4] = { "cpu p50", "cpu p95", "gpu p50", "gpu p95" };
+		double now[4] = { r.cpu[0], r.cpu[1], r.gpu[0], r.gpu[1] };
+		double then[4] = { b->cpu[0], b->cpu[1], b->gpu[0], b->gpu[1] };
+		for (int m = 0; m < 4; m++)
+		{
+			if (now[m] < 0 || then[m] <= 0) continue;	//no GPU timers on one side
+
+			double change = 100.0 * (now[m] - then[m]) / then[m];
+			bool regressed = change > threshold;
+			if (regressed) regressions++;
+			printf("  %-10s %s %8.3f -> %8.3f ms (%+6.1f%%)%s\n", r.scene.c_str(), names[m], then[m], now[m], change,
+				regressed ? "  REGRESSION" : "");
+		}
+
+		if (r.draws != b->draws || r.triangles != b->triangles)
+		{
+			printf("  %-10s draws %d -> %d, triangles %d -> %d\n", r.scene.c_str(), b->draws, r.draws,
+				b->triangles, r.triangles);
+		}
+	}
+
+	if (regressions > 0) printf("Bench: %d regressions\n", regressions);
+	else printf("Bench: no regressions\n");
+	return regressions == 0;
+}
@@ -0,0 +1,187 @@
+#include "Frustum.h"
+
+#include <cmath>
+#include <cstdio>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+
+/*----------------------------*/
+// CULL STATS
+/*----------------------------*/
+void CullStats::print() const
+{
+	printf("Culled: %d of %d objects (%d visible)%s\n", culled, tested, visible, frozen ? ", frustum frozen" : "");
+}
+
+/*----------------------------*/
+// FRUSTUM
+/*----------------------------*/
+Frustum::Frustum()
+{
+	//0x + 0y + 0z + 1 > 0 everywhere
+	for (int i = 0; i < NUM_FRUSTUM_PLANES; i++) planes[i] = glm::vec4(0, 0, 0, 1);
+}
+
+void Frustum::setFromMatrix(const glm::mat4& view_proj)
+{
+	//glm is column major, m[c][r]
+	const glm::mat4& m = view_proj;
+	glm::vec4 row[4];
+	for (int r = 0; r < 4; r++) row[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+
+	//-w <= x, y, z <= w in clip space
+	planes[FRUSTUM_LEFT] = row[3] + row[0];
+	planes[FRUSTUM_RIGHT] = row[3] - row[0];
+	planes[FRUSTUM_BOTTOM] = row[3] + row[1];
+	planes[FRUSTUM_TOP] = row[3] - row[1];
+	planes[FRUSTUM_NEAR] = row[3] + row[2];
+	planes[FRUSTUM_FAR] = row[3] - row[2];
+
+	//unit normals, so plane distances compare against radii
+	for (int i = 0; i < NUM_FRUSTUM_PLANES; i++)
+	{
+		float len = glm::length(glm::vec3(planes[i]));
+		if (len > 0) planes[i] /= len;
+	}
+}
+
+glm::vec4 Frustum::getPlane(FrustumPlane p) const
+{
+	return planes[p];
+}
+
+bool Frustum::testSphere(const glm::vec3& center, float radius) const
+{
+	for (int i = 0; i < NUM_FRUSTUM_PLANES; i++)
+	{
+		if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius) return false;
+	}
+	return true;
+}
+
+bool Frustum::testBox(const glm::vec3& center, const glm::vec3& extents) const
+{
+	for (int i = 0; i < NUM_FRUSTUM_PLANES; i++)
+	{
+		glm::vec3 n = glm::vec3(planes[i]);
+
+		//the box's reach towards the plane normal
+		float r = glm::dot(glm::abs(n), extents);
+		if (glm::dot(n, center) + planes[i].w < -r) return false;
+	}
+	return true;
+}
+
+FrustumTest Frustum::classifyBox(const glm::vec3& center, const glm::vec3& extents, int& plane_mask) const
+{
+	for (int i = 0; i < NUM_FRUSTUM_PLANES; i++)
+	{
+		if (!(plane_mask & (1 << i))) continue;
+
+		glm::vec3 n = glm::vec3(planes[i]);
+		float r = glm::dot(glm::abs(n), extents);
+		float d = glm::dot(n, center) + planes[i].w;
+
+		if (d < -r) return FRUSTUM_OUTSIDE;
+		if (d >= r) plane_mask &= ~(1 << i);	//every corner inside this one
+	}
+	return plane_mask == 0 ? FRUSTUM_INSIDE : FRUSTUM_INTERSECTS;
+}
+
+/*----------------------------*/
+// FRUSTUM CULLER
+/*----------------------------*/
+int FrustumCuller::getCount()
+{
+	return count;
+}
+
+void FrustumCuller::clear()
+{
+	cx.clear(); cy.clear(); cz.clear();
+	ex.clear(); ey.clear(); ez.clear();
+	radius.clear();
+	count = 0;
+}
+
+int FrustumCuller::add(const glm::vec3& center, const glm::vec3& extents, float r)
+{
+	cx.push_back(center.x); cy.push_back(center.y); cz.push_back(center.z);
+	ex.push_back(extents.x); ey.push_back(extents.y); ez.push_back(extents.z);
+	radius.push_back(r);
+	return count++;
+}
+
+void FrustumCuller::cull(const Frustum& frustum, vector<uint8_t>& visible, CullStats& stats)
+{
+	visible.assign(count, 1);
+	int first = 0;
+
+#ifdef FRUSTUM_SSE
+	//every plane coefficient splatted across the four lanes
+	__m128 px[NUM_FRUSTUM_PLANES], py[NUM_FRUSTUM_PLANES], pz[NUM_FRUSTUM_PLANES], pw[NUM_FRUSTUM_PLANES];
+	__m128 ax[NUM_FRUSTUM_PLANES], ay[NUM_FRUSTUM_PLANES], az[NUM_FRUSTUM_PLANES];
+	for (int p = 0; p < NUM_FRUSTUM_PLANES; p++)
+	{
+		glm::vec4 plane = frustum.getPlane((FrustumPlane)p);
+		px[p] = _mm_set1_ps(plane.x);
+		py[p] = _mm_set1_ps(plane.y);
+		pz[p] = _mm_set1_ps(plane.z);
+		pw[p] = _mm_set1_ps(plane.w);
+		ax[p] = _mm_set1_ps(fabs(plane.x));
+		ay[p] = _mm_set1_ps(fabs(plane.y));
+		az[p] = _mm_set1_ps(fabs(plane.z));
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	for (; first + 4 <= count; first += 4)
+	{
+		__m128 x = _mm_loadu_ps(&cx[first]);
+		__m128 y = _mm_loadu_ps(&cy[first]);
+		__m128 z = _mm_loadu_ps(&cz[first]);
+		__m128 hx = _mm_loadu_ps(&ex[first]);
+		__m128 hy = _mm_loadu_ps(&ey[first]);
+		__m128 hz = _mm_loadu_ps(&ez[first]);
+		__m128 neg_r = _mm_sub_ps(zero, _mm_loadu_ps(&radius[first]));
+
+		__m128 outside = zero;
+		for (int p = 0; p < NUM_FRUSTUM_PLANES; p++)
+		{
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], x), _mm_mul_ps(py[p], y)),
+				_mm_add_ps(_mm_mul_ps(pz[p], z), pw[p]));
+			__m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], hx), _mm_mul_ps(ay[p], hy)), _mm_mul_ps(az[p], hz));
+
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(d, neg_r));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, reach), zero));
+		}
+
+		//one bit per lane
+		int mask = _mm_movemask_ps(outside);
+		for (int i = 0; i < 4; i++) visible[first + i] = (mask & (1 << i)) ? 0 : 1;
+	}
+#endif
+
+	//the last few (or all, without SSE)
+	cullScalar(frustum, first, visible);
+
+	stats.tested = count;
+	stats.visible = 0;
+	for (int i = 0; i < count; i++) stats.visible += visible[i];
+	stats.culled = count - stats.visible;
+}
+
+/*----------------------------*/
+// PRIVATE FUNCTIONS
+/*----------------------------*/
+void FrustumCuller::cullScalar(const Frustum& frustum, int first, vector<uint8_t>& visible)
+{
+	for (int i = first; i < count; i++)
+	{
+		glm::vec3 center(cx[i], cy[i], cz[i]);
+		glm::vec3 extents(ex[i], ey[i], ez[i]);
+		visible[i] = (frustum.testSphere(center, radius[i]) && frustum.testBox(center, extents)) ? 1 : 0;
+	}
+}
@@ -0,0 +1,261 @@
+#include "Headless.h"
+
+#define EGL_NO_X11	//no display server, so no X11 types in the EGL headers
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <dlfcn.h>
+
+#include <cstdio>
+#include <vector>
+
+/*----------------------------*/
+// STATE
+/*----------------------------*/
+namespace
+{
+	void* egl_lib = nullptr;
+	PFNEGLGETPROCADDRESSPROC getProcAddress = nullptr;
+
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLContext context = EGL_NO_CONTEXT;
+	EGLSurface surface = EGL_NO_SURFACE;
+
+	GLuint fbo = 0;
+	GLuint color_rb = 0;
+	GLuint depth_rb = 0;
+	int target_width = 0;
+	int target_height = 0;
+
+	//core functions aren't always returned by eglGetProcAddress (EGL_KHR_get_all_proc_addresses),
+	//the linked libGL has them
+	void* loadGL(const char* name)
+	{
+		void* f = (void*)getProcAddress(name);
+		if (f == nullptr) f = dlsym(RTLD_DEFAULT, name);
+		return f;
+	}
+
+	template <typename T>
+	bool loadEGL(T& f, const char* name)
+	{
+		f = (T)dlsym(egl_lib, name);
+		if (f == nullptr) printf("ERROR: libEGL has no %s\n", name);
+		return f != nullptr;
+	}
+
+	bool hasExtension(const char* extensions, const char* name)
+	{
+		if (extensions == nullptr) return false;
+		string list = string(" ") + extensions + " ";
+		return list.find(string(" ") + name + " ") != string::npos;
+	}
+}
+
+/*----------------------------*/
+// CONTEXT
+/*----------------------------*/
+bool headless::initContext()
+{
+	egl_lib = dlopen("libEGL.so.1", RTLD_NOW | RTLD_GLOBAL);
+	if (egl_lib == nullptr) egl_lib = dlopen("libEGL.so", RTLD_NOW | RTLD_GLOBAL);
+	if (egl_lib == nullptr)
+	{
+		printf("ERROR: Headless rendering needs libEGL (%s)\n", dlerror());
+		return false;
+	}
+
+	PFNEGLQUERYSTRINGPROC queryString;
+	PFNEGLGETDISPLAYPROC getDisplay;
+	PFNEGLINITIALIZEPROC initialize;
+	PFNEGLBINDAPIPROC bindAPI;
+	PFNEGLCHOOSECONFIGPROC chooseConfig;
+	PFNEGLCREATECONTEXTPROC createContext;
+	PFNEGLCREATEPBUFFERSURFACEPROC createPbufferSurface;
+	PFNEGLMAKECURRENTPROC makeCurrent;
+	PFNEGLGETERRORPROC getError;
+	if (!loadEGL(getProcAddress, "eglGetProcAddress") || !loadEGL(queryString, "eglQueryString")
+		|| !loadEGL(getDisplay, "eglGetDisplay") || !loadEGL(initialize, "eglInitialize")
+		|| !loadEGL(bindAPI, "eglBindAPI") || !loadEGL(chooseConfig, "eglChooseConfig")
+		|| !loadEGL(createContext, "eglCreateContext") || !loadEGL(createPbufferSurface, "eglCreatePbufferSurface")
+		|| !loadEGL(makeCurrent, "eglMakeCurrent") || !loadEGL(getError, "eglGetError"))
+	{
+		return false;
+	}
+
+	//Mesa's surfaceless platform needs no display server or GPU device at all
+	const char* client_extensions = queryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)getProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay != nullptr && hasExtension(client_extensions, "EGL_MESA_platform_surfaceless"))
+	{
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+	if (display == EGL_NO_DISPLAY) display = getDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !initialize(display, &major, &minor))
+	{
+		printf("ERROR: No EGL display (0x%x)\n", getError());
+		return false;
+	}
+	if (!bindAPI(EGL_OPENGL_API))
+	{
+		printf("ERROR: EGL %d.%d can't create desktop GL contexts\n", major, minor);
+		return false;
+	}
+
+	//the framebuffer is ours, the config only has to allow a pbuffer if surfaceless isn't there
+	const EGLint config_attribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint num_configs = 0;
+	if (!chooseConfig(display, config_attribs, &config, 1, &num_configs) || num_configs == 0)
+	{
+		printf("ERROR: No EGL config for desktop GL (0x%x)\n", getError());
+		return false;
+	}
+
+	//same version and profile as util::initSDL asks SDL for
+	const EGLint context_attribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 2,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	context = createContext(display, config, EGL_NO_CONTEXT, context_attribs);
+	if (context == EGL_NO_CONTEXT)
+	{
+		printf("ERROR: Failed to create a GL 3.2 core context (0x%x)\n", getError());
+		return false;
+	}
+
+	if (!hasExtension(queryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context"))
+	{
+		const EGLint pbuffer_attribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		surface = createPbufferSurface(display, config, pbuffer_attribs);
+		if (surface == EGL_NO_SURFACE)
+		{
+			printf("ERROR: Failed to create a pbuffer (0x%x)\n", getError());
+			return false;
+		}
+	}
+	if (!makeCurrent(display, surface, surface, context))
+	{
+		printf("ERROR: Failed to make the headless context current (0x%x)\n", getError());
+		return false;
+	}
+
+	if (gladLoadGLLoader(loadGL)) {
+		printf("--------------------------------------------------\n");
+		printf("OpenGL loaded (headless, EGL %d.%d%s)\n", major, minor, surface == EGL_NO_SURFACE ? ", surfaceless" : ", pbuffer");
+		printf("Vendor:   %s\n", glGetString(GL_VENDOR));
+		printf("Renderer: %s\n", glGetString(GL_RENDERER));
+		printf("Version:  %s\n", glGetString(GL_VERSION));
+		printf("--------------------------------------------------\n");
+	}
+	else {
+		printf("ERROR: Failed to initialize OpenGL context.\n");
+		return false;
+	}
+
+	return true;
+}
+
+bool headless::createTarget(int width, int height)
+{
+	target_width = width;
+	target_height = height;
+
+	glGenRenderbuffers(1, &color_rb);
+	glBindRenderbuffer(GL_RENDERBUFFER, color_rb);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, &depth_rb);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_rb);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_rb);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_rb);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		printf("ERROR: Offscreen framebuffer %dx%d incomplete (0x%x)\n", width, height, status);
+		return false;
+	}
+
+	//left bound, everything draws into it
+	glViewport(0, 0, width, height);
+	return true;
+}
+
+void headless::shutdown()
+{
+	if (fbo != 0)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &fbo);
+		glDeleteRenderbuffers(1, &color_rb);
+		glDeleteRenderbuffers(1, &depth_rb);
+		fbo = color_rb = depth_rb = 0;
+	}
+
+	if (display != EGL_NO_DISPLAY)
+	{
+		PFNEGLMAKECURRENTPROC makeCurrent;
+		PFNEGLDESTROYCONTEXTPROC destroyContext;
+		PFNEGLDESTROYSURFACEPROC destroySurface;
+		PFNEGLTERMINATEPROC terminate;
+		if (loadEGL(makeCurrent, "eglMakeCurrent") && loadEGL(destroyContext, "eglDestroyContext")
+			&& loadEGL(destroySurface, "eglDestroySurface") && loadEGL(terminate, "eglTerminate"))
+		{
+			makeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			if (surface != EGL_NO_SURFACE) destroySurface(display, surface);
+			if (context != EGL_NO_CONTEXT) destroyContext(display, context);
+			terminate(display);
+		}
+		display = EGL_NO_DISPLAY;
+		context = EGL_NO_CONTEXT;
+		surface = EGL_NO_SURFACE;
+	}
+	//libEGL stays loaded, drivers don't always survive being unloaded
+}
+
+/*----------------------------*/
+// READBACK
+/*----------------------------*/
+bool headless::saveImage(string filename)
+{
+	if (fbo == 0) return false;
+
+	int w = target_width, h = target_height;
+	vector<unsigned char> pixels((size_t)w * h * 3);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+	FILE* f = fopen(filename.c_str(), "wb");
+	if (f == nullptr)
+	{
+		printf("ERROR: Could not write %s\n", filename.c_str());
+		return false;
+	}
+
+	//GL's rows go bottom up
+	fprintf(f, "P6\n%d %d\n255\n", w, h);
+	for (int y = h - 1; y >= 0; y--) fwrite(&pixels[(size_t)y * w * 3], 1, (size_t)w * 3, f);
+	bool ok = (ferror(f) == 0);
+	fclose(f);
+
+	if (ok) printf("Wrote %dx%d frame to %s\n", w, h, filename.c_str());
+	else printf("ERROR: Could not write %s\n", filename.c_str());
+	return ok;
+}
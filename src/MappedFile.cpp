@@ -0,0 +1,120 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*----------------------------*/
+// CONSTRUCTORS AND DESTRUCTORS
+/*----------------------------*/
+MappedFile::MappedFile()
+{
+	data = nullptr;
+	size = 0;
+#ifdef _WIN32
+	file_handle = INVALID_HANDLE_VALUE;
+	map_handle = NULL;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+/*----------------------------*/
+// GETTERS
+/*----------------------------*/
+const char* MappedFile::getData()
+{
+	return data;
+}
+
+size_t MappedFile::getSize()
+{
+	return size;
+}
+
+bool MappedFile::isOpen()
+{
+	return data != nullptr;
+}
+
+/*----------------------------*/
+// OTHERS
+/*----------------------------*/
+//maps the whole file read-only, returns false if it can't be mapped
+//(empty files can't be mapped either)
+bool MappedFile::open(const std::string& filename)
+{
+	close();
+
+#ifdef _WIN32
+	file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+														OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file_handle == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+
+	map_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (map_handle == NULL)
+	{
+		close();
+		return false;
+	}
+
+	data = (const char*)MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr)
+	{
+		close();
+		return false;
+	}
+	size = (size_t)file_size.QuadPart;
+#else
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	void* ptr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);	//the mapping keeps its own reference to the file
+
+	if (ptr == MAP_FAILED) return false;
+
+	data = (const char*)ptr;
+	size = (size_t)st.st_size;
+#endif
+
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (data != nullptr) UnmapViewOfFile(data);
+	if (map_handle != NULL) CloseHandle(map_handle);
+	if (file_handle != INVALID_HANDLE_VALUE) CloseHandle(file_handle);
+	map_handle = NULL;
+	file_handle = INVALID_HANDLE_VALUE;
+#else
+	if (data != nullptr) munmap((void*)data, size);
+#endif
+
+	data = nullptr;
+	size = 0;
+}
@@ -0,0 +1,290 @@
+#include "MeshOptimize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+//overdraw sorting is undone if it costs more than this much ACMR
+#define MESHOPT_OVERDRAW_MAX_ACMR 1.05f
+
+//HELPER FUNCTION DECLARATIONS
+static int skipDeadEnd(const vector<int>& live, vector<int>& dead, int& cursor, int num_verts);
+
+/*--------------------------------------------------------------*/
+// analyzeCache : ACMR / ATVR of an index stream on a FIFO cache
+/*--------------------------------------------------------------*/
+meshopt::CacheStats meshopt::analyzeCache(const uint32_t* indices, int num_indices, int num_verts, int cache_size)
+{
+	CacheStats stats;
+	stats.acmr = 0;
+	stats.atvr = 0;
+	if (num_indices < 3 || num_verts == 0) return stats;
+
+	//a vertex is cached while fewer than cache_size misses happened since its own
+	vector<int> stamp(num_verts, -cache_size - 1);
+	vector<char> used(num_verts, 0);
+	int misses = 0;
+	int unique = 0;
+
+	for (int i = 0; i < num_indices; i++)
+	{
+		uint32_t v = indices[i];
+		if (misses - stamp[v] > cache_size)
+		{
+			stamp[v] = misses;
+			misses++;
+		}
+		if (!used[v])
+		{
+			used[v] = 1;
+			unique++;
+		}
+	}
+
+	stats.acmr = misses / (float)(num_indices / 3);
+	stats.atvr = misses / (float)unique;
+	return stats;
+}
+
+/*--------------------------------------------------------------*/
+// optimizeVertexCache : Tipsify triangle reordering
+/*--------------------------------------------------------------*/
+void meshopt::optimizeVertexCache(uint32_t* indices, int num_indices, int num_verts, int cache_size, vector<int>* clusters)
+{
+	if (clusters != nullptr)
+	{
+		clusters->clear();
+		clusters->push_back(0);
+	}
+
+	int num_tris = num_indices / 3;
+	if (num_tris == 0) return;
+
+	//triangles around each vertex, and how many of them are not emitted yet
+	vector<int> live(num_verts, 0);
+	for (int i = 0; i < num_tris * 3; i++) live[indices[i]]++;
+
+	vector<int> offsets(num_verts + 1, 0);
+	for (int v = 0; v < num_verts; v++) offsets[v + 1] = offsets[v] + live[v];
+
+	vector<int> adjacency(num_tris * 3);
+	vector<int> fill(offsets.begin(), offsets.end() - 1);
+	for (int i = 0; i < num_tris * 3; i++) adjacency[fill[indices[i]]++] = i / 3;
+
+	vector<int> stamp(num_verts, 0);	//time each vertex last entered the cache
+	vector<char> emitted(num_tris, 0);
+	vector<int> dead;			//recently touched vertices to fall back on
+	vector<int> candidates;
+	vector<uint32_t> out;
+	out.reserve(num_tris * 3);
+
+	int time = cache_size + 1;
+	int cursor = 0;
+	int fan = skipDeadEnd(live, dead, cursor, num_verts);
+
+	while (fan >= 0)
+	{
+		//emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		for (int j = offsets[fan]; j < offsets[fan + 1]; j++)
+		{
+			int t = adjacency[j];
+			if (emitted[t]) continue;
+
+			for (int c = 0; c < 3; c++)
+			{
+				int v = indices[t * 3 + c];
+				out.push_back(v);
+				dead.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (time - stamp[v] > cache_size)
+				{
+					stamp[v] = time;
+					time++;
+				}
+			}
+			emitted[t] = 1;
+		}
+
+		//next fan : the oldest candidate that will still be cached after its own fan
+		int best = -1;
+		int best_priority = -1;
+		for (size_t c = 0; c < candidates.size(); c++)
+		{
+			int v = candidates[c];
+			if (live[v] <= 0) continue;
+
+			int priority = 0;
+			if (time - stamp[v] + 2 * live[v] <= cache_size) priority = time - stamp[v];
+			if (priority > best_priority)
+			{
+				best_priority = priority;
+				best = v;
+			}
+		}
+
+		if (best == -1)
+		{
+			best = skipDeadEnd(live, dead, cursor, num_verts);
+			if (best >= 0 && clusters != nullptr) clusters->push_back((int)out.size());
+		}
+		fan = best;
+	}
+
+	copy(out.begin(), out.end(), indices);
+}
+
+/*--------------------------------------------------------------*/
+// optimizeOverdraw : sorts clusters outside-in
+/*--------------------------------------------------------------*/
+void meshopt::optimizeOverdraw(uint32_t* indices, int num_indices, const float* verts, const vector<int>& clusters)
+{
+	int num_clusters = (int)clusters.size();
+	if (num_clusters < 2) return;
+
+	//area weighted centroid and normal of every cluster
+	vector<float> sort_key(num_clusters);
+	float mesh_center[3] = { 0, 0, 0 };
+	float mesh_area = 0;
+
+	vector<float> cluster_data(num_clusters * 7, 0.0f);	//centroid * area (3), normal * 2 area (3), area
+	for (int k = 0; k < num_clusters; k++)
+	{
+		int begin = clusters[k];
+		int end = (k + 1 < num_clusters) ? clusters[k + 1] : num_indices;
+		float* d = &cluster_data[k * 7];
+
+		for (int i = begin; i + 2 < end; i += 3)
+		{
+			const float* a = verts + indices[i] * MODEL_VERT_FLOATS;
+			const float* b = verts + indices[i + 1] * MODEL_VERT_FLOATS;
+			const float* c = verts + indices[i + 2] * MODEL_VERT_FLOATS;
+
+			float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float area = 0.5f * sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			for (int j = 0; j < 3; j++)
+			{
+				d[j] += area * (a[j] + b[j] + c[j]) / 3.0f;
+				d[3 + j] += n[j];
+			}
+			d[6] += area;
+		}
+
+		for (int j = 0; j < 3; j++) mesh_center[j] += d[j];
+		mesh_area += d[6];
+	}
+
+	if (mesh_area <= 0) return;
+	for (int j = 0; j < 3; j++) mesh_center[j] /= mesh_area;
+
+	//clusters facing away from the center are likely in front of the others
+	vector<int> order(num_clusters);
+	for (int k = 0; k < num_clusters; k++)
+	{
+		const float* d = &cluster_data[k * 7];
+		float key = 0;
+		if (d[6] > 0)
+		{
+			for (int j = 0; j < 3; j++) key += (d[j] / d[6] - mesh_center[j]) * d[3 + j];
+		}
+		sort_key[k] = key;
+		order[k] = k;
+	}
+
+	stable_sort(order.begin(), order.end(), [&sort_key](int a, int b) { return sort_key[a] > sort_key[b]; });
+
+	vector<uint32_t> sorted;
+	sorted.reserve(num_indices);
+	for (int k = 0; k < num_clusters; k++)
+	{
+		int begin = clusters[order[k]];
+		int end = (order[k] + 1 < num_clusters) ? clusters[order[k] + 1] : num_indices;
+		sorted.insert(sorted.end(), indices + begin, indices + end);
+	}
+
+	copy(sorted.begin(), sorted.end(), indices);
+}
+
+/*--------------------------------------------------------------*/
+// optimizeVertexFetch : renumbers vertices in first use order
+/*--------------------------------------------------------------*/
+void meshopt::optimizeVertexFetch(MeshData& mesh)
+{
+	int num_verts = mesh.numVerts();
+	vector<int> remap(num_verts, -1);
+	vector<float> verts;
+	verts.reserve(mesh.verts.size());
+
+	int next = 0;
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+	{
+		uint32_t v = mesh.indices[i];
+		if (remap[v] == -1)
+		{
+			remap[v] = next++;
+			verts.insert(verts.end(), &mesh.verts[v * MODEL_VERT_FLOATS], &mesh.verts[v * MODEL_VERT_FLOATS] + MODEL_VERT_FLOATS);
+		}
+		mesh.indices[i] = (uint32_t)remap[v];
+	}
+
+	mesh.verts.swap(verts);	//vertices no triangle uses are dropped
+}
+
+/*--------------------------------------------------------------*/
+// optimize : every pass with before / after stats
+/*--------------------------------------------------------------*/
+void meshopt::optimize(MeshData& mesh, const char* name, bool overdraw)
+{
+	if (mesh.numIndices() < 3) return;
+
+	uint32_t* indices = &mesh.indices[0];
+	int num_indices = mesh.numIndices();
+	int num_verts = mesh.numVerts();
+
+	CacheStats before = analyzeCache(indices, num_indices, num_verts);
+
+	vector<int> clusters;
+	optimizeVertexCache(indices, num_indices, num_verts, MESHOPT_CACHE_SIZE, &clusters);
+	CacheStats after = analyzeCache(indices, num_indices, num_verts);
+
+	if (overdraw && clusters.size() > 1)
+	{
+		vector<uint32_t> cache_order(mesh.indices);
+		optimizeOverdraw(indices, num_indices, &mesh.verts[0], clusters);
+
+		CacheStats sorted = analyzeCache(indices, num_indices, num_verts);
+		if (sorted.acmr > after.acmr * MESHOPT_OVERDRAW_MAX_ACMR) mesh.indices.swap(cache_order);
+		else after = sorted;
+	}
+
+	optimizeVertexFetch(mesh);
+
+	printf("Optimized %s : ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%d clusters)\n", name,
+		before.acmr, after.acmr, before.atvr, after.atvr, (int)clusters.size());
+}
+
+/*----------------------------*/
+// HELPER FUNCTIONS
+/*----------------------------*/
+//Tipsify dead end : a recently used vertex with triangles left, else the next one in input order
+static int skipDeadEnd(const vector<int>& live, vector<int>& dead, int& cursor, int num_verts)
+{
+	while (!dead.empty())
+	{
+		int v = dead.back();
+		dead.pop_back();
+		if (live[v] > 0) return v;
+	}
+
+	while (cursor < num_verts)
+	{
+		if (live[cursor] > 0) return cursor;
+		cursor++;
+	}
+
+	return -1;
+}
@@ -0,0 +1,400 @@
+#include "MeshSimplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+#include "MeshOptimize.h"
+
+//collapses turning a triangle's normal further than this (cosine) are refused
+#define MESHSIMPLIFY_MIN_NORMAL_DOT 0.2f
+
+//symmetric 4x4 error quadric, upper triangle : sum of squared distances to a set of planes
+struct Quadric
+{
+	double a[10];
+
+	Quadric() { memset(a, 0, sizeof(a)); }
+	void addPlane(double nx, double ny, double nz, double d);
+	void add(const Quadric& q) { for (int i = 0; i < 10; i++) a[i] += q.a[i]; }
+	double eval(const float* p) const;
+};
+
+//an edge collapse : from moves onto to
+struct Collapse
+{
+	float cost;
+	uint32_t from;
+	uint32_t to;
+
+	bool operator>(const Collapse& c) const { return cost > c.cost; }
+};
+
+//HELPER FUNCTION DECLARATIONS
+static void positionGroups(const float* verts, int num_verts, vector<uint32_t>& group);
+static bool triangleNormal(const float* a, const float* b, const float* c, float* n);
+static float pointTriangleDistance(const float* p, const float* a, const float* b, const float* c);
+
+/*--------------------------------------------------------------*/
+// simplify : greedy cheapest-first half edge collapses
+/*--------------------------------------------------------------*/
+float meshsimplify::simplify(const MeshView& mesh, const uint32_t* indices, int num_indices, int target_indices,
+	vector<uint32_t>& out)
+{
+	int num_verts = mesh.num_verts;
+	int num_tris = num_indices / 3;
+	const float* verts = mesh.verts;
+	out.clear();
+
+	//triangles, rewritten as vertices collapse
+	vector<uint32_t> tris(indices, indices + num_tris * 3);
+	vector<bool> tri_live(num_tris, true);
+	int live_indices = num_tris * 3;
+
+	/////////////////////////////////
+	//LOCKED VERTICES
+	/////////////////////////////////
+	//vertices sharing a position are the two sides of a seam
+	vector<uint32_t> group;
+	positionGroups(verts, num_verts, group);
+
+	vector<int> group_size(num_verts, 0);
+	for (int i = 0; i < num_verts; i++) group_size[group[i]]++;
+
+	vector<bool> locked(num_verts, false);
+	for (int i = 0; i < num_verts; i++) locked[i] = group_size[group[i]] > 1;
+
+	//edges (by position) with only one triangle are on an open border
+	unordered_map<uint64_t, int> edge_use;
+	for (int t = 0; t < num_tris; t++)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			uint64_t a = group[tris[t * 3 + e]], b = group[tris[t * 3 + (e + 1) % 3]];
+			edge_use[a < b ? (a << 32) | b : (b << 32) | a]++;
+		}
+	}
+	for (int t = 0; t < num_tris; t++)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			uint32_t a = tris[t * 3 + e], b = tris[t * 3 + (e + 1) % 3];
+			uint64_t ga = group[a], gb = group[b];
+			if (edge_use[ga < gb ? (ga << 32) | gb : (gb << 32) | ga] == 1) locked[a] = locked[b] = true;
+		}
+	}
+
+	/////////////////////////////////
+	//QUADRICS AND ADJACENCY
+	/////////////////////////////////
+	vector<Quadric> quadric(num_verts);
+	vector<vector<int> > vert_tris(num_verts);
+	for (int t = 0; t < num_tris; t++)
+	{
+		const uint32_t* v = &tris[t * 3];
+		const float* p0 = verts + v[0] * MODEL_VERT_FLOATS;
+		float n[3];
+		if (triangleNormal(p0, verts + v[1] * MODEL_VERT_FLOATS, verts + v[2] * MODEL_VERT_FLOATS, n))
+		{
+			double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+			Quadric q;
+			q.addPlane(n[0], n[1], n[2], d);
+			for (int c = 0; c < 3; c++) quadric[v[c]].add(q);
+		}
+		for (int c = 0; c < 3; c++) vert_tris[v[c]].push_back(t);
+	}
+
+	/////////////////////////////////
+	//COLLAPSES
+	/////////////////////////////////
+	//costs only ever grow (quadrics only gain planes and no vertex moves), so a
+	//stale entry is recosted and pushed back when it comes up
+	priority_queue<Collapse, vector<Collapse>, greater<Collapse> > heap;
+	auto cost = [&](uint32_t from, uint32_t to) {
+		Quadric q = quadric[from];
+		q.add(quadric[to]);
+		return (float)max(q.eval(verts + to * MODEL_VERT_FLOATS), 0.0);
+	};
+	auto pushEdges = [&](int t) {
+		for (int e = 0; e < 3; e++)
+		{
+			uint32_t a = tris[t * 3 + e], b = tris[t * 3 + (e + 1) % 3];
+			if (!locked[a]) heap.push(Collapse{ cost(a, b), a, b });
+			if (!locked[b]) heap.push(Collapse{ cost(b, a), b, a });
+		}
+	};
+	for (int t = 0; t < num_tris; t++) pushEdges(t);
+
+	vector<bool> removed(num_verts, false);
+	vector<uint32_t> collapsed_to(num_verts);
+	for (int i = 0; i < num_verts; i++) collapsed_to[i] = i;
+
+	while (live_indices > target_indices && !heap.empty())
+	{
+		Collapse c = heap.top();
+		heap.pop();
+		if (removed[c.from] || removed[c.to]) continue;
+
+		float now = cost(c.from, c.to);
+		if (now > c.cost)
+		{
+			c.cost = now;
+			heap.push(c);
+			continue;
+		}
+
+		//still an edge, and moving from onto to keeps every other triangle facing
+		//the same way and on the same side of any seam at to
+		bool adjacent = false, valid = true;
+		const float* target = verts + c.to * MODEL_VERT_FLOATS;
+		for (size_t i = 0; i < vert_tris[c.from].size() && valid; i++)
+		{
+			int t = vert_tris[c.from][i];
+			if (!tri_live[t]) continue;
+
+			const uint32_t* v = &tris[t * 3];
+			if (v[0] == c.to || v[1] == c.to || v[2] == c.to)
+			{
+				adjacent = true;
+				continue;
+			}
+
+			const float* p[3];
+			for (int k = 0; k < 3; k++)
+			{
+				if (v[k] != c.from && group[v[k]] == group[c.to]) valid = false;
+				p[k] = verts + v[k] * MODEL_VERT_FLOATS;
+			}
+
+			float before[3], after[3];
+			bool had_area = triangleNormal(p[0], p[1], p[2], before);
+			for (int k = 0; k < 3; k++) if (v[k] == c.from) p[k] = target;
+			if (!triangleNormal(p[0], p[1], p[2], after)) valid = false;
+			else if (had_area && before[0] * after[0] + before[1] * after[1] + before[2] * after[2] < MESHSIMPLIFY_MIN_NORMAL_DOT) valid = false;
+		}
+		if (!adjacent || !valid) continue;
+
+		//triangles on the edge disappear, the rest now use to
+		for (size_t i = 0; i < vert_tris[c.from].size(); i++)
+		{
+			int t = vert_tris[c.from][i];
+			if (!tri_live[t]) continue;
+
+			uint32_t* v = &tris[t * 3];
+			if (v[0] == c.to || v[1] == c.to || v[2] == c.to)
+			{
+				tri_live[t] = false;
+				live_indices -= 3;
+				continue;
+			}
+			for (int k = 0; k < 3; k++) if (v[k] == c.from) v[k] = c.to;
+			vert_tris[c.to].push_back(t);
+		}
+
+		quadric[c.to].add(quadric[c.from]);
+		removed[c.from] = true;
+		collapsed_to[c.from] = c.to;
+		vert_tris[c.from].clear();
+
+		//new edges around to, and dropping the dead triangles from its list
+		vector<int>& around = vert_tris[c.to];
+		around.erase(remove_if(around.begin(), around.end(), [&](int t) { return !tri_live[t]; }), around.end());
+		for (size_t i = 0; i < around.size(); i++) pushEdges(around[i]);
+	}
+
+	out.reserve(live_indices);
+	for (int t = 0; t < num_tris; t++)
+	{
+		if (tri_live[t]) out.insert(out.end(), &tris[t * 3], &tris[t * 3] + 3);
+	}
+
+	/////////////////////////////////
+	//ERROR
+	/////////////////////////////////
+	//the quadrics only order the collapses, their cost sums every plane a vertex
+	//gathered and says little about distance. Each removed vertex is measured against
+	//the triangles left within two edges of the vertex it ended up on instead, which
+	//is never less than its distance to the whole simplified surface
+	for (int i = 0; i < num_verts; i++)
+	{
+		vector<int>& around = vert_tris[i];
+		around.erase(remove_if(around.begin(), around.end(), [&](int t) { return !tri_live[t]; }), around.end());
+	}
+
+	float error = 0.0f;
+	for (int i = 0; i < num_verts; i++)
+	{
+		if (!removed[i]) continue;
+
+		uint32_t to = collapsed_to[i];
+		while (removed[to]) to = collapsed_to[to];
+
+		const float* p = verts + i * MODEL_VERT_FLOATS;
+		const float* q = verts + to * MODEL_VERT_FLOATS;
+		float nearest = sqrt((p[0] - q[0]) * (p[0] - q[0]) + (p[1] - q[1]) * (p[1] - q[1]) + (p[2] - q[2]) * (p[2] - q[2]));
+		for (size_t j = 0; j < vert_tris[to].size(); j++)
+		{
+			const uint32_t* ring = &tris[vert_tris[to][j] * 3];
+			for (int r = 0; r < 3; r++)
+			{
+				for (size_t k = 0; k < vert_tris[ring[r]].size(); k++)
+				{
+					const uint32_t* v = &tris[vert_tris[ring[r]][k] * 3];
+					nearest = min(nearest, pointTriangleDistance(p, verts + v[0] * MODEL_VERT_FLOATS,
+						verts + v[1] * MODEL_VERT_FLOATS, verts + v[2] * MODEL_VERT_FLOATS));
+				}
+			}
+		}
+		error = max(error, nearest);
+	}
+	return error;
+}
+
+/*--------------------------------------------------------------*/
+// generateLODs : a chain of simplified index ranges
+/*--------------------------------------------------------------*/
+void meshsimplify::generateLODs(MeshData& mesh, const char* name)
+{
+	//LOD 0 is the full mesh, any earlier LODs are dropped
+	int base_indices = mesh.lods.empty() ? mesh.numIndices() : (int)mesh.lods[0].num_indices;
+	mesh.lods.clear();
+	mesh.indices.resize(base_indices);
+	if (base_indices < 3) return;
+
+	MeshLOD full;
+	full.first_index = 0;
+	full.num_indices = (uint32_t)base_indices;
+	full.error = 0.0f;
+	mesh.lods.push_back(full);
+
+	//each level simplifies the full mesh, so errors don't pile up from level to level
+	vector<uint32_t> base(mesh.indices);
+	vector<uint32_t> lod;
+	while ((int)mesh.lods.size() < MAX_MESH_LODS)
+	{
+		const MeshLOD& last = mesh.lods.back();
+		int target = ((int)(last.num_indices * MESHSIMPLIFY_LOD_RATIO) / 3) * 3;
+		if (target < MESHSIMPLIFY_MIN_TRIANGLES * 3) break;
+
+		float error = simplify(MeshView(mesh), &base[0], (int)base.size(), target, lod);
+
+		//stuck on locked vertices, another level would look the same
+		if (lod.size() < 3 || lod.size() > last.num_indices * 0.85f) break;
+
+		meshopt::optimizeVertexCache(&lod[0], (int)lod.size(), mesh.numVerts());
+
+		MeshLOD l;
+		l.first_index = (uint32_t)mesh.indices.size();
+		l.num_indices = (uint32_t)lod.size();
+		l.error = max(error, last.error);
+		mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+		mesh.lods.push_back(l);
+	}
+
+	printf("LODs %s :", name);
+	for (size_t i = 0; i < mesh.lods.size(); i++)
+	{
+		printf(" %d", (int)mesh.lods[i].num_indices / 3);
+	}
+	printf(" triangles (largest error %g)\n", mesh.lods.back().error);
+}
+
+/*----------------------------*/
+// QUADRIC
+/*----------------------------*/
+void Quadric::addPlane(double nx, double ny, double nz, double d)
+{
+	a[0] += nx * nx; a[1] += nx * ny; a[2] += nx * nz; a[3] += nx * d;
+	a[4] += ny * ny; a[5] += ny * nz; a[6] += ny * d;
+	a[7] += nz * nz; a[8] += nz * d;
+	a[9] += d * d;
+}
+
+double Quadric::eval(const float* p) const
+{
+	double x = p[0], y = p[1], z = p[2];
+	return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+		+ a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+		+ a[7] * z * z + 2 * a[8] * z
+		+ a[9];
+}
+
+/*----------------------------*/
+// HELPER FUNCTIONS
+/*----------------------------*/
+//group[i] : the first vertex with vertex i's exact position
+static void positionGroups(const float* verts, int num_verts, vector<uint32_t>& group)
+{
+	vector<uint32_t> order(num_verts);
+	for (int i = 0; i < num_verts; i++) order[i] = i;
+
+	auto less = [verts](uint32_t a, uint32_t b) {
+		return memcmp(verts + a * MODEL_VERT_FLOATS, verts + b * MODEL_VERT_FLOATS, 3 * sizeof(float)) < 0;
+	};
+	sort(order.begin(), order.end(), less);
+
+	group.resize(num_verts);
+	for (int i = 0; i < num_verts; i++)
+	{
+		bool same = i > 0 && !less(order[i - 1], order[i]);
+		group[order[i]] = same ? group[order[i - 1]] : order[i];
+	}
+}
+
+//unit normal of abc, false when it has no area
+static bool triangleNormal(const float* a, const float* b, const float* c, float* n)
+{
+	float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+	float len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	if (len <= 1e-20f) return false;
+	n[0] /= len; n[1] /= len; n[2] /= len;
+	return true;
+}
+
+//distance from p to the closest point of triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+static float pointTriangleDistance(const float* p, const float* a, const float* b, const float* c)
+{
+	auto dot = [](const float* u, const float* v) { return u[0] * v[0] + u[1] * v[1] + u[2] * v[2]; };
+	float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	float ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+	float bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+	float cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+
+	float d1 = dot(ab, ap), d2 = dot(ac, ap);
+	float d3 = dot(ab, bp), d4 = dot(ac, bp);
+	float d5 = dot(ab, cp), d6 = dot(ac, cp);
+	float va = d3 * d6 - d5 * d4, vb = d5 * d2 - d1 * d6, vc = d1 * d4 - d3 * d2;
+
+	//closest point as a + v * ab + w * ac
+	float v, w;
+	if (d1 <= 0 && d2 <= 0) { v = 0; w = 0; }
+	else if (d3 >= 0 && d4 <= d3) { v = 1; w = 0; }
+	else if (d6 >= 0 && d5 <= d6) { v = 0; w = 1; }
+	else if (vc <= 0 && d1 >= 0 && d3 <= 0) { v = d1 / (d1 - d3); w = 0; }
+	else if (vb <= 0 && d2 >= 0 && d6 <= 0) { v = 0; w = d2 / (d2 - d6); }
+	else if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+	{
+		w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		v = 1 - w;
+	}
+	else
+	{
+		float denom = 1 / (va + vb + vc);
+		v = vb * denom;
+		w = vc * denom;
+	}
+
+	float x = a[0] + v * ab[0] + w * ac[0] - p[0];
+	float y = a[1] + v * ab[1] + w * ac[1] - p[1];
+	float z = a[2] + v * ab[2] + w * ac[2] - p[2];
+	return sqrt(x * x + y * y + z * z);
+}
@@ -0,0 +1,79 @@
+#include "MeshWeld.h"
+
+#include <cmath>
+#include <cstring>
+
+//HELPER FUNCTION DECLARATIONS
+static void vertexKey(const float* v, float epsilon, int32_t* key);
+static uint32_t hashKey(const int32_t* key);
+
+/*--------------------------------------------------------------*/
+// weld : hashes every vertex tuple into a unique vertex array
+/*--------------------------------------------------------------*/
+void meshweld::weld(const float* soup, int num_verts, float epsilon, MeshData& out)
+{
+	out.verts.clear();
+	out.indices.clear();
+	out.indices.reserve(num_verts);
+
+	//open addressing table of unique vertex ids, at most half full
+	uint32_t table_size = 16;
+	while (table_size < (uint32_t)num_verts * 2) table_size <<= 1;
+	vector<int> table(table_size, -1);
+	vector<int32_t> keys;	//MODEL_VERT_FLOATS per unique vertex
+
+	int32_t key[MODEL_VERT_FLOATS];
+	for (int i = 0; i < num_verts; i++)
+	{
+		const float* v = soup + i * MODEL_VERT_FLOATS;
+		vertexKey(v, epsilon, key);
+
+		uint32_t slot = hashKey(key) & (table_size - 1);
+		while (table[slot] != -1
+			&& memcmp(&keys[table[slot] * MODEL_VERT_FLOATS], key, sizeof(key)) != 0)
+		{
+			slot = (slot + 1) & (table_size - 1);
+		}
+
+		if (table[slot] == -1)
+		{
+			table[slot] = (int)(keys.size() / MODEL_VERT_FLOATS);
+			keys.insert(keys.end(), key, key + MODEL_VERT_FLOATS);
+			out.verts.insert(out.verts.end(), v, v + MODEL_VERT_FLOATS);
+		}
+
+		out.indices.push_back((uint32_t)table[slot]);
+	}
+}
+
+/*----------------------------*/
+// HELPER FUNCTIONS
+/*----------------------------*/
+//comparable integer key of a vertex
+static void vertexKey(const float* v, float epsilon, int32_t* key)
+{
+	for (int c = 0; c < MODEL_VERT_FLOATS; c++)
+	{
+		if (epsilon > 0)
+		{
+			key[c] = (int32_t)floorf(v[c] / epsilon + 0.5f);
+		}
+		else
+		{
+			float f = (v[c] == 0.0f) ? 0.0f : v[c];	//-0 and +0 are the same vertex
+			memcpy(&key[c], &f, sizeof(f));
+		}
+	}
+}
+
+//FNV-1a over the key words
+static uint32_t hashKey(const int32_t* key)
+{
+	uint32_t h = 2166136261u;
+	for (int c = 0; c < MODEL_VERT_FLOATS; c++)
+	{
+		h ^= (uint32_t)key[c];
+		h *= 16777619u;
+	}
+	return h ^ (h >> 16);
+}
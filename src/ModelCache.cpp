@@ -0,0 +1,157 @@
+#include "ModelCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+/*--------------------------------------------------------------*/
+// cachePath : sidecar file name for a model .txt
+/*--------------------------------------------------------------*/
+string modelcache::cachePath(const string& txtFile)
+{
+	return txtFile + MODEL_CACHE_EXT;
+}
+
+/*--------------------------------------------------------------*/
+// hashBytes : 64-bit FNV-1a
+/*--------------------------------------------------------------*/
+uint64_t modelcache::hashBytes(const char* bytes, size_t len)
+{
+	uint64_t h = 14695981039346656037ULL;
+	for (size_t i = 0; i < len; i++)
+	{
+		h ^= (unsigned char)bytes[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+/*--------------------------------------------------------------*/
+// open : maps and validates the cache for txtFile
+/*--------------------------------------------------------------*/
+bool modelcache::open(const string& txtFile, float weld_epsilon, bool optimize_overdraw, MappedFile& cache, MeshView& mesh)
+{
+	MappedFile source;
+	if (!source.open(txtFile)) return false;
+
+	string path = cachePath(txtFile);
+	if (!cache.open(path)) return false;
+
+	if (cache.getSize() < sizeof(ModelCacheHeader))
+	{
+		cache.close();
+		return false;
+	}
+
+	ModelCacheHeader header;
+	memcpy(&header, cache.getData(), sizeof(header));
+
+	uint64_t vert_bytes = (uint64_t)header.num_verts * header.floats_per_vert * sizeof(float);
+	uint64_t index_bytes = (uint64_t)header.num_indices * sizeof(uint32_t);
+	uint64_t lod_bytes = (uint64_t)header.num_lods * sizeof(MeshLOD);
+	bool valid = header.magic == MODEL_CACHE_MAGIC
+		&& header.version == MODEL_CACHE_VERSION
+		&& header.layout == LAYOUT_POS3_TEX2_NORM3
+		&& header.floats_per_vert == MODEL_VERT_FLOATS
+		&& header.weld_epsilon == weld_epsilon
+		&& header.optimize_overdraw == (optimize_overdraw ? 1u : 0u)
+		&& header.data_offset % sizeof(float) == 0
+		&& header.index_offset % sizeof(uint32_t) == 0
+		&& header.data_offset + vert_bytes <= cache.getSize()
+		&& header.index_offset + index_bytes <= cache.getSize()
+		&& header.num_lods <= MAX_MESH_LODS
+		&& header.lod_offset % sizeof(uint32_t) == 0
+		&& header.lod_offset + lod_bytes <= cache.getSize()
+		&& header.source_size == source.getSize();	//cheap check before hashing
+
+	if (valid) valid = header.source_hash == hashBytes(source.getData(), source.getSize());
+
+	//every index must land inside the vertex array
+	const uint32_t* indices = (const uint32_t*)(cache.getData() + header.index_offset);
+	for (uint32_t i = 0; valid && i < header.num_indices; i++)
+	{
+		if (indices[i] >= header.num_verts) valid = false;
+	}
+
+	//and every LOD inside the indices
+	const MeshLOD* lods = (const MeshLOD*)(cache.getData() + header.lod_offset);
+	for (uint32_t i = 0; valid && i < header.num_lods; i++)
+	{
+		if ((uint64_t)lods[i].first_index + lods[i].num_indices > header.num_indices) valid = false;
+	}
+
+	if (!valid)
+	{
+		cout << "Model cache " << path << " is stale, reparsing." << endl;
+		cache.close();
+		return false;
+	}
+
+	cout << "--------------------------------------------------" << endl;
+	cout << "Mapped model cache " << path << " successfully." << endl;
+
+	mesh.verts = (const float*)(cache.getData() + header.data_offset);
+	mesh.num_verts = (int)header.num_verts;
+	mesh.indices = indices;
+	mesh.num_indices = (int)header.num_indices;
+	mesh.lods = header.num_lods ? lods : nullptr;
+	mesh.num_lods = (int)header.num_lods;
+	return true;
+}
+
+/*--------------------------------------------------------------*/
+// write : builds the cache for txtFile out of a welded mesh
+/*--------------------------------------------------------------*/
+bool modelcache::write(const string& txtFile, float weld_epsilon, bool optimize_overdraw, const MeshView& mesh)
+{
+	MappedFile source;
+	if (!source.open(txtFile)) return false;
+
+	size_t vert_bytes = (size_t)mesh.num_verts * MODEL_VERT_FLOATS * sizeof(float);
+	size_t index_bytes = (size_t)mesh.num_indices * sizeof(uint32_t);
+
+	ModelCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = MODEL_CACHE_MAGIC;
+	header.version = MODEL_CACHE_VERSION;
+	header.layout = LAYOUT_POS3_TEX2_NORM3;
+	header.floats_per_vert = MODEL_VERT_FLOATS;
+	header.num_verts = (uint32_t)mesh.num_verts;
+	header.num_indices = (uint32_t)mesh.num_indices;
+	header.weld_epsilon = weld_epsilon;
+	header.optimize_overdraw = optimize_overdraw ? 1 : 0;
+	header.source_size = source.getSize();
+	header.source_hash = hashBytes(source.getData(), source.getSize());
+	header.data_offset = sizeof(ModelCacheHeader);
+	header.index_offset = header.data_offset + vert_bytes;
+	header.num_lods = (uint32_t)mesh.num_lods;
+	header.lod_offset = header.index_offset + index_bytes;
+
+	//write next to the final file and rename so a crash never leaves a torn cache
+	string path = cachePath(txtFile);
+	string tmpPath = path + ".tmp";
+	FILE* out = fopen(tmpPath.c_str(), "wb");
+	if (out == NULL)
+	{
+		cout << "Can't write model cache " << path << endl;
+		return false;
+	}
+
+	bool ok = fwrite(&header, sizeof(header), 1, out) == 1
+		&& fwrite(mesh.verts, 1, vert_bytes, out) == vert_bytes
+		&& fwrite(mesh.indices, sizeof(uint32_t), mesh.num_indices, out) == (size_t)mesh.num_indices
+		&& fwrite(mesh.lods, sizeof(MeshLOD), mesh.num_lods, out) == (size_t)mesh.num_lods;
+	ok = (fclose(out) == 0) && ok;
+
+	//rename won't replace an existing file on every platform
+	remove(path.c_str());
+	if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0)
+	{
+		remove(tmpPath.c_str());
+		cout << "Can't write model cache " << path << endl;
+		return false;
+	}
+
+	cout << "Wrote model cache " << path << endl;
+	return true;
+}
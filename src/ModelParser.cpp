@@ -0,0 +1,273 @@
+#include "ModelParser.h"
+
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "timerutil.h"
+
+using namespace std;
+
+#define IS_SEPARATOR(c) ((c) == ' ' || (c) == '\n' || (c) == '\r' || (c) == '\t' || (c) == ',')
+#define IS_DIGIT(c) ((unsigned)((c) - '0') < 10u)
+
+//smallest chunk worth a thread of its own
+static const size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+//exact powers of ten representable as double
+static const double POW10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+//HELPER FUNCTION DECLARATIONS
+static int countRange(const char* begin, const char* end);
+static int parseRange(const char* begin, const char* end, float* dst, int max_floats);
+
+/*--------------------------------------------------------------*/
+// mbPerSec : parse throughput
+/*--------------------------------------------------------------*/
+double modelparser::ParseStats::mbPerSec()
+{
+	if (seconds <= 0) return 0;
+	return (bytes / (1024.0 * 1024.0)) / seconds;
+}
+
+/*--------------------------------------------------------------*/
+// readHeader : leading float count of a model file
+/*--------------------------------------------------------------*/
+bool modelparser::readHeader(const char* data, size_t size, int& num_floats, size_t& body_offset)
+{
+	const char* p = data;
+	const char* end = data + size;
+	while (p < end && IS_SEPARATOR(*p)) p++;
+
+	float count = 0;
+	const char* after = parseFloat(p, end, count);
+	if (after == p || count < 0) return false;
+
+	num_floats = (int)count;
+	body_offset = after - data;
+	return true;
+}
+
+/*--------------------------------------------------------------*/
+// parseFloat : sign, digits, optional fraction and exponent
+//				(no locale, no allocation, no strtod)
+/*--------------------------------------------------------------*/
+const char* modelparser::parseFloat(const char* p, const char* end, float& out)
+{
+	const char* s = p;
+	bool negative = false;
+
+	if (s < end && (*s == '-' || *s == '+'))
+	{
+		negative = (*s == '-');
+		s++;
+	}
+
+	uint64_t mantissa = 0;
+	int digits = 0;		//significant digits kept in mantissa
+	int exponent = 0;	//base 10
+	bool any_digit = false;
+
+	//integer part
+	while (s < end && IS_DIGIT(*s))
+	{
+		any_digit = true;
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*s - '0');
+			if (mantissa != 0) digits++;
+		}
+		else exponent++;	//too many digits to keep, just track the magnitude
+		s++;
+	}
+
+	//fraction
+	if (s < end && *s == '.')
+	{
+		s++;
+		while (s < end && IS_DIGIT(*s))
+		{
+			any_digit = true;
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*s - '0');
+				if (mantissa != 0) digits++;
+				exponent--;
+			}
+			s++;
+		}
+	}
+
+	if (!any_digit) return p;
+
+	//exponent (only consumed if digits follow the 'e')
+	if (s < end && (*s == 'e' || *s == 'E'))
+	{
+		const char* e = s + 1;
+		bool exp_negative = false;
+		if (e < end && (*e == '-' || *e == '+'))
+		{
+			exp_negative = (*e == '-');
+			e++;
+		}
+
+		if (e < end && IS_DIGIT(*e))
+		{
+			int exp_value = 0;
+			while (e < end && IS_DIGIT(*e))
+			{
+				if (exp_value < 10000) exp_value = exp_value * 10 + (*e - '0');
+				e++;
+			}
+			exponent += exp_negative ? -exp_value : exp_value;
+			s = e;
+		}
+	}
+
+	double value = (double)mantissa;
+	if (mantissa != 0)
+	{
+		if (exponent >= 0 && exponent <= 22) value *= POW10[exponent];
+		else if (exponent < 0 && exponent >= -22) value /= POW10[-exponent];
+		else value *= pow(10.0, exponent);
+	}
+
+	out = (float)(negative ? -value : value);
+	return s;
+}
+
+/*--------------------------------------------------------------*/
+// parseModel : chunked parallel parse into dst
+/*--------------------------------------------------------------*/
+bool modelparser::parseModel(MappedFile& file, float* dst, int num_floats, ParseStats* stats, int num_threads)
+{
+	timerutil t;
+	t.start();
+
+	int header_floats = 0;
+	size_t body_offset = 0;
+	if (!file.isOpen() || !readHeader(file.getData(), file.getSize(), header_floats, body_offset)) return false;
+
+	const char* body = file.getData() + body_offset;
+	const char* body_end = file.getData() + file.getSize();
+	size_t body_size = body_end - body;
+
+	//one thread per core, but never chunks smaller than MIN_CHUNK_BYTES
+	if (num_threads <= 0) num_threads = (int)thread::hardware_concurrency();
+	if (num_threads <= 0) num_threads = 1;
+	int max_useful = (int)(body_size / MIN_CHUNK_BYTES) + 1;
+	if (num_threads > max_useful) num_threads = max_useful;
+
+	//chunk boundaries, pushed forward onto a separator so no number is split
+	vector<const char*> bounds(num_threads + 1);
+	bounds[0] = body;
+	bounds[num_threads] = body_end;
+	for (int i = 1; i < num_threads; i++)
+	{
+		const char* b = body + body_size * i / num_threads;
+		if (b < bounds[i - 1]) b = bounds[i - 1];
+		while (b < body_end && !IS_SEPARATOR(*b)) b++;
+		bounds[i] = b;
+	}
+
+	bool ok = true;
+	if (num_threads == 1)
+	{
+		ok = parseRange(body, body_end, dst, num_floats) == num_floats;
+	}
+	else
+	{
+		//pass 1 : count the floats in every chunk
+		vector<int> counts(num_threads, 0);
+		vector<thread> workers;
+		for (int i = 0; i < num_threads; i++)
+		{
+			workers.push_back(thread([&bounds, &counts, i]() {
+				counts[i] = countRange(bounds[i], bounds[i + 1]);
+			}));
+		}
+		for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+		workers.clear();
+
+		//prefix sum gives each chunk its slice of dst
+		vector<int> firsts(num_threads, 0);
+		int total = 0;
+		for (int i = 0; i < num_threads; i++)
+		{
+			firsts[i] = total;
+			total += counts[i];
+		}
+		if (total < num_floats) return false;
+
+		//pass 2 : parse every chunk in place (extra floats past num_floats are ignored)
+		vector<int> parsed(num_threads, 0);
+		for (int i = 0; i < num_threads; i++)
+		{
+			workers.push_back(thread([&bounds, &firsts, &counts, &parsed, dst, num_floats, i]() {
+				int wanted = num_floats - firsts[i];
+				if (wanted > counts[i]) wanted = counts[i];
+				if (wanted <= 0) return;
+				parsed[i] = parseRange(bounds[i], bounds[i + 1], dst + firsts[i], wanted);
+				if (parsed[i] == wanted) parsed[i] = counts[i];	//mark chunk as fully handled
+			}));
+		}
+		for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+
+		for (int i = 0; i < num_threads && firsts[i] < num_floats; i++)
+		{
+			if (parsed[i] != counts[i]) ok = false;
+		}
+	}
+
+	t.end();
+	if (stats != nullptr)
+	{
+		stats->bytes = body_size;
+		stats->num_floats = num_floats;
+		stats->num_threads = num_threads;
+		stats->seconds = t.usec() / 1000000.0;
+	}
+
+	return ok;
+}
+
+/*----------------------------*/
+// HELPER FUNCTIONS
+/*----------------------------*/
+//counts separator delimited tokens in [begin, end)
+static int countRange(const char* begin, const char* end)
+{
+	int count = 0;
+	bool in_token = false;
+	for (const char* p = begin; p < end; p++)
+	{
+		bool sep = IS_SEPARATOR(*p);
+		if (!sep && !in_token) count++;
+		in_token = !sep;
+	}
+	return count;
+}
+
+//parses up to max_floats floats from [begin, end) into dst
+//returns how many were parsed, or -1 on a token that isn't a number
+static int parseRange(const char* begin, const char* end, float* dst, int max_floats)
+{
+	const char* p = begin;
+	int n = 0;
+	while (n < max_floats)
+	{
+		while (p < end && IS_SEPARATOR(*p)) p++;
+		if (p >= end) break;
+
+		const char* next = modelparser::parseFloat(p, end, dst[n]);
+		if (next == p || (next < end && !IS_SEPARATOR(*next))) return -1;
+
+		p = next;
+		n++;
+	}
+	return n;
+}
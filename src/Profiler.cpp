@@ -0,0 +1,467 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+/*----------------------------*/
+// STATE
+/*----------------------------*/
+namespace
+{
+	//one per thread that opened a zone, never freed so events can outlive their thread
+	struct ThreadLog
+	{
+		int id;
+		string name;
+		vector<ProfileEvent> open;	//only touched by its own thread
+		mutex lock;									//guards done
+		vector<ProfileEvent> done;	//taken by endFrame
+	};
+
+	//one frame's GPU queries
+	struct QuerySet
+	{
+		GLuint frame_query;		//GL_TIME_ELAPSED
+		GLuint stamps[PROFILER_GPU_ZONES * 2];	//GL_TIMESTAMP at each zone's begin and end
+		const char* names[PROFILER_GPU_ZONES];
+		int depths[PROFILER_GPU_ZONES];
+		int count;
+		uint64_t frame;
+		bool pending;					//issued and not read yet
+	};
+
+	const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+
+	mutex threads_lock;
+	vector<ThreadLog*> threads;
+	thread_local ThreadLog* this_thread = nullptr;
+	int main_thread = 1;				//frames are drawn on its track
+
+	ProfileFrame frames[PROFILER_FRAMES];
+	uint64_t frame_count = 0;		//finished frames
+	bool in_frame = false;
+
+	bool gpu_timers = false;
+	QuerySet query_sets[PROFILER_QUERY_SETS];
+	QuerySet* current_set = nullptr;
+	vector<int> gpu_open;				//zone slots open this frame, -1 when dropped
+	int64_t gpu_offset = 0;			//GPU clock - profiler clock, in ns
+	int gpu_waits = 0;
+
+	ThreadLog* threadLog()
+	{
+		if (this_thread == nullptr)
+		{
+			unique_lock<mutex> guard(threads_lock);
+			this_thread = new ThreadLog();
+			this_thread->id = (int)threads.size() + 1;
+			this_thread->name = "thread " + to_string(this_thread->id);
+			threads.push_back(this_thread);
+		}
+		return this_thread;
+	}
+
+	ProfileFrame& frameAt(uint64_t index)
+	{
+		return frames[index % PROFILER_FRAMES];
+	}
+
+	//lines the GPU clock up with ours, the queries return GPU time
+	void calibrateGPU()
+	{
+		GLint64 gpu_now = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+		gpu_offset = (int64_t)gpu_now - (int64_t)profiler::now();
+	}
+
+	//adds set's zones to the frame that recorded them, if it's still in the ring
+	//wait : block for the results instead of leaving them for later
+	bool resolve(QuerySet& set, bool wait)
+	{
+		if (!set.pending) return true;
+
+		if (!wait)
+		{
+			GLuint available = 0;
+			glGetQueryObjectuiv(set.frame_query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available && set.count > 0) glGetQueryObjectuiv(set.stamps[set.count * 2 - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) return false;
+		}
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(set.frame_query, GL_QUERY_RESULT, &elapsed);
+
+		ProfileFrame& frame = frameAt(set.frame);
+		bool kept = (frame.index == set.frame && frame_count - set.frame < PROFILER_FRAMES);
+		for (int i = 0; i < set.count; i++)
+		{
+			GLuint64 begin = 0, end = 0;
+			glGetQueryObjectui64v(set.stamps[i * 2], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(set.stamps[i * 2 + 1], GL_QUERY_RESULT, &end);
+			if (!kept) continue;
+
+			ProfileEvent e;
+			e.name = set.names[i];
+			e.start = (uint64_t)((int64_t)begin - gpu_offset);
+			e.end = (uint64_t)((int64_t)end - gpu_offset);
+			e.thread = PROFILER_GPU_THREAD;
+			e.depth = set.depths[i];
+			frame.events.push_back(e);
+		}
+		//llvmpipe times an elapsed query started before anything was drawn from context creation,
+		//so the first frame's total is left out
+		if (kept && set.frame > 0)
+		{
+			frame.gpu_time = elapsed;
+			frame.gpu_resolved = true;
+		}
+
+		set.pending = false;
+		return true;
+	}
+
+	//writes s as a JSON string
+	void writeJSONString(FILE* f, const char* s)
+	{
+		fputc('"', f);
+		for (; *s; s++)
+		{
+			if (*s == '"' || *s == '\\') fputc('\\', f);
+			if ((unsigned char)*s >= 0x20) fputc(*s, f);
+		}
+		fputc('"', f);
+	}
+
+	//ns to the trace's microseconds
+	double traceTime(uint64_t ns)
+	{
+		return ns / 1000.0;
+	}
+}
+
+/*----------------------------*/
+// SETUP
+/*----------------------------*/
+void profiler::init()
+{
+	setThreadName("main");
+	main_thread = threadLog()->id;
+
+	gpu_timers = (GLAD_GL_VERSION_3_3 || GLAD_GL_ARB_timer_query);
+	if (!gpu_timers)
+	{
+		printf("Profiler: no timer queries, CPU zones only\n");
+		return;
+	}
+
+	for (int i = 0; i < PROFILER_QUERY_SETS; i++)
+	{
+		QuerySet& set = query_sets[i];
+		glGenQueries(1, &set.frame_query);
+		glGenQueries(PROFILER_GPU_ZONES * 2, set.stamps);
+		set.count = 0;
+		set.frame = 0;
+		set.pending = false;
+	}
+
+	calibrateGPU();
+}
+
+void profiler::shutdown()
+{
+	if (!gpu_timers) return;
+
+	for (int i = 0; i < PROFILER_QUERY_SETS; i++)
+	{
+		glDeleteQueries(1, &query_sets[i].frame_query);
+		glDeleteQueries(PROFILER_GPU_ZONES * 2, query_sets[i].stamps);
+	}
+	gpu_timers = false;
+	current_set = nullptr;
+}
+
+void profiler::setThreadName(const char* name)
+{
+	ThreadLog* log = threadLog();
+	unique_lock<mutex> guard(threads_lock);
+	log->name = name;
+}
+
+uint64_t profiler::now()
+{
+	return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count();
+}
+
+/*----------------------------*/
+// FRAMES
+/*----------------------------*/
+void profiler::beginFrame()
+{
+	ProfileFrame& frame = frameAt(frame_count);
+	frame.index = frame_count;
+	frame.start = now();
+	frame.end = frame.start;
+	frame.gpu_time = 0;
+	frame.gpu_resolved = false;
+	frame.events.clear();
+	in_frame = true;
+
+	if (!gpu_timers) return;
+
+	//the set last used PROFILER_QUERY_SETS frames ago, normally read long since
+	current_set = &query_sets[frame_count % PROFILER_QUERY_SETS];
+	if (current_set->pending)
+	{
+		gpu_waits++;
+		resolve(*current_set, true);
+	}
+
+	//the clocks drift apart slowly, once per ring is plenty
+	if (frame_count % PROFILER_FRAMES == 0) calibrateGPU();
+
+	current_set->count = 0;
+	current_set->frame = frame_count;
+	current_set->pending = true;
+	gpu_open.clear();
+	glBeginQuery(GL_TIME_ELAPSED, current_set->frame_query);
+}
+
+void profiler::endFrame()
+{
+	if (!in_frame) return;
+
+	if (current_set != nullptr)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		current_set = nullptr;
+	}
+
+	ProfileFrame& frame = frameAt(frame_count);
+	frame.end = now();
+
+	//zones every thread finished since the last frame
+	{
+		unique_lock<mutex> guard(threads_lock);
+		for (size_t i = 0; i < threads.size(); i++)
+		{
+			unique_lock<mutex> log_guard(threads[i]->lock);
+			frame.events.insert(frame.events.end(), threads[i]->done.begin(), threads[i]->done.end());
+			threads[i]->done.clear();
+		}
+	}
+
+	frame_count++;
+	in_frame = false;
+
+	//earlier frames' GPU results, oldest first, stopping at the first one the GPU isn't done with
+	if (!gpu_timers) return;
+	for (uint64_t i = PROFILER_QUERY_SETS - 1; i > 0; i--)
+	{
+		if (frame_count < i) continue;
+		if (!resolve(query_sets[(frame_count - i) % PROFILER_QUERY_SETS], false)) break;
+	}
+}
+
+void profiler::resolveAll()
+{
+	if (!gpu_timers || in_frame) return;
+
+	//oldest first, like endFrame
+	for (uint64_t i = PROFILER_QUERY_SETS; i > 0; i--)
+	{
+		if (frame_count < i) continue;
+		resolve(query_sets[(frame_count - i) % PROFILER_QUERY_SETS], true);
+	}
+}
+
+/*----------------------------*/
+// ZONES
+/*----------------------------*/
+void profiler::beginZone(const char* name)
+{
+	ThreadLog* log = threadLog();
+
+	ProfileEvent e;
+	e.name = name;
+	e.thread = log->id;
+	e.depth = (int)log->open.size();
+	e.start = now();
+	e.end = e.start;
+	log->open.push_back(e);
+}
+
+void profiler::endZone()
+{
+	uint64_t t = now();
+	ThreadLog* log = threadLog();
+	if (log->open.empty()) return;
+
+	ProfileEvent e = log->open.back();
+	log->open.pop_back();
+	e.end = t;
+
+	unique_lock<mutex> guard(log->lock);
+	log->done.push_back(e);
+}
+
+void profiler::beginGPUZone(const char* name)
+{
+	if (current_set == nullptr) return;
+
+	QuerySet& set = *current_set;
+	int slot = -1;
+	if (set.count < PROFILER_GPU_ZONES)
+	{
+		slot = set.count++;
+		set.names[slot] = name;
+		set.depths[slot] = (int)gpu_open.size();
+		glQueryCounter(set.stamps[slot * 2], GL_TIMESTAMP);
+	}
+	gpu_open.push_back(slot);
+}
+
+void profiler::endGPUZone()
+{
+	if (current_set == nullptr || gpu_open.empty()) return;
+
+	int slot = gpu_open.back();
+	gpu_open.pop_back();
+	if (slot >= 0) glQueryCounter(current_set->stamps[slot * 2 + 1], GL_TIMESTAMP);
+}
+
+/*----------------------------*/
+// OUTPUT
+/*----------------------------*/
+const ProfileFrame* profiler::getFrame(int back)
+{
+	if (back < 0 || (uint64_t)back >= frame_count || back >= PROFILER_FRAMES) return nullptr;
+	return &frameAt(frame_count - 1 - back);
+}
+
+void profiler::printSummary(int frames)
+{
+	struct Line
+	{
+		const char* name;
+		int thread;
+		int depth;
+		uint64_t first;		//earliest start seen, for ordering
+		uint64_t total;
+	};
+	vector<Line> lines;
+
+	uint64_t cpu_total = 0, gpu_total = 0;
+	int count = 0, gpu_count = 0;
+	for (int back = 0; back < frames; back++)
+	{
+		const ProfileFrame* frame = getFrame(back);
+		if (frame == nullptr) break;
+		count++;
+		cpu_total += frame->end - frame->start;
+		if (frame->gpu_resolved)
+		{
+			gpu_total += frame->gpu_time;
+			gpu_count++;
+		}
+
+		for (size_t i = 0; i < frame->events.size(); i++)
+		{
+			const ProfileEvent& e = frame->events[i];
+			size_t j = 0;
+			while (j < lines.size() && !(lines[j].thread == e.thread && lines[j].depth == e.depth && strcmp(lines[j].name, e.name) == 0)) j++;
+			if (j == lines.size())
+			{
+				Line l = { e.name, e.thread, e.depth, e.start, 0 };
+				lines.push_back(l);
+			}
+			lines[j].first = min(lines[j].first, e.start);
+			lines[j].total += e.end - e.start;
+		}
+	}
+	if (count == 0) return;
+
+	//parents before the zones inside them
+	sort(lines.begin(), lines.end(), [](const Line& a, const Line& b) { return a.first < b.first; });
+
+	printf("Profile (ms per frame over %d frames): CPU %.3f", count, cpu_total / 1e6 / count);
+	if (gpu_count > 0) printf(", GPU %.3f", gpu_total / 1e6 / gpu_count);
+	if (gpu_waits > 0) printf(", %d query waits", gpu_waits);
+	printf("\n");
+	gpu_waits = 0;
+
+	//per thread, in the order zones started
+	unique_lock<mutex> guard(threads_lock);
+	for (int t = PROFILER_GPU_THREAD; t <= (int)threads.size(); t++)
+	{
+		bool header = false;
+		for (size_t j = 0; j < lines.size(); j++)
+		{
+			if (lines[j].thread != t) continue;
+			if (!header)
+			{
+				printf("  %s\n", t == PROFILER_GPU_THREAD ? "GPU" : threads[t - 1]->name.c_str());
+				header = true;
+			}
+			int frames_seen = (t == PROFILER_GPU_THREAD) ? max(gpu_count, 1) : count;
+			printf("    %*s%-16s %.3f\n", lines[j].depth * 2, "", lines[j].name, lines[j].total / 1e6 / frames_seen);
+		}
+	}
+}
+
+bool profiler::writeChromeTrace(const char* path)
+{
+	FILE* f = fopen(path, "w");
+	if (f == nullptr)
+	{
+		printf("ERROR: Could not write profile to %s\n", path);
+		return false;
+	}
+
+	fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	//track names
+	fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"GPU\"}}", PROFILER_GPU_THREAD);
+	{
+		unique_lock<mutex> guard(threads_lock);
+		for (size_t i = 0; i < threads.size(); i++)
+		{
+			fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", threads[i]->id);
+			writeJSONString(f, threads[i]->name.c_str());
+			fprintf(f, "}}");
+		}
+	}
+
+	//oldest frame first
+	int written = 0;
+	uint64_t kept = frame_count < PROFILER_FRAMES ? frame_count : PROFILER_FRAMES;
+	for (uint64_t i = frame_count - kept; i < frame_count; i++)
+	{
+		const ProfileFrame& frame = frameAt(i);
+		fprintf(f, ",\n{\"name\":\"Frame\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu",
+			main_thread, traceTime(frame.start), traceTime(frame.end - frame.start), (unsigned long long)frame.index);
+		if (frame.gpu_resolved) fprintf(f, ",\"gpu_ms\":%.3f", frame.gpu_time / 1e6);
+		fprintf(f, "}}");
+
+		for (size_t j = 0; j < frame.events.size(); j++)
+		{
+			const ProfileEvent& e = frame.events[j];
+			fprintf(f, ",\n{\"name\":");
+			writeJSONString(f, e.name);
+			fprintf(f, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				e.thread == PROFILER_GPU_THREAD ? "gpu" : "cpu", e.thread, traceTime(e.start), traceTime(e.end - e.start));
+		}
+		written++;
+	}
+
+	fprintf(f, "\n]}\n");
+	bool ok = (ferror(f) == 0);
+	fclose(f);
+
+	if (ok) printf("Wrote %d frames of profile to %s\n", written, path);
+	else printf("ERROR: Could not write profile to %s\n", path);
+	return ok;
+}
@@ -0,0 +1,547 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#include "glm/gtc/type_ptr.hpp"
+
+#include "Util.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define RENDERQUEUE_SSE
+#include <xmmintrin.h>
+#endif
+
+//HELPER FUNCTION DECLARATIONS
+static void transformInstances(const glm::mat4& view, const glm::mat4& proj, const glm::mat4* models, int count,
+	InstanceData* out);
+static bool hasDivisors();
+static bool hasMultiDrawIndirect();
+static void attribDivisor(GLuint index, GLuint divisor);
+static void enableInstanceArrays(bool on);
+
+/*----------------------------*/
+// RENDER STATS
+/*----------------------------*/
+void RenderStats::print() const
+{
+	printf("Packets: %d, draws: %d (%d meshes%s), triangles: %d, switches: %d program, %d texture, %d VAO (%d binds skipped)\n",
+		packets, draws, commands, indirect ? ", multi-draw indirect" : "", triangles, program_switches, texture_switches,
+		vao_switches, binds_skipped);
+}
+
+/*----------------------------*/
+// CONSTRUCTORS AND DESTRUCTORS
+/*----------------------------*/
+RenderQueue::RenderQueue()
+{
+	depth_near = 0.1f;
+	depth_far = 100.0f;
+	view = glm::mat4(1.0f);
+	proj = glm::mat4(1.0f);
+}
+
+/*----------------------------*/
+// GETTERS
+/*----------------------------*/
+int RenderQueue::getNumPackets()
+{
+	return (int)packets.size();
+}
+
+const RenderStats& RenderQueue::getStats()
+{
+	return stats;
+}
+
+/*----------------------------*/
+// SETTERS
+/*----------------------------*/
+void RenderQueue::setDepthRange(float near_z, float far_z)
+{
+	depth_near = near_z;
+	depth_far = far_z;
+}
+
+void RenderQueue::setCamera(const glm::mat4& v, const glm::mat4& p)
+{
+	view = v;
+	proj = p;
+}
+
+/*----------------------------*/
+// OTHERS
+/*----------------------------*/
+void RenderQueue::clear()
+{
+	packets.clear();
+}
+
+void RenderQueue::submit(RenderPass pass, ProgramHandle program, TextureHandle tex, GLuint vao, MeshHandle mesh, int lod,
+	const glm::mat4& model, int material, float depth)
+{
+	DrawPacket p;
+	p.key = makeKey(pass, program, tex, vao, mesh, lod, material, depth);
+	p.program = program;
+	p.texture = tex;
+	p.vao = vao;
+	p.mesh = mesh;
+	p.lod = lod;
+	p.model = model;
+	p.material = material;
+	packets.push_back(p);
+}
+
+void RenderQueue::execute(ResourceManager* resources, StreamBuffer& stream)
+{
+	stats = RenderStats();
+	stats.packets = (int)packets.size();
+	if (packets.empty()) return;
+
+	order.resize(packets.size());
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		order[i].key = packets[i].key;
+		order[i].index = (uint32_t)i;
+	}
+	radixSort();
+
+	//every instance's matrices in one go, in draw order
+	models.resize(packets.size());
+	staging.resize(packets.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const DrawPacket& p = packets[order[i].index];
+		models[i] = p.model;
+		staging[i].material = p.material;
+		staging[i].mesh = 0;	//set with the runs
+		staging[i].pad[0] = staging[i].pad[1] = 0;
+	}
+	transformInstances(view, proj, &models[0], (int)models.size(), &staging[0]);
+
+	//the draws the frame needs, before anything is drawn so the stream is only flushed once
+	bool divisors = hasDivisors();
+	stats.indirect = divisors && hasMultiDrawIndirect();
+	buildBatches(resources);
+
+	//one copy for the whole frame, into a region the GPU is done with
+	size_t bytes = staging.size() * sizeof(InstanceData);
+	instances = stream.alloc(bytes, sizeof(glm::vec4));
+	memcpy(instances.ptr, &staging[0], bytes);
+	if (stats.indirect && !commands.empty())
+	{
+		indirect = stream.alloc(commands.size() * sizeof(DrawCommand), sizeof(uint32_t));
+		memcpy(indirect.ptr, &commands[0], commands.size() * sizeof(DrawCommand));
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect.buffer);
+	}
+	//always whole blocks, so indexing past the used entries stays defined
+	mesh_tables.resize(mesh_blocks.size() / MAX_DRAW_MESHES);
+	for (size_t t = 0; t < mesh_tables.size(); t++)
+	{
+		mesh_tables[t] = stream.allocUniform(MAX_DRAW_MESHES * sizeof(MeshBlock));
+		memcpy(mesh_tables[t].ptr, &mesh_blocks[t * MAX_DRAW_MESHES], MAX_DRAW_MESHES * sizeof(MeshBlock));
+	}
+	stream.flush();
+
+	const ShaderProgram* shader = nullptr;
+	ProgramHandle cur_program;
+	TextureHandle cur_texture;
+	GLuint cur_vao = 0;
+	int cur_mesh_table = -1;
+	bool texture_bound = false;
+	int executed = 0;
+
+	for (size_t b = 0; b < batches.size(); b++)
+	{
+		const DrawBatch& batch = batches[b];
+
+		bool program_changed = (shader == nullptr || batch.program != cur_program);
+		if (program_changed)
+		{
+			shader = &resources->getProgram(batch.program)->shader;
+			shader->use();
+			shader->set(UNIFORM_TEX0, 0);	//every texture goes to unit 0
+			cur_program = batch.program;
+			stats.program_switches++;
+		}
+
+		if (batch.vao != cur_vao)
+		{
+			glBindVertexArray(batch.vao);
+			enableInstanceArrays(divisors);	//VAO state
+			if (stats.indirect) setInstanceAttribs(0);	//the commands' base instances do the rest
+			cur_vao = batch.vao;
+			stats.vao_switches++;
+		}
+
+		//untextured until the texture is uploaded
+		const TextureResource* tex = resources->getTexture(batch.texture);
+		if (!texture_bound || batch.texture != cur_texture)
+		{
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, (tex != nullptr) ? tex->tex : 0);
+			cur_texture = batch.texture;
+			texture_bound = true;
+			stats.texture_switches++;
+		}
+		shader->set(UNIFORM_TEX_ID, (tex != nullptr) ? 0 : -1);
+
+		//the packed vertex formats of the batch's meshes
+		if (batch.mesh_table != cur_mesh_table)
+		{
+			const StreamAlloc& table = mesh_tables[batch.mesh_table];
+			glBindBufferRange(GL_UNIFORM_BUFFER, MESH_BLOCK_BINDING, table.buffer, table.offset,
+				MAX_DRAW_MESHES * sizeof(MeshBlock));
+			cur_mesh_table = batch.mesh_table;
+		}
+
+		const DrawCommand* cmds = &commands[batch.first_command];
+		for (int c = 0; c < batch.num_commands; c++)
+		{
+			executed += (int)cmds[c].instance_count;
+			stats.triangles += (int)(cmds[c].instance_count * (cmds[c].count / 3));
+		}
+		stats.commands += batch.num_commands;
+
+		if (stats.indirect)
+		{
+			glMultiDrawElementsIndirect(GL_TRIANGLES, batch.index_type,
+				(void*)(indirect.offset + batch.first_command * sizeof(DrawCommand)), batch.num_commands, 0);
+			stats.draws++;
+			continue;
+		}
+
+		size_t index_size = (batch.index_type == GL_UNSIGNED_SHORT) ? 2 : 4;
+		for (int c = 0; c < batch.num_commands; c++)
+		{
+			const DrawCommand& cmd = cmds[c];
+			void* indices = (void*)(cmd.first_index * index_size);
+
+			if (divisors)
+			{
+				//instance numbering restarts at 0 every draw, so the attributes start at the run
+				setInstanceAttribs(cmd.base_instance);
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, cmd.count, batch.index_type, indices,
+					(GLsizei)cmd.instance_count, cmd.base_vertex);
+				stats.draws++;
+				continue;
+			}
+
+			for (uint32_t i = cmd.base_instance; i < cmd.base_instance + cmd.instance_count; i++)
+			{
+				const InstanceData& inst = staging[i];
+				for (int k = 0; k < 4; k++)
+				{
+					glVertexAttrib4fv(INSTANCE_MVP_ATTRIB + k, glm::value_ptr(inst.mvp[k]));
+					glVertexAttrib4fv(INSTANCE_MODELVIEW_ATTRIB + k, glm::value_ptr(inst.model_view[k]));
+				}
+				for (int k = 0; k < 3; k++) glVertexAttrib3fv(INSTANCE_NORMAL_ATTRIB + k, glm::value_ptr(inst.normal[k]));
+				glVertexAttribI1i(INSTANCE_MATERIAL_ATTRIB, inst.material);
+				glVertexAttribI1i(INSTANCE_MESH_ATTRIB, inst.mesh);
+				glDrawElementsBaseVertex(GL_TRIANGLES, cmd.count, batch.index_type, indices, cmd.base_vertex);
+				stats.draws++;
+			}
+		}
+	}
+
+	//drawing every packet by itself would bind program, texture and VAO each time
+	stats.binds_skipped = 3 * executed - stats.program_switches - stats.texture_switches - stats.vao_switches;
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	if (stats.indirect) glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+/*----------------------------*/
+// PRIVATE FUNCTIONS
+/*----------------------------*/
+uint64_t RenderQueue::makeKey(RenderPass pass, ProgramHandle program, TextureHandle tex, GLuint vao,
+	MeshHandle mesh, int lod, int material, float depth)
+{
+	const uint64_t depth_max = (1u << KEY_DEPTH_BITS) - 1;
+
+	float t = (depth - depth_near) / (depth_far - depth_near);
+	t = min(max(t, 0.0f), 1.0f);
+	uint64_t d = (uint64_t)(t * depth_max);
+	if (pass == PASS_TRANSPARENT) d = depth_max - d;	//back to front
+
+	//untextured sorts apart from texture slot 0
+	uint64_t tex_key = tex.isNull() ? 0 : tex.index + 1;
+
+	return ((uint64_t)pass << KEY_PASS_SHIFT)
+		| ((uint64_t)(program.index & 0x3FF) << KEY_PROGRAM_SHIFT)
+		| ((tex_key & 0xFFF) << KEY_TEXTURE_SHIFT)
+		| ((uint64_t)(vao & 0x3F) << KEY_VAO_SHIFT)
+		| ((uint64_t)(mesh.index & 0x1FF) << KEY_MESH_SHIFT)
+		| ((uint64_t)(lod & 0x7) << KEY_LOD_SHIFT)
+		| ((uint64_t)(material & 0xFF) << KEY_MATERIAL_SHIFT)
+		| d;
+}
+
+//splits the sorted packets into runs sharing program, texture, VAO, mesh and LOD (one
+//command each), and consecutive runs into batches that can share a draw call
+//every mesh gets an entry in the Meshes block its instances point at
+//runs whose program or mesh isn't uploaded yet are dropped
+void RenderQueue::buildBatches(ResourceManager* resources)
+{
+	batches.clear();
+	commands.clear();
+	mesh_blocks.clear();
+	mesh_entries.clear();
+	int mesh_table = -1;
+
+	size_t begin = 0;
+	while (begin < order.size())
+	{
+		const DrawPacket& p = packets[order[begin].index];
+
+		//a run shares everything but material and depth (those are per instance)
+		size_t end = begin + 1;
+		while (end < order.size())
+		{
+			const DrawPacket& q = packets[order[end].index];
+			if (q.program != p.program || q.texture != p.texture || q.vao != p.vao || q.mesh != p.mesh || q.lod != p.lod) break;
+			end++;
+		}
+
+		const MeshResource* m = resources->getMesh(p.mesh);
+		if (resources->getProgram(p.program) == nullptr || m == nullptr || p.vao == 0)
+		{
+			begin = end;
+			continue;
+		}
+
+		//the LOD's range of the mesh's indices
+		const MeshLOD& lod = m->lods[min(max(p.lod, 0), max(m->num_lods - 1, 0))];
+		size_t index_size = (m->index_type == GL_UNSIGNED_SHORT) ? 2 : 4;
+
+		DrawCommand cmd;
+		cmd.count = lod.num_indices;
+		cmd.instance_count = (uint32_t)(end - begin);
+		cmd.first_index = (uint32_t)(m->index_offset / index_size) + lod.first_index;
+		cmd.base_vertex = m->base_vertex;
+		cmd.base_instance = (uint32_t)begin;
+
+		//a full block starts another copy, which the next batch binds instead
+		unordered_map<uint32_t, int>::iterator found = mesh_entries.find(p.mesh.index);
+		int entry;
+		if (found != mesh_entries.end()) entry = found->second;
+		else
+		{
+			if (mesh_table < 0 || mesh_entries.size() == MAX_DRAW_MESHES)
+			{
+				mesh_entries.clear();
+				mesh_table++;
+				mesh_blocks.resize((mesh_table + 1) * MAX_DRAW_MESHES);
+			}
+			entry = (int)mesh_entries.size();
+			mesh_entries[p.mesh.index] = entry;
+
+			const MeshQuantization& q = m->quant;
+			MeshBlock& mb = mesh_blocks[mesh_table * MAX_DRAW_MESHES + entry];
+			mb.pos_scale = glm::vec4(q.pos_scale[0], q.pos_scale[1], q.pos_scale[2], 0.0f);
+			mb.pos_bias = glm::vec4(q.pos_bias[0], q.pos_bias[1], q.pos_bias[2], 0.0f);
+			mb.uv_scale_bias = glm::vec4(q.uv_scale[0], q.uv_scale[1], q.uv_bias[0], q.uv_bias[1]);
+		}
+		for (size_t i = begin; i < end; i++) staging[i].mesh = entry;
+
+		bool joins = false;
+		if (!batches.empty())
+		{
+			const DrawBatch& last = batches.back();
+			joins = last.program == p.program && last.texture == p.texture && last.vao == p.vao
+				&& last.index_type == m->index_type && last.mesh_table == mesh_table;
+		}
+
+		if (!joins)
+		{
+			DrawBatch batch;
+			batch.program = p.program;
+			batch.texture = p.texture;
+			batch.vao = p.vao;
+			batch.index_type = m->index_type;
+			batch.mesh_table = mesh_table;
+			batch.first_command = (int)commands.size();
+			batch.num_commands = 0;
+			batches.push_back(batch);
+		}
+
+		commands.push_back(cmd);
+		batches.back().num_commands++;
+		begin = end;
+	}
+}
+
+//LSD radix sort of order by key, a byte per pass
+//passes where every key has the same byte are skipped, which with few
+//programs and textures is most of the high bytes
+void RenderQueue::radixSort()
+{
+	size_t n = order.size();
+	sort_tmp.resize(n);
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t count[256] = { 0 };
+		for (size_t i = 0; i < n; i++) count[(order[i].key >> shift) & 0xFF]++;
+		if (count[(order[0].key >> shift) & 0xFF] == n) continue;
+
+		size_t offset[256];
+		size_t sum = 0;
+		for (int b = 0; b < 256; b++)
+		{
+			offset[b] = sum;
+			sum += count[b];
+		}
+
+		//stable, so lower bytes keep their order within a bucket
+		for (size_t i = 0; i < n; i++) sort_tmp[offset[(order[i].key >> shift) & 0xFF]++] = order[i];
+		order.swap(sort_tmp);
+	}
+}
+
+//points the bound VAO's instance attributes at this frame's instances, starting at
+//instance first (one step per instance)
+void RenderQueue::setInstanceAttribs(size_t first)
+{
+	GLsizei stride = sizeof(InstanceData);
+	size_t base = instances.offset + first * sizeof(InstanceData);
+
+	glBindBuffer(GL_ARRAY_BUFFER, instances.buffer);
+
+	//a matrix attribute takes consecutive locations, one column each
+	for (int c = 0; c < 4; c++)
+	{
+		glVertexAttribPointer(INSTANCE_MVP_ATTRIB + c, 4, GL_FLOAT, GL_FALSE, stride,
+			(void*)(base + offsetof(InstanceData, mvp) + c * sizeof(glm::vec4)));
+		attribDivisor(INSTANCE_MVP_ATTRIB + c, 1);
+
+		glVertexAttribPointer(INSTANCE_MODELVIEW_ATTRIB + c, 4, GL_FLOAT, GL_FALSE, stride,
+			(void*)(base + offsetof(InstanceData, model_view) + c * sizeof(glm::vec4)));
+		attribDivisor(INSTANCE_MODELVIEW_ATTRIB + c, 1);
+	}
+	for (int c = 0; c < 3; c++)
+	{
+		glVertexAttribPointer(INSTANCE_NORMAL_ATTRIB + c, 3, GL_FLOAT, GL_FALSE, stride,
+			(void*)(base + offsetof(InstanceData, normal) + c * sizeof(glm::vec4)));
+		attribDivisor(INSTANCE_NORMAL_ATTRIB + c, 1);
+	}
+
+	glVertexAttribIPointer(INSTANCE_MATERIAL_ATTRIB, 1, GL_INT, stride, (void*)(base + offsetof(InstanceData, material)));
+	attribDivisor(INSTANCE_MATERIAL_ATTRIB, 1);
+	glVertexAttribIPointer(INSTANCE_MESH_ATTRIB, 1, GL_INT, stride, (void*)(base + offsetof(InstanceData, mesh)));
+	attribDivisor(INSTANCE_MESH_ATTRIB, 1);
+}
+
+/*----------------------------*/
+// HELPER FUNCTIONS
+/*----------------------------*/
+//out[i] : matrices for an object at models[i]
+//the normal matrix is the inverse transpose of model_view's 3x3 A, which is
+//(b x c, c x a, a x b) / det(A) for A's columns a, b, c
+static void transformInstances(const glm::mat4& view, const glm::mat4& proj, const glm::mat4* models, int count,
+	InstanceData* out)
+{
+#ifdef RENDERQUEUE_SSE
+	__m128 v[4], p[4];
+	for (int c = 0; c < 4; c++)
+	{
+		v[c] = _mm_loadu_ps(glm::value_ptr(view[c]));
+		p[c] = _mm_loadu_ps(glm::value_ptr(proj[c]));
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		const float* m = glm::value_ptr(models[i]);
+		InstanceData& o = out[i];
+
+		//each column of a product is the left matrix's columns weighted by the right's column
+		__m128 mv[4];
+		for (int c = 0; c < 4; c++)
+		{
+			__m128 col = _mm_loadu_ps(m + 4 * c);
+			mv[c] = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(v[0], _mm_shuffle_ps(col, col, _MM_SHUFFLE(0, 0, 0, 0))),
+					_mm_mul_ps(v[1], _mm_shuffle_ps(col, col, _MM_SHUFFLE(1, 1, 1, 1)))),
+				_mm_add_ps(_mm_mul_ps(v[2], _mm_shuffle_ps(col, col, _MM_SHUFFLE(2, 2, 2, 2))),
+					_mm_mul_ps(v[3], _mm_shuffle_ps(col, col, _MM_SHUFFLE(3, 3, 3, 3)))));
+
+			__m128 mvp = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(p[0], _mm_shuffle_ps(mv[c], mv[c], _MM_SHUFFLE(0, 0, 0, 0))),
+					_mm_mul_ps(p[1], _mm_shuffle_ps(mv[c], mv[c], _MM_SHUFFLE(1, 1, 1, 1)))),
+				_mm_add_ps(_mm_mul_ps(p[2], _mm_shuffle_ps(mv[c], mv[c], _MM_SHUFFLE(2, 2, 2, 2))),
+					_mm_mul_ps(p[3], _mm_shuffle_ps(mv[c], mv[c], _MM_SHUFFLE(3, 3, 3, 3)))));
+
+			_mm_storeu_ps(glm::value_ptr(o.model_view[c]), mv[c]);
+			_mm_storeu_ps(glm::value_ptr(o.mvp[c]), mvp);
+		}
+
+		//u x w = u.yzx * w.zxy - u.zxy * w.yzx, the w lanes cancel
+		__m128 yzx[3], zxy[3];
+		for (int c = 0; c < 3; c++)
+		{
+			yzx[c] = _mm_shuffle_ps(mv[c], mv[c], _MM_SHUFFLE(3, 0, 2, 1));
+			zxy[c] = _mm_shuffle_ps(mv[c], mv[c], _MM_SHUFFLE(3, 1, 0, 2));
+		}
+		__m128 n0 = _mm_sub_ps(_mm_mul_ps(yzx[1], zxy[2]), _mm_mul_ps(zxy[1], yzx[2]));
+		__m128 n1 = _mm_sub_ps(_mm_mul_ps(yzx[2], zxy[0]), _mm_mul_ps(zxy[2], yzx[0]));
+		__m128 n2 = _mm_sub_ps(_mm_mul_ps(yzx[0], zxy[1]), _mm_mul_ps(zxy[0], yzx[1]));
+
+		//det = a . (b x c), a's w lane is 0 for an affine model matrix
+		float d[4];
+		_mm_storeu_ps(d, _mm_mul_ps(mv[0], n0));
+		float det = d[0] + d[1] + d[2];
+		__m128 inv_det = _mm_set1_ps(fabs(det) > 1e-30f ? 1.0f / det : 1.0f);	//the shaders normalize anyway
+
+		_mm_storeu_ps(glm::value_ptr(o.normal[0]), _mm_mul_ps(n0, inv_det));
+		_mm_storeu_ps(glm::value_ptr(o.normal[1]), _mm_mul_ps(n1, inv_det));
+		_mm_storeu_ps(glm::value_ptr(o.normal[2]), _mm_mul_ps(n2, inv_det));
+	}
+#else
+	for (int i = 0; i < count; i++)
+	{
+		InstanceData& o = out[i];
+		o.model_view = view * models[i];
+		o.mvp = proj * o.model_view;
+
+		glm::vec3 a(o.model_view[0]), b(o.model_view[1]), c(o.model_view[2]);
+		glm::vec3 n0 = glm::cross(b, c), n1 = glm::cross(c, a), n2 = glm::cross(a, b);
+		float det = glm::dot(a, n0);
+		float inv_det = fabs(det) > 1e-30f ? 1.0f / det : 1.0f;
+
+		o.normal[0] = glm::vec4(n0 * inv_det, 0.0f);
+		o.normal[1] = glm::vec4(n1 * inv_det, 0.0f);
+		o.normal[2] = glm::vec4(n2 * inv_det, 0.0f);
+	}
+#endif
+}
+
+static bool hasDivisors()
+{
+	return GLAD_GL_VERSION_3_3 || GLAD_GL_ARB_instanced_arrays;
+}
+
+//GL 4.3 has both, base instance is what lets a command pick its own instances
+static bool hasMultiDrawIndirect()
+{
+	return GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_ARB_base_instance;
+}
+
+static void attribDivisor(GLuint index, GLuint divisor)
+{
+	if (GLAD_GL_VERSION_3_3) glVertexAttribDivisor(index, divisor);
+	else glVertexAttribDivisorARB(index, divisor);
+}
+
+//instance arrays on, or off so the shaders read the constant attributes
+static void enableInstanceArrays(bool on)
+{
+	for (int a = INSTANCE_MVP_ATTRIB; a <= INSTANCE_MESH_ATTRIB; a++)
+	{
+		if (on) glEnableVertexAttribArray(a);
+		else glDisableVertexAttribArray(a);
+	}
+}
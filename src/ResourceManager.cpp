@@ -0,0 +1,863 @@
+#include "ResourceManager.h"
+
+#include <cstdio>
+#include <iostream>
+#include <memory>
+
+#include "Util.h"
+#include "MappedFile.h"
+#include "ModelCache.h"
+#include "MeshWeld.h"
+#include "MeshOptimize.h"
+#include "MeshSimplify.h"
+#include "ShaderCache.h"
+#include "TextureCache.h"
+
+#include "timerutil.h"
+#include "tiny_obj_loader.h"
+
+//decoded asset data waiting for its GL upload
+//decoders always succeed and leave ok unset instead, so the upload step runs
+//and can mark the resource failed
+struct MeshSource
+{
+	bool ok = false;
+	PackedMesh packed;
+};
+
+struct TextureSource
+{
+	bool ok = false;
+	MappedFile cache;
+	vector<uint8_t> pixels;
+	TextureImage image;	//into cache or pixels
+};
+
+struct ProgramSource
+{
+	bool ok = false;
+	string vert;
+	string frag;
+};
+
+//HELPER FUNCTION DECLARATIONS
+static bool DecodeMesh(const string& file, float weld_epsilon, bool optimize_overdraw,
+											 const VertexFormat& fmt, PackedMesh& out);
+static bool TinyOBJLoad(const char* filename, const char* basepath, tinyobj::attrib_t &attrib,
+												vector<tinyobj::shape_t> &shapes, vector<tinyobj::material_t> &materials);
+static bool ImportTXT(const char* filename, vector<float>& soup);
+static bool ImportOBJ(const char* filename, vector<float>& soup);
+static GLuint GrowBuffer(GLuint old_buf, size_t used_bytes, size_t new_bytes);
+static const char* StateName(ResourceState state);
+
+/*----------------------------*/
+// CONSTRUCTORS AND DESTRUCTORS
+/*----------------------------*/
+ResourceManager::ResourceManager(AssetLoader* loader)
+{
+	this->loader = loader;
+}
+
+ResourceManager::~ResourceManager()
+{
+	for (size_t i = 0; i < textures.slots.size(); i++)
+	{
+		if (textures.slots[i].res.tex != 0) glDeleteTextures(1, &textures.slots[i].res.tex);
+	}
+	for (size_t i = 0; i < programs.slots.size(); i++)
+	{
+		if (programs.slots[i].res.shader.getID() != 0) glDeleteProgram(programs.slots[i].res.shader.getID());
+	}
+
+	if (model_vao != 0)
+	{
+		glDeleteBuffers(1, &model_vbo);
+		glDeleteBuffers(1, &model_ibo);
+		glDeleteVertexArrays(1, &model_vao);
+	}
+}
+
+/*----------------------------*/
+// SETTERS
+/*----------------------------*/
+void ResourceManager::setWeldEpsilon(float eps)
+{
+	if (format_fixed) cout << "Weld epsilon can't change once meshes are loaded." << endl;
+	else weld_epsilon = eps;
+}
+
+void ResourceManager::setOptimizeOverdraw(bool on)
+{
+	if (format_fixed) cout << "Overdraw optimization can't change once meshes are loaded." << endl;
+	else optimize_overdraw = on;
+}
+
+void ResourceManager::setVertexFormat(VertexFormat fmt)
+{
+	if (format_fixed) cout << "Vertex format can't change once meshes are loaded." << endl;
+	else vertex_format = fmt;
+}
+
+/*----------------------------*/
+// GETTERS
+/*----------------------------*/
+VertexFormat ResourceManager::getVertexFormat()
+{
+	return vertex_format;
+}
+
+GLuint ResourceManager::getMeshVAO()
+{
+	return model_vao;
+}
+
+const MeshResource* ResourceManager::getMesh(MeshHandle h)
+{
+	Slot<MeshResource>* s = meshes.get(h);
+	return (s != nullptr && s->state == RESOURCE_READY) ? &s->res : nullptr;
+}
+
+const TextureResource* ResourceManager::getTexture(TextureHandle h)
+{
+	Slot<TextureResource>* s = textures.get(h);
+	return (s != nullptr && s->state == RESOURCE_READY) ? &s->res : nullptr;
+}
+
+const ProgramResource* ResourceManager::getProgram(ProgramHandle h)
+{
+	Slot<ProgramResource>* s = programs.get(h);
+	return (s != nullptr && s->state == RESOURCE_READY) ? &s->res : nullptr;
+}
+
+ResourceState ResourceManager::getState(MeshHandle h)
+{
+	Slot<MeshResource>* s = meshes.get(h);
+	return (s != nullptr) ? s->state : RESOURCE_FAILED;
+}
+
+ResourceState ResourceManager::getState(TextureHandle h)
+{
+	Slot<TextureResource>* s = textures.get(h);
+	return (s != nullptr) ? s->state : RESOURCE_FAILED;
+}
+
+ResourceState ResourceManager::getState(ProgramHandle h)
+{
+	Slot<ProgramResource>* s = programs.get(h);
+	return (s != nullptr) ? s->state : RESOURCE_FAILED;
+}
+
+int ResourceManager::getCount(ResourceType type)
+{
+	switch (type)
+	{
+	case RESOURCE_MESH: return meshes.count();
+	case RESOURCE_TEXTURE: return textures.count();
+	case RESOURCE_PROGRAM: return programs.count();
+	default: return 0;
+	}
+}
+
+size_t ResourceManager::getMemory(ResourceType type)
+{
+	switch (type)
+	{
+	case RESOURCE_MESH: return meshes.memory();
+	case RESOURCE_TEXTURE: return textures.memory();
+	case RESOURCE_PROGRAM: return programs.memory();
+	default: return 0;
+	}
+}
+
+/*----------------------------*/
+// OTHERS
+/*----------------------------*/
+MeshHandle ResourceManager::acquireMesh(const string& file)
+{
+	MeshHandle h = meshes.find(file);
+	if (!h.isNull())
+	{
+		Slot<MeshResource>* s = meshes.get(h);
+		if (s->state == RESOURCE_FAILED)
+		{
+			s->state = RESOURCE_LOADING;
+			queueMesh(h, file);
+		}
+		return addRef(h);
+	}
+
+	//meshes are packed on the workers, so the format has to be final before the first is queued
+	if (!format_fixed)
+	{
+		format_fixed = true;
+		vertex_format = vertexformat::supported(vertex_format);
+		cout << "Model vertex size : " << vertexformat::stride(vertex_format) << " bytes ("
+			<< MODEL_VERT_FLOATS * sizeof(float) << " unpacked)" << endl;
+	}
+
+	h = meshes.add(file);
+	queueMesh(h, file);
+	return h;
+}
+
+TextureHandle ResourceManager::acquireTexture(const string& file)
+{
+	TextureHandle h = textures.find(file);
+	if (!h.isNull())
+	{
+		Slot<TextureResource>* s = textures.get(h);
+		if (s->state == RESOURCE_FAILED)
+		{
+			s->state = RESOURCE_LOADING;
+			queueTexture(h, file);
+		}
+		return addRef(h);
+	}
+
+	h = textures.add(file);
+	queueTexture(h, file);
+	return h;
+}
+
+ProgramHandle ResourceManager::acquireProgram(const string& vertFile, const string& fragFile)
+{
+	string key = vertFile + "|" + fragFile;
+	ProgramHandle h = programs.find(key);
+	if (!h.isNull())
+	{
+		Slot<ProgramResource>* s = programs.get(h);
+		if (s->state == RESOURCE_FAILED)
+		{
+			s->state = RESOURCE_LOADING;
+			queueProgram(h, vertFile, fragFile);
+		}
+		return addRef(h);
+	}
+
+	h = programs.add(key);
+	queueProgram(h, vertFile, fragFile);
+	return h;
+}
+
+MeshHandle ResourceManager::addRef(MeshHandle h)
+{
+	Slot<MeshResource>* s = meshes.get(h);
+	if (s != nullptr) s->refs++;
+	return h;
+}
+
+TextureHandle ResourceManager::addRef(TextureHandle h)
+{
+	Slot<TextureResource>* s = textures.get(h);
+	if (s != nullptr) s->refs++;
+	return h;
+}
+
+ProgramHandle ResourceManager::addRef(ProgramHandle h)
+{
+	Slot<ProgramResource>* s = programs.get(h);
+	if (s != nullptr) s->refs++;
+	return h;
+}
+
+void ResourceManager::release(MeshHandle h)
+{
+	Slot<MeshResource>* s = meshes.get(h);
+	if (s != nullptr && s->refs > 0) s->refs--;
+}
+
+void ResourceManager::release(TextureHandle h)
+{
+	Slot<TextureResource>* s = textures.get(h);
+	if (s != nullptr && s->refs > 0) s->refs--;
+}
+
+void ResourceManager::release(ProgramHandle h)
+{
+	Slot<ProgramResource>* s = programs.get(h);
+	if (s != nullptr && s->refs > 0) s->refs--;
+}
+
+int ResourceManager::evictUnused()
+{
+	int evicted = 0;
+	bool meshes_evicted = false;
+
+	//loading resources are skipped, their upload step still points at the slot
+	for (uint32_t i = 0; i < meshes.slots.size(); i++)
+	{
+		Slot<MeshResource>& s = meshes.slots[i];
+		if (!s.live || s.refs > 0 || s.state == RESOURCE_LOADING) continue;
+		printf("Evicting %s (%.1f KB)\n", s.path.c_str(), s.res.bytes / 1024.0);
+		meshes_evicted = meshes_evicted || s.state == RESOURCE_READY;
+		meshes.remove(i);
+		evicted++;
+	}
+
+	for (uint32_t i = 0; i < textures.slots.size(); i++)
+	{
+		Slot<TextureResource>& s = textures.slots[i];
+		if (!s.live || s.refs > 0 || s.state == RESOURCE_LOADING) continue;
+		printf("Evicting %s (%.1f KB)\n", s.path.c_str(), s.res.bytes / 1024.0);
+		if (s.res.tex != 0) glDeleteTextures(1, &s.res.tex);
+		textures.remove(i);
+		evicted++;
+	}
+
+	for (uint32_t i = 0; i < programs.slots.size(); i++)
+	{
+		Slot<ProgramResource>& s = programs.slots[i];
+		if (!s.live || s.refs > 0 || s.state == RESOURCE_LOADING) continue;
+		printf("Evicting %s\n", s.path.c_str());
+		if (s.res.shader.getID() != 0) glDeleteProgram(s.res.shader.getID());
+		programs.remove(i);
+		evicted++;
+	}
+
+	//evicted meshes leave holes in the shared buffers
+	if (meshes_evicted) compactModelBuffers();
+
+	return evicted;
+}
+
+void ResourceManager::printReport()
+{
+	cout << "--------------------------------------------------" << endl;
+	cout << "Resources" << endl;
+
+	for (size_t i = 0; i < meshes.slots.size(); i++)
+	{
+		Slot<MeshResource>& s = meshes.slots[i];
+		if (!s.live) continue;
+		printf("  mesh     %-32s %-8s refs %-3d %8.1f KB\n", s.path.c_str(), StateName(s.state), s.refs, s.res.bytes / 1024.0);
+	}
+	for (size_t i = 0; i < textures.slots.size(); i++)
+	{
+		Slot<TextureResource>& s = textures.slots[i];
+		if (!s.live) continue;
+		printf("  texture  %-32s %-8s refs %-3d %8.1f KB\n", s.path.c_str(), StateName(s.state), s.refs, s.res.bytes / 1024.0);
+	}
+	for (size_t i = 0; i < programs.slots.size(); i++)
+	{
+		Slot<ProgramResource>& s = programs.slots[i];
+		if (!s.live) continue;
+		printf("  program  %-32s %-8s refs %-3d %8.1f KB\n", s.path.c_str(), StateName(s.state), s.refs, s.res.bytes / 1024.0);
+	}
+
+	printf("Meshes %d (%.1f KB), textures %d (%.1f KB), programs %d (%.1f KB)\n",
+		meshes.count(), meshes.memory() / 1024.0, textures.count(), textures.memory() / 1024.0,
+		programs.count(), programs.memory() / 1024.0);
+	cout << "--------------------------------------------------" << endl;
+}
+
+/*----------------------------*/
+// POOL
+/*----------------------------*/
+template <typename Resource, ResourceType T>
+ResourceManager::Slot<Resource>* ResourceManager::Pool<Resource, T>::get(ResourceHandle<T> h)
+{
+	if (h.isNull() || h.index >= slots.size()) return nullptr;
+	Slot<Resource>& s = slots[h.index];
+	return (s.live && s.generation == h.generation) ? &s : nullptr;
+}
+
+template <typename Resource, ResourceType T>
+ResourceHandle<T> ResourceManager::Pool<Resource, T>::find(const string& path)
+{
+	typename unordered_map<string, uint32_t>::iterator it = by_path.find(path);
+	if (it == by_path.end()) return ResourceHandle<T>();
+	return ResourceHandle<T>(it->second, slots[it->second].generation);
+}
+
+template <typename Resource, ResourceType T>
+ResourceHandle<T> ResourceManager::Pool<Resource, T>::add(const string& path)
+{
+	uint32_t index;
+	if (!free_slots.empty())
+	{
+		index = free_slots.back();
+		free_slots.pop_back();
+	}
+	else
+	{
+		index = (uint32_t)slots.size();
+		slots.push_back(Slot<Resource>());
+	}
+
+	Slot<Resource>& s = slots[index];
+	s.path = path;
+	s.refs = 1;
+	s.generation++;
+	s.live = true;
+	s.state = RESOURCE_LOADING;
+	s.res = Resource();
+	by_path[path] = index;
+
+	return ResourceHandle<T>(index, s.generation);
+}
+
+template <typename Resource, ResourceType T>
+void ResourceManager::Pool<Resource, T>::remove(uint32_t index)
+{
+	Slot<Resource>& s = slots[index];
+	by_path.erase(s.path);
+	s.path.clear();
+	s.live = false;
+	s.res = Resource();
+	free_slots.push_back(index);
+}
+
+template <typename Resource, ResourceType T>
+int ResourceManager::Pool<Resource, T>::count()
+{
+	return (int)(slots.size() - free_slots.size());
+}
+
+template <typename Resource, ResourceType T>
+size_t ResourceManager::Pool<Resource, T>::memory()
+{
+	size_t total = 0;
+	for (size_t i = 0; i < slots.size(); i++)
+	{
+		if (slots[i].live && slots[i].state == RESOURCE_READY) total += slots[i].res.bytes;
+	}
+	return total;
+}
+
+/*----------------------------*/
+// PRIVATE FUNCTIONS
+/*----------------------------*/
+//importing, welding, optimizing and packing happen on the loader's worker threads
+void ResourceManager::queueMesh(MeshHandle h, const string& file)
+{
+	bool isOBJ = file.size() > 4 && file.compare(file.size() - 4, 4, ".obj") == 0;
+	shared_ptr<MeshSource> src(new MeshSource());
+	float eps = weld_epsilon;
+	bool overdraw = optimize_overdraw;
+	VertexFormat fmt = vertex_format;
+
+	loader->queue(file, isOBJ ? PRIORITY_OBJ : PRIORITY_MODEL,
+		[src, file, eps, overdraw, fmt]() {
+			src->ok = DecodeMesh(file, eps, overdraw, fmt, src->packed);
+			return true;
+		},
+		[this, src, h]() {
+			bool ok = src->ok && uploadMesh(h, src->packed);
+			src->packed = PackedMesh();	//GL has its own copy now
+
+			Slot<MeshResource>* s = meshes.get(h);
+			if (s != nullptr) s->state = ok ? RESOURCE_READY : RESOURCE_FAILED;
+			return ok;
+		});
+}
+
+//the cached mip chain (or a fresh decode) is read on a worker
+void ResourceManager::queueTexture(TextureHandle h, const string& file)
+{
+	shared_ptr<TextureSource> src(new TextureSource());
+
+	loader->queue(file, PRIORITY_TEXTURE,
+		[src, file]() {
+			src->ok = texcache::load(file, src->cache, src->pixels, src->image);
+			return true;
+		},
+		[this, src, h]() {
+			Slot<TextureResource>* s = textures.get(h);
+			if (s == nullptr || !src->ok)
+			{
+				if (s != nullptr) s->state = RESOURCE_FAILED;
+				return false;
+			}
+
+			const TextureImage& image = src->image;
+			s->res.tex = util::UploadTexture(image);
+			s->res.width = image.width;
+			s->res.height = image.height;
+			s->res.num_levels = image.num_levels;
+			s->res.bytes = 0;
+			for (int l = 0; l < image.num_levels; l++)
+			{
+				s->res.bytes += (size_t)max(1, image.width >> l) * max(1, image.height >> l) * TEXTURE_BYTES_PER_PIXEL;
+			}
+			s->state = RESOURCE_READY;
+
+			src->cache.close();
+			src->pixels.clear();
+			return true;
+		});
+}
+
+//sources are read on a worker, compiled (or pulled from the shader cache) on the GL thread
+void ResourceManager::queueProgram(ProgramHandle h, const string& vertFile, const string& fragFile)
+{
+	shared_ptr<ProgramSource> src(new ProgramSource());
+
+	loader->queue(vertFile + "|" + fragFile, PRIORITY_SHADER,
+		[src, vertFile, fragFile]() {
+			src->vert = util::ReadShaderFile(vertFile.c_str());
+			src->frag = util::ReadShaderFile(fragFile.c_str());
+			src->ok = !src->vert.empty() && !src->frag.empty();
+			return true;
+		},
+		[this, src, h]() {
+			Slot<ProgramResource>* s = programs.get(h);
+			GLuint program = src->ok ? util::CompileShader(src->vert.c_str(), src->frag.c_str()) : (GLuint)-1;
+			if (s == nullptr || program == (GLuint)-1)
+			{
+				if (s != nullptr) s->state = RESOURCE_FAILED;
+				return false;
+			}
+
+			s->res.shader = ShaderProgram(program);
+			GLint length = 0;
+			if (shadercache::supported()) glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+			s->res.bytes = (size_t)max(length, 0);
+			s->state = RESOURCE_READY;
+			return true;
+		});
+}
+
+//GL thread : appends a packed mesh to model_vbo / model_ibo
+bool ResourceManager::uploadMesh(MeshHandle h, PackedMesh& mesh)
+{
+	Slot<MeshResource>* s = meshes.get(h);
+	if (s == nullptr || mesh.verts.empty() || mesh.indices.empty() || mesh.lods.empty()) return false;
+
+	if (model_vao == 0) createModelBuffers();
+
+	size_t vert_bytes = mesh.verts.size();
+	size_t index_bytes = mesh.indices.size();
+
+	//keep every mesh's indices aligned to their own size
+	size_t index_offset = (model_ibo_bytes + 3) & ~(size_t)3;
+
+	MeshResource& res = s->res;
+	res.index_type = vertexformat::indexType(mesh.index_size);
+	res.index_offset = index_offset;
+	res.num_indices = (int)mesh.lods[0].num_indices;
+	res.num_lods = min((int)mesh.lods.size(), MAX_MESH_LODS);
+	for (int i = 0; i < res.num_lods; i++) res.lods[i] = mesh.lods[i];
+	res.base_vertex = total_model_verts;
+	res.num_verts = mesh.num_verts;
+	res.quant = mesh.quant;
+	res.bounds = mesh.bounds;
+	res.index_bytes = index_bytes;
+	res.bytes = vert_bytes + index_bytes;
+
+	size_t stride = vertexformat::stride(vertex_format);
+	growModelBuffers((total_model_verts + mesh.num_verts) * stride, index_offset + index_bytes);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, model_vbo);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, total_model_verts * stride, vert_bytes, &mesh.verts[0]);
+
+	//indices stay relative to the mesh, draws add the base vertex
+	glBindBuffer(GL_COPY_WRITE_BUFFER, model_ibo);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, index_offset, index_bytes, &mesh.indices[0]);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	total_model_verts += mesh.num_verts;
+	model_ibo_bytes = index_offset + index_bytes;
+
+	printf("Uploaded %s : %d vertices (%.1f KB), %d %d-bit indices in %d LODs\n", s->path.c_str(), mesh.num_verts,
+		vert_bytes / 1024.0, mesh.num_indices, mesh.index_size * 8, res.num_lods);
+
+	return true;
+}
+
+//GL thread : builds the shared VAO with empty buffers
+//the welded sizes are only known once each mesh is decoded, so both buffers grow as meshes are uploaded
+void ResourceManager::createModelBuffers()
+{
+	//This stores the VBO and attribute mappings in one object
+	glGenVertexArrays(1, &model_vao);
+	glBindVertexArray(model_vao);
+
+	glGenBuffers(1, &model_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, model_vbo);
+	glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &model_ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model_ibo); //the element buffer binding is part of the VAO state
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
+
+	setModelAttribs();
+
+	glBindVertexArray(0);
+}
+
+//GL thread : makes room for vbo_bytes / ibo_bytes in model_vbo / model_ibo, keeping what was uploaded
+//meshes arrive one at a time, so a buffer that has to grow at least doubles and
+//appending stays linear in the total size however many meshes there are
+void ResourceManager::growModelBuffers(size_t vbo_bytes, size_t ibo_bytes)
+{
+	bool grown = false;
+	if (vbo_bytes > model_vbo_capacity)
+	{
+		size_t used_vbo_bytes = total_model_verts * vertexformat::stride(vertex_format);
+		model_vbo_capacity = max(vbo_bytes, 2 * model_vbo_capacity);
+		model_vbo = GrowBuffer(model_vbo, used_vbo_bytes, model_vbo_capacity);
+		grown = true;
+	}
+	if (ibo_bytes > model_ibo_capacity)
+	{
+		model_ibo_capacity = max(ibo_bytes, 2 * model_ibo_capacity);
+		model_ibo = GrowBuffer(model_ibo, model_ibo_bytes, model_ibo_capacity);
+		grown = true;
+	}
+	if (!grown) return;
+
+	//the VAO still references the old buffers
+	glBindVertexArray(model_vao);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model_ibo);
+	setModelAttribs();
+	glBindVertexArray(0);
+}
+
+//GL thread : copies the ready meshes into fresh, tightly packed buffers
+//handles stay valid, only the offsets in their MeshResource move
+void ResourceManager::compactModelBuffers()
+{
+	if (model_vao == 0) return;
+
+	size_t stride = vertexformat::stride(vertex_format);
+	size_t vbo_bytes = 0;
+	size_t ibo_bytes = 0;
+	for (size_t i = 0; i < meshes.slots.size(); i++)
+	{
+		Slot<MeshResource>& s = meshes.slots[i];
+		if (!s.live || s.state != RESOURCE_READY) continue;
+		vbo_bytes += s.res.num_verts * stride;
+		ibo_bytes = ((ibo_bytes + 3) & ~(size_t)3) + s.res.index_bytes;
+	}
+
+	GLuint new_vbo, new_ibo;
+	glGenBuffers(1, &new_vbo);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, new_vbo);
+	glBufferData(GL_COPY_WRITE_BUFFER, vbo_bytes, NULL, GL_STATIC_DRAW);
+	glGenBuffers(1, &new_ibo);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, new_ibo);
+	glBufferData(GL_COPY_WRITE_BUFFER, ibo_bytes, NULL, GL_STATIC_DRAW);
+
+	int verts = 0;
+	size_t index_bytes = 0;
+	for (size_t i = 0; i < meshes.slots.size(); i++)
+	{
+		Slot<MeshResource>& s = meshes.slots[i];
+		if (!s.live || s.state != RESOURCE_READY) continue;
+
+		MeshResource& res = s.res;
+		size_t mesh_vbo_bytes = res.num_verts * stride;
+		size_t index_offset = (index_bytes + 3) & ~(size_t)3;
+
+		glBindBuffer(GL_COPY_READ_BUFFER, model_vbo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, new_vbo);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, res.base_vertex * stride, verts * stride, mesh_vbo_bytes);
+
+		glBindBuffer(GL_COPY_READ_BUFFER, model_ibo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, new_ibo);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, res.index_offset, index_offset, res.index_bytes);
+
+		res.base_vertex = verts;
+		res.index_offset = index_offset;
+		verts += res.num_verts;
+		index_bytes = index_offset + res.index_bytes;
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glDeleteBuffers(1, &model_vbo);
+	glDeleteBuffers(1, &model_ibo);
+	model_vbo = new_vbo;
+	model_ibo = new_ibo;
+
+	printf("Compacted model buffers : %d -> %d vertices, %.1f -> %.1f KB of indices\n", total_model_verts, verts,
+		model_ibo_bytes / 1024.0, index_bytes / 1024.0);
+	total_model_verts = verts;
+	model_ibo_bytes = index_bytes;
+	model_vbo_capacity = vbo_bytes;
+	model_ibo_capacity = ibo_bytes;
+
+	glBindVertexArray(model_vao);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model_ibo);
+	setModelAttribs();
+	glBindVertexArray(0);
+}
+
+//points the bound VAO's attributes at model_vbo
+void ResourceManager::setModelAttribs()
+{
+	//Tell OpenGL how to set shader input (how the data in the VBO is organized)
+	//attribute locations are fixed by util::CompileShader, so no program is needed yet
+	glBindBuffer(GL_ARRAY_BUFFER, model_vbo);
+	vertexformat::setAttribs(vertex_format);
+}
+
+/*----------------------------*/
+// HELPER FUNCTIONS
+/*----------------------------*/
+//worker thread : fills out from the binary cache, or imports, welds and
+//optimizes the source file and caches the result for the next run
+static bool DecodeMesh(const string& file, float weld_epsilon, bool optimize_overdraw,
+											 const VertexFormat& fmt, PackedMesh& out)
+{
+	MappedFile cache;
+	MeshData welded;
+	MeshView mesh;
+
+	//mmap the binary cache when it matches the source file
+	if (!modelcache::open(file, weld_epsilon, optimize_overdraw, cache, mesh))
+	{
+		bool isOBJ = file.size() > 4 && file.compare(file.size() - 4, 4, ".obj") == 0;
+
+		vector<float> soup;
+		bool ok = isOBJ ? ImportOBJ(file.c_str(), soup) : ImportTXT(file.c_str(), soup);
+		if (!ok || soup.empty()) return false;
+
+		int soup_verts = (int)soup.size() / MODEL_VERT_FLOATS;
+		meshweld::weld(&soup[0], soup_verts, weld_epsilon, welded);
+		printf("Welded %s : %d -> %d vertices (%.1fx fewer)\n", file.c_str(), soup_verts,
+			welded.numVerts(), soup_verts / (float)max(welded.numVerts(), 1));
+
+		meshopt::optimize(welded, file.c_str(), optimize_overdraw);
+		meshsimplify::generateLODs(welded, file.c_str());
+
+		mesh = MeshView(welded);
+		modelcache::write(file, weld_epsilon, optimize_overdraw, mesh);
+	}
+
+	//the cache keeps full floats, the GPU copy is packed for fmt
+	vertexformat::pack(fmt, mesh, out);
+	return true;
+}
+
+//parses a .txt model into triangle soup
+static bool ImportTXT(const char* filename, vector<float>& soup)
+{
+	MappedFile txt;
+	int num_floats = 0;
+	size_t body_offset = 0;
+	if (!txt.open(filename) || !modelparser::readHeader(txt.getData(), txt.getSize(), num_floats, body_offset))
+	{
+		cout << "\nCan't load model file '" << filename << "'" << endl;
+		return false;
+	}
+
+	soup.resize(num_floats - num_floats % MODEL_VERT_FLOATS);
+	modelparser::ParseStats stats;
+	if (soup.empty() || !modelparser::parseModel(txt, &soup[0], (int)soup.size(), &stats))
+	{
+		cout << "\nFailed to parse model file '" << filename << "'" << endl;
+		return false;
+	}
+
+	printf("Parsed %s (%.2f MB) in %.3f ms on %d thread(s) : %.1f MB/s\n", filename,
+		stats.bytes / (1024.0 * 1024.0), stats.seconds * 1000.0, stats.num_threads, stats.mbPerSec());
+	return true;
+}
+
+//loads an .obj and flattens every shape into triangle soup in the .txt vertex layout
+//missing texcoords become (-1, -1) (no texture) and missing normals (0, 0, 0)
+static bool ImportOBJ(const char* filename, vector<float>& soup)
+{
+	tinyobj::attrib_t attrib;
+	vector<tinyobj::shape_t> shapes;
+	vector<tinyobj::material_t> materials;
+
+	string basepath = filename;
+	basepath = basepath.substr(0, basepath.find_last_of('/') + 1);
+	if (!TinyOBJLoad(filename, basepath.c_str(), attrib, shapes, materials)) return false;
+
+	for (size_t s = 0; s < shapes.size(); s++)
+	{
+		const vector<tinyobj::index_t>& indices = shapes[s].mesh.indices;
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			const tinyobj::index_t& idx = indices[i];
+			float v[MODEL_VERT_FLOATS] = { 0, 0, 0, -1, -1, 0, 0, 0 };
+
+			for (int c = 0; c < 3; c++) v[c] = attrib.vertices[3 * idx.vertex_index + c];
+			if (idx.texcoord_index >= 0)
+			{
+				v[3] = attrib.texcoords[2 * idx.texcoord_index];
+				v[4] = attrib.texcoords[2 * idx.texcoord_index + 1];
+			}
+			if (idx.normal_index >= 0)
+			{
+				for (int c = 0; c < 3; c++) v[5 + c] = attrib.normals[3 * idx.normal_index + c];
+			}
+
+			soup.insert(soup.end(), v, v + MODEL_VERT_FLOATS);
+		}
+	}
+
+	return true;
+}
+
+//new buffer of new_bytes holding the first used_bytes of old_buf, old_buf is deleted
+//(copy targets keep the array / element bindings untouched)
+static GLuint GrowBuffer(GLuint old_buf, size_t used_bytes, size_t new_bytes)
+{
+	GLuint buf;
+	glGenBuffers(1, &buf);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buf);
+	glBufferData(GL_COPY_WRITE_BUFFER, new_bytes, NULL, GL_STATIC_DRAW);
+
+	if (used_bytes > 0)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, old_buf);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used_bytes);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glDeleteBuffers(1, &old_buf);
+	return buf;
+}
+
+static bool TinyOBJLoad(const char* filename, const char* basepath, tinyobj::attrib_t &attrib,
+												vector<tinyobj::shape_t> &shapes, vector<tinyobj::material_t> &materials)
+{
+	cout << "--------------------------------------------------" << endl;
+  cout << "Loading " << filename << "......"<< endl;
+
+  timerutil t;
+  t.start();
+  std::string err;
+  bool ret = tinyobj::LoadObjParallel(&attrib, &shapes, &materials, &err, filename,
+                                      basepath, true);
+  t.end();
+  printf("Parsing time: %lu [msecs]\n", t.msec());
+
+  if (!err.empty()) {
+    cerr << err << endl;
+  }
+
+  if (!ret) {
+    printf("Failed to load/parse .obj.\n");
+    return false;
+  }
+
+	printf("# of vertices  = %d\n", (int)(attrib.vertices.size()) / 3);
+  printf("# of normals   = %d\n", (int)(attrib.normals.size()) / 3);
+  printf("# of texcoords = %d\n", (int)(attrib.texcoords.size()) / 2);
+  printf("# of materials = %d\n", (int)materials.size());
+  printf("# of shapes    = %d\n", (int)shapes.size());
+
+	for (int s = 0; s < shapes.size(); s++)
+	{
+		printf("-->shapes[%i] : %s\n", s, shapes.at(s).name.c_str());
+		printf("----> # of indices = %d\n", (int)shapes.at(s).mesh.indices.size());
+	}
+
+  return true;
+}
+
+static const char* StateName(ResourceState state)
+{
+	switch (state)
+	{
+	case RESOURCE_LOADING: return "loading";
+	case RESOURCE_READY: return "ready";
+	default: return "failed";
+	}
+}
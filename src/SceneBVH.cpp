@@ -0,0 +1,672 @@
+#include "SceneBVH.h"
+
+#include <algorithm>
+#include <cfloat>
+
+//HELPER FUNCTION DECLARATIONS
+static AABB fatten(const AABB& box);
+static bool rayBox(const glm::vec3& origin, const glm::vec3& inv_dir, const AABB& box, float max_t, float& t);
+
+/*----------------------------*/
+// AABB
+/*----------------------------*/
+float AABB::area() const
+{
+	glm::vec3 d = max - min;
+	return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+bool AABB::contains(const AABB& b) const
+{
+	return min.x <= b.min.x && min.y <= b.min.y && min.z <= b.min.z
+		&& max.x >= b.max.x && max.y >= b.max.y && max.z >= b.max.z;
+}
+
+bool AABB::overlaps(const AABB& b) const
+{
+	return min.x <= b.max.x && min.y <= b.max.y && min.z <= b.max.z
+		&& max.x >= b.min.x && max.y >= b.min.y && max.z >= b.min.z;
+}
+
+AABB AABB::merge(const AABB& a, const AABB& b)
+{
+	return AABB(glm::min(a.min, b.min), glm::max(a.max, b.max));
+}
+
+/*----------------------------*/
+// CONSTRUCTORS AND DESTRUCTORS
+/*----------------------------*/
+SceneBVH::SceneBVH()
+{
+	root = -1;
+	num_leaves = 0;
+	internal_area = 0.0;
+	built_cost = 0.0f;
+	rebuild_ratio = 1.5f;
+}
+
+/*----------------------------*/
+// SETTERS
+/*----------------------------*/
+void SceneBVH::setRebuildRatio(float r)
+{
+	rebuild_ratio = r;
+}
+
+/*----------------------------*/
+// GETTERS
+/*----------------------------*/
+int SceneBVH::getCount()
+{
+	return num_leaves;
+}
+
+int SceneBVH::getHeight()
+{
+	return root < 0 ? 0 : height(root);
+}
+
+float SceneBVH::getCost()
+{
+	if (root < 0) return 0.0f;
+	float root_area = nodes[root].box.area();
+	return root_area > 0.0f ? (float)(internal_area / root_area) : 0.0f;
+}
+
+WorldObject* SceneBVH::getObject(int proxy)
+{
+	return leaves[proxy].obj;
+}
+
+AABB SceneBVH::getBounds(int proxy)
+{
+	return leaves[proxy].bounds;
+}
+
+/*----------------------------*/
+// OTHERS
+/*----------------------------*/
+int SceneBVH::insert(WorldObject* obj, const AABB& box)
+{
+	int proxy = addLeaf(obj, box);
+	insertNode(linkLeaf(proxy));
+	return proxy;
+}
+
+void SceneBVH::remove(int proxy)
+{
+	Leaf& l = leaves[proxy];
+	if (!l.live) return;
+
+	if (l.node >= 0)
+	{
+		removeNode(l.node);
+		freeNode(l.node);
+	}
+
+	//queued moves and deferred links are dropped once they see the leaf isn't live
+	l = Leaf();
+	free_leaves.push_back(proxy);
+	num_leaves--;
+}
+
+int SceneBVH::insertDeferred(WorldObject* obj, const AABB& box)
+{
+	int proxy = addLeaf(obj, box);
+	deferred.push_back(proxy);
+	return proxy;
+}
+
+bool SceneBVH::refit(int proxy, const AABB& box)
+{
+	Leaf& l = leaves[proxy];
+	if (!l.live) return false;
+	l.bounds = box;
+	if (l.node < 0) return false;	//deferred, linked with its new bounds
+
+	//still inside the fattened box : nothing above it changes
+	if (nodes[l.node].box.contains(box)) return false;
+
+	//grow the ancestors until one already holds the new box, shrinking them
+	//back would mean recomputing every one up to the root
+	AABB fat = fatten(box);
+	nodes[l.node].box = fat;
+	for (int n = nodes[l.node].parent; n >= 0 && !nodes[n].box.contains(fat); n = nodes[n].parent)
+	{
+		setBox(n, AABB::merge(nodes[n].box, fat));
+	}
+	return true;
+}
+
+void SceneBVH::markMoved(int proxy)
+{
+	if (proxy < 0 || !leaves[proxy].live || leaves[proxy].moved) return;
+	leaves[proxy].moved = true;
+	moved.push_back(proxy);
+}
+
+void SceneBVH::takeMoved(vector<int>& out)
+{
+	out.clear();
+	for (size_t i = 0; i < moved.size(); i++)
+	{
+		Leaf& l = leaves[moved[i]];
+		if (!l.live || !l.moved) continue;
+		l.moved = false;
+		out.push_back(moved[i]);
+	}
+	moved.clear();
+}
+
+bool SceneBVH::maintain()
+{
+	//a few at a time are cheaper inserted, a crowd cheaper rebuilt
+	if (!deferred.empty())
+	{
+		if (deferred.size() * 4 > (size_t)num_leaves)
+		{
+			rebuild();
+			return true;
+		}
+
+		for (size_t i = 0; i < deferred.size(); i++)
+		{
+			int proxy = deferred[i];
+			if (leaves[proxy].live && leaves[proxy].node < 0) insertNode(linkLeaf(proxy));
+		}
+		deferred.clear();
+	}
+
+	if (num_leaves < 3) return false;
+	if (getCost() <= rebuild_ratio * built_cost) return false;
+
+	rebuild();
+	return true;
+}
+
+//top down over the leaves with binned SAH splits, into a fresh node array laid out
+//depth first so a query walks mostly forwards through memory
+void SceneBVH::rebuild()
+{
+	nodes.clear();
+	free_nodes.clear();
+	deferred.clear();
+	internal_area = 0.0;
+	root = -1;
+	built_cost = 0.0f;
+
+	build_refs.clear();
+	build_refs.reserve(num_leaves);
+	AABB centers;
+	for (size_t i = 0; i < leaves.size(); i++)
+	{
+		if (!leaves[i].live) continue;
+
+		BuildRef r;
+		r.bounds = leaves[i].bounds;
+		r.proxy = (int)i;
+		glm::vec3 c = r.bounds.center();
+		centers = build_refs.empty() ? AABB(c, c) : AABB(glm::min(centers.min, c), glm::max(centers.max, c));
+		build_refs.push_back(r);
+	}
+	if (build_refs.empty()) return;
+
+	//n leaves, n - 1 internal nodes, so build never reallocates
+	nodes.reserve(2 * build_refs.size());
+	root = build(0, (int)build_refs.size(), -1, centers);
+	built_cost = getCost();
+}
+
+void SceneBVH::queryAABB(const AABB& box, vector<WorldObject*>& out)
+{
+	if (root < 0) return;
+
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		int n = stack.back();
+		stack.pop_back();
+		if (!nodes[n].box.overlaps(box)) continue;
+
+		if (isLeaf(n))
+		{
+			const Leaf& l = leaves[nodes[n].child[1]];
+			if (l.bounds.overlaps(box)) out.push_back(l.obj);
+			continue;
+		}
+		stack.push_back(nodes[n].child[0]);
+		stack.push_back(nodes[n].child[1]);
+	}
+}
+
+void SceneBVH::querySphere(const glm::vec3& center, float radius, vector<WorldObject*>& out)
+{
+	if (root < 0) return;
+	float r2 = radius * radius;
+
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		int n = stack.back();
+		stack.pop_back();
+
+		//squared distance from the center to the closest point of the box
+		const AABB& b = isLeaf(n) ? leaves[nodes[n].child[1]].bounds : nodes[n].box;
+		glm::vec3 d = center - glm::clamp(center, b.min, b.max);
+		if (glm::dot(d, d) > r2) continue;
+
+		if (isLeaf(n))
+		{
+			out.push_back(leaves[nodes[n].child[1]].obj);
+			continue;
+		}
+		stack.push_back(nodes[n].child[0]);
+		stack.push_back(nodes[n].child[1]);
+	}
+}
+
+void SceneBVH::queryFrustum(const Frustum& frustum, vector<WorldObject*>& inside, vector<WorldObject*>& partial)
+{
+	if (root < 0) return;
+
+	//node and the planes it still has to be tested against, side by side
+	stack.clear();
+	stack.push_back(root);
+	stack.push_back(FRUSTUM_ALL_PLANES);
+	while (!stack.empty())
+	{
+		int mask = stack.back();
+		stack.pop_back();
+		int n = stack.back();
+		stack.pop_back();
+
+		if (isLeaf(n))
+		{
+			//the finer test gets the exact bounds, so the fattened box isn't tested here
+			partial.push_back(leaves[nodes[n].child[1]].obj);
+			continue;
+		}
+
+		const AABB& b = nodes[n].box;
+		FrustumTest t = frustum.classifyBox(b.center(), b.extents(), mask);
+		if (t == FRUSTUM_OUTSIDE) continue;
+
+		if (t == FRUSTUM_INSIDE)
+		{
+			//everything below is visible
+			size_t base = stack.size();
+			stack.push_back(n);
+			while (stack.size() > base)
+			{
+				int m = stack.back();
+				stack.pop_back();
+				if (isLeaf(m)) inside.push_back(leaves[nodes[m].child[1]].obj);
+				else
+				{
+					stack.push_back(nodes[m].child[0]);
+					stack.push_back(nodes[m].child[1]);
+				}
+			}
+			continue;
+		}
+
+		for (int c = 0; c < 2; c++)
+		{
+			stack.push_back(nodes[n].child[c]);
+			stack.push_back(mask);
+		}
+	}
+}
+
+WorldObject* SceneBVH::raycast(const glm::vec3& origin, const glm::vec3& dir, float max_t, float& hit_t)
+{
+	WorldObject* hit = nullptr;
+	hit_t = max_t;
+	if (root < 0) return nullptr;
+
+	//infinities for axis aligned rays are what the slab test wants
+	glm::vec3 inv_dir = 1.0f / dir;
+
+	float t;
+	stack.clear();
+	if (rayBox(origin, inv_dir, nodes[root].box, hit_t, t)) stack.push_back(root);
+	while (!stack.empty())
+	{
+		int n = stack.back();
+		stack.pop_back();
+
+		if (isLeaf(n))
+		{
+			const Leaf& l = leaves[nodes[n].child[1]];
+			if (rayBox(origin, inv_dir, l.bounds, hit_t, t))
+			{
+				hit = l.obj;
+				hit_t = t;
+			}
+			continue;
+		}
+
+		//nearer child popped first, so hit_t shrinks early and prunes the far one
+		float t0, t1;
+		int c0 = nodes[n].child[0], c1 = nodes[n].child[1];
+		bool h0 = rayBox(origin, inv_dir, nodes[c0].box, hit_t, t0);
+		bool h1 = rayBox(origin, inv_dir, nodes[c1].box, hit_t, t1);
+		if (h0 && h1)
+		{
+			if (t0 < t1) swap(c0, c1);
+			stack.push_back(c0);
+			stack.push_back(c1);
+		}
+		else if (h0) stack.push_back(c0);
+		else if (h1) stack.push_back(c1);
+	}
+
+	return hit;
+}
+
+/*----------------------------*/
+// PRIVATE FUNCTIONS
+/*----------------------------*/
+//a live leaf, not in the tree yet
+int SceneBVH::addLeaf(WorldObject* obj, const AABB& box)
+{
+	int proxy;
+	if (!free_leaves.empty())
+	{
+		proxy = free_leaves.back();
+		free_leaves.pop_back();
+	}
+	else
+	{
+		proxy = (int)leaves.size();
+		leaves.push_back(Leaf());
+	}
+
+	Leaf& l = leaves[proxy];
+	l.bounds = box;
+	l.obj = obj;
+	l.node = -1;
+	l.live = true;
+	l.moved = false;
+
+	num_leaves++;
+	return proxy;
+}
+
+//gives a leaf its node, returns the node
+int SceneBVH::linkLeaf(int proxy)
+{
+	int n = allocNode();
+	nodes[n].box = fatten(leaves[proxy].bounds);
+	nodes[n].child[1] = proxy;
+	leaves[proxy].node = n;
+	return n;
+}
+
+int SceneBVH::allocNode()
+{
+	int n;
+	if (!free_nodes.empty())
+	{
+		n = free_nodes.back();
+		free_nodes.pop_back();
+	}
+	else
+	{
+		n = (int)nodes.size();
+		nodes.push_back(Node());
+	}
+
+	nodes[n].box = AABB();
+	nodes[n].parent = -1;
+	nodes[n].child[0] = nodes[n].child[1] = -1;
+	return n;
+}
+
+void SceneBVH::freeNode(int n)
+{
+	if (!isLeaf(n)) internal_area -= nodes[n].box.area();
+	nodes[n].child[0] = nodes[n].child[1] = -1;
+	free_nodes.push_back(n);
+}
+
+void SceneBVH::setBox(int n, const AABB& box)
+{
+	internal_area += (double)box.area() - nodes[n].box.area();
+	nodes[n].box = box;
+}
+
+//links a leaf node in next to the sibling that grows the tree's area the least
+void SceneBVH::insertNode(int leaf_node)
+{
+	if (root < 0)
+	{
+		root = leaf_node;
+		nodes[root].parent = -1;
+		return;
+	}
+
+	AABB box = nodes[leaf_node].box;
+	int index = root;
+	while (!isLeaf(index))
+	{
+		const Node& n = nodes[index];
+		float area = n.box.area();
+		float combined = AABB::merge(n.box, box).area();
+
+		//a new parent here, or the growth of this node plus going further down
+		float here = 2.0f * combined;
+		float inherited = 2.0f * (combined - area);
+
+		float cost[2];
+		for (int c = 0; c < 2; c++)
+		{
+			const Node& child = nodes[n.child[c]];
+			float merged = AABB::merge(child.box, box).area();
+			cost[c] = (isLeaf(n.child[c]) ? merged : merged - child.box.area()) + inherited;
+		}
+
+		if (here < cost[0] && here < cost[1]) break;
+		index = n.child[cost[0] < cost[1] ? 0 : 1];
+	}
+
+	int sibling = index;
+	int old_parent = nodes[sibling].parent;
+	int parent = allocNode();	//may reallocate nodes
+
+	nodes[parent].parent = old_parent;
+	nodes[parent].child[0] = sibling;
+	nodes[parent].child[1] = leaf_node;
+	setBox(parent, AABB::merge(nodes[sibling].box, box));
+	nodes[sibling].parent = parent;
+	nodes[leaf_node].parent = parent;
+
+	if (old_parent < 0) root = parent;
+	else
+	{
+		Node& op = nodes[old_parent];
+		op.child[op.child[0] == sibling ? 0 : 1] = parent;
+		refitUp(old_parent);
+	}
+}
+
+//unlinks a leaf node, its sibling takes the parent's place
+void SceneBVH::removeNode(int leaf_node)
+{
+	if (leaf_node == root)
+	{
+		root = -1;
+		return;
+	}
+
+	int parent = nodes[leaf_node].parent;
+	int grand = nodes[parent].parent;
+	int sibling = nodes[parent].child[nodes[parent].child[0] == leaf_node ? 1 : 0];
+
+	nodes[sibling].parent = grand;
+	freeNode(parent);
+
+	if (grand < 0) root = sibling;
+	else
+	{
+		Node& g = nodes[grand];
+		g.child[g.child[0] == parent ? 0 : 1] = sibling;
+		refitUp(grand);
+	}
+	nodes[leaf_node].parent = -1;
+}
+
+//recomputes boxes from n up, stopping at the first that doesn't change
+void SceneBVH::refitUp(int n)
+{
+	while (n >= 0)
+	{
+		Node& node = nodes[n];
+		AABB box = AABB::merge(nodes[node.child[0]].box, nodes[node.child[1]].box);
+		if (box.min == node.box.min && box.max == node.box.max) break;
+
+		setBox(n, box);
+		n = node.parent;
+	}
+}
+
+//builds build_refs[begin, end) under parent, returns the subtree's node
+//centers : bounds of the leaf centers in the range
+int SceneBVH::build(int begin, int end, int parent, const AABB& centers)
+{
+	if (end - begin == 1)
+	{
+		int n = linkLeaf(build_refs[begin].proxy);
+		nodes[n].parent = parent;
+		return n;
+	}
+
+	int n = allocNode();
+	nodes[n].parent = parent;
+
+	//bin the leaf centers along the longest axis of their bounds
+	glm::vec3 size = centers.max - centers.min;
+	int axis = (size.x > size.y && size.x > size.z) ? 0 : (size.y > size.z ? 1 : 2);
+
+	int mid = (begin + end) / 2;
+	AABB left_centers = centers, right_centers = centers;
+	if (size[axis] > 0.0f)
+	{
+		//twice the center, saves the halving
+		float base = 2.0f * centers.min[axis];
+		float scale = BVH_BINS / (2.0f * size[axis]);
+		auto binOf = [base, scale, axis](const BuildRef& r) {
+			return min((int)((r.bounds.min[axis] + r.bounds.max[axis] - base) * scale), BVH_BINS - 1);
+		};
+
+		//the children's center bounds come out of the bins too, so the
+		//refs are only read twice per level (binning and partitioning)
+		AABB bin_box[BVH_BINS];
+		AABB bin_centers[BVH_BINS];
+		int bin_count[BVH_BINS] = { 0 };
+		for (int i = begin; i < end; i++)
+		{
+			const AABB& bounds = build_refs[i].bounds;
+			glm::vec3 c = bounds.center();
+			int b = binOf(build_refs[i]);
+			if (bin_count[b])
+			{
+				bin_box[b] = AABB::merge(bin_box[b], bounds);
+				bin_centers[b] = AABB(glm::min(bin_centers[b].min, c), glm::max(bin_centers[b].max, c));
+			}
+			else
+			{
+				bin_box[b] = bounds;
+				bin_centers[b] = AABB(c, c);
+			}
+			bin_count[b]++;
+		}
+
+		//area of everything right of each split, swept from the right
+		float right_area[BVH_BINS];
+		AABB acc;
+		int count = 0;
+		for (int b = BVH_BINS - 1; b > 0; b--)
+		{
+			if (bin_count[b]) acc = count ? AABB::merge(acc, bin_box[b]) : bin_box[b];
+			count += bin_count[b];
+			right_area[b] = count ? acc.area() : 0.0f;
+		}
+
+		//split after bin best : left count * left area + right count * right area
+		float best_cost = FLT_MAX;
+		int best = -1;
+		count = 0;
+		for (int b = 0; b < BVH_BINS - 1; b++)
+		{
+			if (bin_count[b]) acc = count ? AABB::merge(acc, bin_box[b]) : bin_box[b];
+			count += bin_count[b];
+			if (count == 0 || count == end - begin) continue;
+
+			float cost = count * acc.area() + (end - begin - count) * right_area[b + 1];
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				best = b;
+			}
+		}
+
+		if (best >= 0)
+		{
+			BuildRef* first = &build_refs[0];
+			BuildRef* split = partition(first + begin, first + end, [&](const BuildRef& r) { return binOf(r) <= best; });
+			mid = (int)(split - first);
+
+			bool left_set = false, right_set = false;
+			for (int b = 0; b < BVH_BINS; b++)
+			{
+				if (!bin_count[b]) continue;
+				bool left = b <= best;
+				AABB& dst = left ? left_centers : right_centers;
+				bool& set = left ? left_set : right_set;
+				dst = set ? AABB::merge(dst, bin_centers[b]) : bin_centers[b];
+				set = true;
+			}
+		}
+	}
+
+	//children first, nodes doesn't reallocate (reserved in rebuild)
+	//(a halved range keeps the parent's center bounds, still containing)
+	int left = build(begin, mid, n, left_centers);
+	int right = build(mid, end, n, right_centers);
+	nodes[n].child[0] = left;
+	nodes[n].child[1] = right;
+	setBox(n, AABB::merge(nodes[left].box, nodes[right].box));
+	return n;
+}
+
+int SceneBVH::height(int n)
+{
+	if (isLeaf(n)) return 1;
+	return 1 + max(height(nodes[n].child[0]), height(nodes[n].child[1]));
+}
+
+/*----------------------------*/
+// HELPER FUNCTIONS
+/*----------------------------*/
+static AABB fatten(const AABB& box)
+{
+	glm::vec3 margin = BVH_FAT_SCALE * (box.max - box.min) + glm::vec3(BVH_FAT_MIN);
+	return AABB(box.min - margin, box.max + margin);
+}
+
+//slab test, t : where the ray enters the box (0 when it starts inside)
+static bool rayBox(const glm::vec3& origin, const glm::vec3& inv_dir, const AABB& box, float max_t, float& t)
+{
+	glm::vec3 t0 = (box.min - origin) * inv_dir;
+	glm::vec3 t1 = (box.max - origin) * inv_dir;
+	glm::vec3 near_t = glm::min(t0, t1);
+	glm::vec3 far_t = glm::max(t0, t1);
+
+	float enter = max(max(near_t.x, near_t.y), max(near_t.z, 0.0f));
+	float exit = min(min(far_t.x, far_t.y), min(far_t.z, max_t));
+	t = enter;
+	return enter <= exit;
+}
@@ -0,0 +1,146 @@
+#include "ShaderCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "Util.h"
+#include "MappedFile.h"
+#include "ModelCache.h"
+
+/*--------------------------------------------------------------*/
+// supported : does the driver expose program binaries
+/*--------------------------------------------------------------*/
+bool shadercache::supported()
+{
+	//glad is generated for 3.3, so a 4.1+ context shows up through the extension
+	if (!GLAD_GL_ARB_get_program_binary || glProgramBinary == NULL) return false;
+
+	//some drivers expose the entry points with no formats to save in
+	GLint num_formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+	return num_formats > 0;
+}
+
+/*--------------------------------------------------------------*/
+// programKey : hash of the sources and the driver strings
+/*--------------------------------------------------------------*/
+uint64_t shadercache::programKey(const char* vertShaderSrc, const char* fragShaderSrc)
+{
+	const char* vendor = (const char*)glGetString(GL_VENDOR);
+	const char* renderer = (const char*)glGetString(GL_RENDERER);
+	const char* version = (const char*)glGetString(GL_VERSION);
+
+	//attribute bindings are baked into the binary as well
+	char attribs[64];
+	snprintf(attribs, sizeof(attribs), "%d %d %d %d %d %d %d %d", POSITION_ATTRIB, TEXCOORD_ATTRIB, NORMAL_ATTRIB,
+		INSTANCE_MVP_ATTRIB, INSTANCE_MODELVIEW_ATTRIB, INSTANCE_NORMAL_ATTRIB, INSTANCE_MATERIAL_ATTRIB,
+		INSTANCE_MESH_ATTRIB);
+
+	string key;
+	const char* parts[] = { vertShaderSrc, fragShaderSrc, vendor, renderer, version, attribs };
+	for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++)
+	{
+		if (parts[i] != NULL) key.append(parts[i]);
+		key.push_back('\0');	//keeps "ab" + "c" apart from "a" + "bc"
+	}
+
+	return modelcache::hashBytes(key.data(), key.size());
+}
+
+/*--------------------------------------------------------------*/
+// cachePath : file holding the binary for key
+/*--------------------------------------------------------------*/
+string shadercache::cachePath(uint64_t key)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "program_%016llx", (unsigned long long)key);
+	return string(SHADER_CACHE_DIR) + name + SHADER_CACHE_EXT;
+}
+
+/*--------------------------------------------------------------*/
+// load : relinks a program from its cached binary
+/*--------------------------------------------------------------*/
+GLuint shadercache::load(uint64_t key)
+{
+	MappedFile cache;
+	string path = cachePath(key);
+	if (!cache.open(path) || cache.getSize() < sizeof(ShaderCacheHeader)) return 0;
+
+	ShaderCacheHeader header;
+	memcpy(&header, cache.getData(), sizeof(header));
+
+	if (header.magic != SHADER_CACHE_MAGIC || header.version != SHADER_CACHE_VERSION || header.key != key
+		|| sizeof(header) + (size_t)header.binary_length > cache.getSize())
+	{
+		cout << "Shader cache " << path << " is invalid, recompiling." << endl;
+		return 0;
+	}
+
+	while (glGetError() != GL_NO_ERROR) {}	//only this call's errors count below
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.binary_format, cache.getData() + sizeof(header), header.binary_length);
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (glGetError() != GL_NO_ERROR || !status)
+	{
+		cout << "Driver rejected shader cache " << path << ", recompiling." << endl;
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	cout << "Loaded program binary " << path << endl;
+	return program;
+}
+
+/*--------------------------------------------------------------*/
+// save : writes the binary of a linked program
+/*--------------------------------------------------------------*/
+bool shadercache::save(uint64_t key, GLuint program)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return false;
+
+	vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, &binary[0]);
+	if (length <= 0) return false;
+
+	ShaderCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = SHADER_CACHE_MAGIC;
+	header.version = SHADER_CACHE_VERSION;
+	header.key = key;
+	header.binary_format = format;
+	header.binary_length = length;
+
+	//write next to the final file and rename so a crash never leaves a torn cache
+	string path = cachePath(key);
+	string tmpPath = path + ".tmp";
+	FILE* out = fopen(tmpPath.c_str(), "wb");
+	if (out == NULL)
+	{
+		cout << "Can't write shader cache " << path << endl;
+		return false;
+	}
+
+	bool ok = fwrite(&header, sizeof(header), 1, out) == 1
+		&& fwrite(&binary[0], 1, length, out) == (size_t)length;
+	ok = (fclose(out) == 0) && ok;
+
+	//rename won't replace an existing file on every platform
+	remove(path.c_str());
+	if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0)
+	{
+		remove(tmpPath.c_str());
+		cout << "Can't write shader cache " << path << endl;
+		return false;
+	}
+
+	cout << "Wrote shader cache " << path << endl;
+	return true;
+}
@@ -0,0 +1,161 @@
+#include "ShaderProgram.h"
+
+#include <vector>
+
+#include "glm/gtc/type_ptr.hpp"
+
+#include "UniformBuffers.h"
+
+//GLSL names of the ShaderUniform entries
+static const char* uniform_names[NUM_UNIFORMS] = {
+	"tex0", "tex1", "texID"
+};
+
+/*----------------------------*/
+// CONSTRUCTORS AND DESTRUCTORS
+/*----------------------------*/
+ShaderProgram::ShaderProgram()
+{
+	program = 0;
+	for (int i = 0; i < NUM_UNIFORMS; i++) locations[i] = -1;
+}
+
+ShaderProgram::ShaderProgram(GLuint linked_program)
+{
+	program = linked_program;
+	reflect();
+}
+
+ShaderProgram::~ShaderProgram()
+{
+}
+
+/*----------------------------*/
+// GETTERS
+/*----------------------------*/
+GLuint ShaderProgram::getID() const
+{
+	return program;
+}
+
+GLint ShaderProgram::getLocation(ShaderUniform u) const
+{
+	return locations[u];
+}
+
+GLint ShaderProgram::getUniformLocation(const string& name) const
+{
+	unordered_map<string, GLint>::const_iterator it = uniforms.find(name);
+	return (it != uniforms.end()) ? it->second : -1;
+}
+
+GLint ShaderProgram::getAttribLocation(const string& name) const
+{
+	unordered_map<string, GLint>::const_iterator it = attribs.find(name);
+	return (it != attribs.end()) ? it->second : -1;
+}
+
+int ShaderProgram::getNumUniforms() const
+{
+	return (int)uniforms.size();
+}
+
+int ShaderProgram::getNumAttribs() const
+{
+	return (int)attribs.size();
+}
+
+/*----------------------------*/
+// OTHERS
+/*----------------------------*/
+void ShaderProgram::use() const
+{
+	glUseProgram(program);
+}
+
+void ShaderProgram::set(ShaderUniform u, int v) const
+{
+	glUniform1i(locations[u], v);
+}
+
+void ShaderProgram::set(ShaderUniform u, bool v) const
+{
+	glUniform1i(locations[u], v ? 1 : 0);
+}
+
+void ShaderProgram::set(ShaderUniform u, float v) const
+{
+	glUniform1f(locations[u], v);
+}
+
+void ShaderProgram::set(ShaderUniform u, const glm::vec2& v) const
+{
+	glUniform2f(locations[u], v[0], v[1]);
+}
+
+void ShaderProgram::set(ShaderUniform u, const glm::vec3& v) const
+{
+	glUniform3f(locations[u], v[0], v[1], v[2]);
+}
+
+void ShaderProgram::set(ShaderUniform u, const glm::mat4& v) const
+{
+	glUniformMatrix4fv(locations[u], 1, GL_FALSE, glm::value_ptr(v));
+}
+
+void ShaderProgram::set2(ShaderUniform u, const float* v) const
+{
+	glUniform2fv(locations[u], 1, v);
+}
+
+void ShaderProgram::set3(ShaderUniform u, const float* v) const
+{
+	glUniform3fv(locations[u], 1, v);
+}
+
+/*----------------------------*/
+// PRIVATE FUNCTIONS
+/*----------------------------*/
+//looks up every active uniform and attribute, then the ShaderUniform locations,
+//and points the shared uniform blocks at their binding points
+void ShaderProgram::reflect()
+{
+	GLint count = 0, max_len = 0;
+
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_len);
+	vector<char> name(max_len > 0 ? max_len : 1);
+	for (GLint i = 0; i < count; i++)
+	{
+		GLint size;
+		GLenum type;
+		glGetActiveUniform(program, i, (GLsizei)name.size(), NULL, &size, &type, &name[0]);
+
+		//arrays are reported as "name[0]", the location of the first element
+		string n = &name[0];
+		GLint loc = glGetUniformLocation(program, n.c_str());
+		if (n.size() > 3 && n.compare(n.size() - 3, 3, "[0]") == 0) n.resize(n.size() - 3);
+		if (loc >= 0) uniforms[n] = loc;	//uniform block members have no location
+	}
+
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_len);
+	name.assign(max_len > 0 ? max_len : 1, '\0');
+	for (GLint i = 0; i < count; i++)
+	{
+		GLint size;
+		GLenum type;
+		glGetActiveAttrib(program, i, (GLsizei)name.size(), NULL, &size, &type, &name[0]);
+		attribs[&name[0]] = glGetAttribLocation(program, &name[0]);
+	}
+
+	for (int i = 0; i < NUM_UNIFORMS; i++) locations[i] = getUniformLocation(uniform_names[i]);
+
+	//GLSL 1.50 has no layout(binding = N), so blocks are bound here
+	GLuint block = glGetUniformBlockIndex(program, FRAME_BLOCK_NAME);
+	if (block != GL_INVALID_INDEX) glUniformBlockBinding(program, block, FRAME_BLOCK_BINDING);
+	block = glGetUniformBlockIndex(program, MATERIAL_BLOCK_NAME);
+	if (block != GL_INVALID_INDEX) glUniformBlockBinding(program, block, MATERIAL_BLOCK_BINDING);
+	block = glGetUniformBlockIndex(program, MESH_BLOCK_NAME);
+	if (block != GL_INVALID_INDEX) glUniformBlockBinding(program, block, MESH_BLOCK_BINDING);
+}
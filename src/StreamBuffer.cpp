@@ -0,0 +1,233 @@
+#include "StreamBuffer.h"
+
+#include <algorithm>
+#include <cstdio>
+
+/*----------------------------*/
+// STREAM STATS
+/*----------------------------*/
+void StreamStats::print() const
+{
+	printf("Streamed: %.1f KB in %d allocations, %d GPU waits (%s)\n", bytes / 1024.0, allocs, waits,
+		persistent ? "persistent" : "mapped per frame");
+}
+
+/*----------------------------*/
+// CONSTRUCTORS AND DESTRUCTORS
+/*----------------------------*/
+StreamBuffer::StreamBuffer()
+{
+	buffer = 0;
+	region_size = 0;
+	wanted_size = STREAM_REGION_BYTES;
+	persistent = false;
+	uniform_alignment = 256;
+	region = 0;
+	head = 0;
+	for (int i = 0; i < STREAM_REGIONS; i++) fences[i] = 0;
+	mapped = nullptr;
+	map_begin = 0;
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	destroy();
+	if (!retired.empty()) glDeleteBuffers((GLsizei)retired.size(), &retired[0]);
+}
+
+/*----------------------------*/
+// GETTERS
+/*----------------------------*/
+const StreamStats& StreamBuffer::getStats()
+{
+	return stats;
+}
+
+size_t StreamBuffer::getRegionSize()
+{
+	return region_size;
+}
+
+/*----------------------------*/
+// OTHERS
+/*----------------------------*/
+void StreamBuffer::beginFrame()
+{
+	if (buffer == 0) create(wanted_size);
+
+	//buffers outgrown last frame, its draws have been issued so GL keeps them alive as long as it needs
+	if (!retired.empty())
+	{
+		glDeleteBuffers((GLsizei)retired.size(), &retired[0]);
+		retired.clear();
+	}
+
+	//the GPU is usually done with a region from STREAM_REGIONS frames ago
+	GLsync fence = fences[region];
+	if (fence != 0)
+	{
+		if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			frame_stats.waits++;
+			GLenum r;
+			do
+			{
+				r = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);	//1 s, in ns
+			} while (r == GL_TIMEOUT_EXPIRED);
+		}
+		glDeleteSync(fence);
+		fences[region] = 0;
+	}
+
+	head = 0;
+	frame_stats.persistent = persistent;
+}
+
+StreamAlloc StreamBuffer::alloc(size_t size, size_t alignment)
+{
+	if (buffer == 0) beginFrame();
+
+	size_t offset = (head + alignment - 1) & ~(alignment - 1);
+	if (offset + size > region_size)
+	{
+		//the old buffer stays bound for what this frame already drew from it
+		size_t bytes = region_size * 2;
+		while (bytes < size + alignment) bytes *= 2;
+		printf("Stream buffer full, growing regions to %.1f KB\n", bytes / 1024.0);
+
+		flush();
+		GLuint old = buffer;
+		buffer = 0;
+		destroy();
+		retired.push_back(old);
+		create(bytes);
+		offset = 0;
+	}
+
+	StreamAlloc a;
+	a.ptr = regionPtr(offset);
+	a.buffer = buffer;
+	a.offset = region * region_size + offset;
+	a.size = size;
+
+	head = offset + size;
+	frame_stats.bytes += size;
+	frame_stats.allocs++;
+	return a;
+}
+
+StreamAlloc StreamBuffer::allocUniform(size_t size)
+{
+	return alloc(size, (size_t)uniform_alignment);
+}
+
+void StreamBuffer::flush()
+{
+	//coherent persistent mappings are seen by every command issued after the write
+	if (persistent || mapped == nullptr) return;
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glFlushMappedBufferRange(GL_COPY_WRITE_BUFFER, 0, head - map_begin);
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	mapped = nullptr;
+}
+
+void StreamBuffer::endFrame()
+{
+	if (buffer == 0) return;
+
+	flush();
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	region = (region + 1) % STREAM_REGIONS;
+
+	stats = frame_stats;
+	frame_stats = StreamStats();
+}
+
+/*----------------------------*/
+// PRIVATE FUNCTIONS
+/*----------------------------*/
+//bytes : a region's size
+void StreamBuffer::create(size_t bytes)
+{
+	size_t total = bytes * STREAM_REGIONS;
+	region_size = bytes;
+	wanted_size = bytes;
+	region = 0;
+	head = 0;
+
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+	uniform_alignment = max(uniform_alignment, 16);
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+
+	persistent = false;
+	if (GLAD_GL_ARB_buffer_storage)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, total, NULL, flags);
+		mapped = (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total, flags);
+		persistent = (mapped != nullptr);
+
+		//immutable storage can't be respecified, so start over with a plain buffer
+		if (!persistent)
+		{
+			glDeleteBuffers(1, &buffer);
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		}
+	}
+	if (!persistent)
+	{
+		glBufferData(GL_COPY_WRITE_BUFFER, total, NULL, GL_STREAM_DRAW);
+		mapped = nullptr;
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void StreamBuffer::destroy()
+{
+	for (int i = 0; i < STREAM_REGIONS; i++)
+	{
+		if (fences[i] != 0) glDeleteSync(fences[i]);
+		fences[i] = 0;
+	}
+
+	if (buffer != 0)
+	{
+		if (mapped != nullptr)
+		{
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &buffer);
+	}
+	buffer = 0;
+	mapped = nullptr;
+	persistent = false;
+}
+
+//CPU address of offset in this frame's region
+//without persistent mapping, the rest of the region is mapped on the first write
+//after beginFrame or flush : unsynchronized since the fence already kept the GPU off
+//it, invalidated since nothing in it is worth keeping
+char* StreamBuffer::regionPtr(size_t offset)
+{
+	size_t region_start = region * region_size;
+	if (persistent) return mapped + region_start + offset;
+
+	if (mapped == nullptr)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT
+			| GL_MAP_FLUSH_EXPLICIT_BIT;
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		mapped = (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, region_start + offset, region_size - offset, flags);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		map_begin = offset;
+	}
+	return mapped + (offset - map_begin);
+}
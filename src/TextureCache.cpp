@@ -0,0 +1,244 @@
+#include "TextureCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "Util.h"
+#include "ModelCache.h"
+
+//HELPER FUNCTION DECLARATIONS
+static int levelCount(int width, int height);
+static size_t levelBytes(int width, int height, int level);
+static void downsample(const uint8_t* src, int src_w, int src_h, uint8_t* dst);
+
+/*--------------------------------------------------------------*/
+// cachePath : sidecar file name for an image
+/*--------------------------------------------------------------*/
+string texcache::cachePath(const string& imageFile)
+{
+	return imageFile + TEXTURE_CACHE_EXT;
+}
+
+/*--------------------------------------------------------------*/
+// open : maps and validates the cache for imageFile
+/*--------------------------------------------------------------*/
+bool texcache::open(const string& imageFile, MappedFile& cache, TextureImage& image)
+{
+	MappedFile source;
+	if (!source.open(imageFile)) return false;
+
+	string path = cachePath(imageFile);
+	if (!cache.open(path)) return false;
+
+	if (cache.getSize() < sizeof(TextureCacheHeader))
+	{
+		cache.close();
+		return false;
+	}
+
+	TextureCacheHeader header;
+	memcpy(&header, cache.getData(), sizeof(header));
+
+	bool valid = header.magic == TEXTURE_CACHE_MAGIC
+		&& header.version == TEXTURE_CACHE_VERSION
+		&& header.bytes_per_pixel == TEXTURE_BYTES_PER_PIXEL
+		&& header.width > 0 && header.height > 0
+		&& header.num_levels == (uint32_t)levelCount(header.width, header.height)
+		&& header.source_size == source.getSize();	//cheap check before hashing
+
+	for (uint32_t l = 0; valid && l < header.num_levels; l++)
+	{
+		valid = header.level_offset[l] % TEXTURE_BYTES_PER_PIXEL == 0
+			&& header.level_offset[l] + levelBytes(header.width, header.height, l) <= cache.getSize();
+	}
+
+	if (valid) valid = header.source_hash == modelcache::hashBytes(source.getData(), source.getSize());
+
+	if (!valid)
+	{
+		cout << "Texture cache " << path << " is stale, decoding." << endl;
+		cache.close();
+		return false;
+	}
+
+	image.width = header.width;
+	image.height = header.height;
+	image.num_levels = header.num_levels;
+	for (uint32_t l = 0; l < header.num_levels; l++)
+	{
+		image.levels[l] = (const uint8_t*)cache.getData() + header.level_offset[l];
+	}
+
+	return true;
+}
+
+/*--------------------------------------------------------------*/
+// convert : surface -> BGRA8 mip chain
+/*--------------------------------------------------------------*/
+bool texcache::convert(SDL_Surface* surface, vector<uint8_t>& pixels, TextureImage& image)
+{
+	//ARGB8888 is a packed 32-bit format, B G R A in memory on little endian
+	//machines and matching GL_UNSIGNED_INT_8_8_8_8_REV everywhere
+	SDL_Surface* argb = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+	if (argb == NULL)
+	{
+		printf("Error: \"%s\"\n", SDL_GetError());
+		return false;
+	}
+
+	image.width = argb->w;
+	image.height = argb->h;
+	image.num_levels = levelCount(argb->w, argb->h);
+
+	size_t total = 0;
+	vector<size_t> offsets(image.num_levels);
+	for (int l = 0; l < image.num_levels; l++)
+	{
+		offsets[l] = total;
+		total += levelBytes(image.width, image.height, l);
+	}
+	pixels.resize(total);
+
+	//level 0 : drop the surface's row padding
+	if (SDL_MUSTLOCK(argb)) SDL_LockSurface(argb);
+	size_t row = (size_t)argb->w * TEXTURE_BYTES_PER_PIXEL;
+	for (int y = 0; y < argb->h; y++)
+	{
+		memcpy(&pixels[y * row], (const uint8_t*)argb->pixels + (size_t)y * argb->pitch, row);
+	}
+	if (SDL_MUSTLOCK(argb)) SDL_UnlockSurface(argb);
+	SDL_FreeSurface(argb);
+
+	//the rest of the chain is built once here instead of glGenerateMipmap every run
+	for (int l = 1; l < image.num_levels; l++)
+	{
+		int w = max(1, image.width >> (l - 1));
+		int h = max(1, image.height >> (l - 1));
+		downsample(&pixels[offsets[l - 1]], w, h, &pixels[offsets[l]]);
+	}
+
+	for (int l = 0; l < image.num_levels; l++) image.levels[l] = &pixels[offsets[l]];
+	return true;
+}
+
+/*--------------------------------------------------------------*/
+// write : builds the cache for imageFile
+/*--------------------------------------------------------------*/
+bool texcache::write(const string& imageFile, const TextureImage& image)
+{
+	MappedFile source;
+	if (!source.open(imageFile)) return false;
+
+	TextureCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = TEXTURE_CACHE_MAGIC;
+	header.version = TEXTURE_CACHE_VERSION;
+	header.width = image.width;
+	header.height = image.height;
+	header.num_levels = image.num_levels;
+	header.bytes_per_pixel = TEXTURE_BYTES_PER_PIXEL;
+	header.source_size = source.getSize();
+	header.source_hash = modelcache::hashBytes(source.getData(), source.getSize());
+
+	uint64_t offset = sizeof(TextureCacheHeader);
+	for (int l = 0; l < image.num_levels; l++)
+	{
+		header.level_offset[l] = offset;
+		offset += levelBytes(image.width, image.height, l);
+	}
+
+	//write next to the final file and rename so a crash never leaves a torn cache
+	string path = cachePath(imageFile);
+	string tmpPath = path + ".tmp";
+	FILE* out = fopen(tmpPath.c_str(), "wb");
+	if (out == NULL)
+	{
+		cout << "Can't write texture cache " << path << endl;
+		return false;
+	}
+
+	bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+	for (int l = 0; ok && l < image.num_levels; l++)
+	{
+		size_t bytes = levelBytes(image.width, image.height, l);
+		ok = fwrite(image.levels[l], 1, bytes, out) == bytes;
+	}
+	ok = (fclose(out) == 0) && ok;
+
+	//rename won't replace an existing file on every platform
+	remove(path.c_str());
+	if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0)
+	{
+		remove(tmpPath.c_str());
+		cout << "Can't write texture cache " << path << endl;
+		return false;
+	}
+
+	cout << "Wrote texture cache " << path << endl;
+	return true;
+}
+
+/*--------------------------------------------------------------*/
+// load : cache when valid, otherwise decode and rebuild it
+/*--------------------------------------------------------------*/
+bool texcache::load(const string& imageFile, MappedFile& cache, vector<uint8_t>& pixels, TextureImage& image)
+{
+	if (open(imageFile, cache, image)) return true;
+
+	SDL_Surface* surface = util::DecodeTexture(imageFile.c_str());
+	if (surface == NULL) return false;
+
+	bool ok = convert(surface, pixels, image);
+	SDL_FreeSurface(surface);
+	if (!ok) return false;
+
+	write(imageFile, image);
+	return true;
+}
+
+/*----------------------------*/
+// HELPER FUNCTIONS
+/*----------------------------*/
+//full mip chain down to 1x1
+static int levelCount(int width, int height)
+{
+	int levels = 1;
+	int size = max(width, height);
+	while (size > 1 && levels < TEXTURE_CACHE_MAX_LEVELS)
+	{
+		size >>= 1;
+		levels++;
+	}
+	return levels;
+}
+
+static size_t levelBytes(int width, int height, int level)
+{
+	return (size_t)max(1, width >> level) * max(1, height >> level) * TEXTURE_BYTES_PER_PIXEL;
+}
+
+//2x2 box filter into the next level (odd edges reuse the last row / column)
+static void downsample(const uint8_t* src, int src_w, int src_h, uint8_t* dst)
+{
+	int dst_w = max(1, src_w >> 1);
+	int dst_h = max(1, src_h >> 1);
+
+	for (int y = 0; y < dst_h; y++)
+	{
+		int y0 = min(2 * y, src_h - 1);
+		int y1 = min(2 * y + 1, src_h - 1);
+		for (int x = 0; x < dst_w; x++)
+		{
+			int x0 = min(2 * x, src_w - 1);
+			int x1 = min(2 * x + 1, src_w - 1);
+			const uint8_t* a = src + ((size_t)y0 * src_w + x0) * TEXTURE_BYTES_PER_PIXEL;
+			const uint8_t* b = src + ((size_t)y0 * src_w + x1) * TEXTURE_BYTES_PER_PIXEL;
+			const uint8_t* c = src + ((size_t)y1 * src_w + x0) * TEXTURE_BYTES_PER_PIXEL;
+			const uint8_t* d = src + ((size_t)y1 * src_w + x1) * TEXTURE_BYTES_PER_PIXEL;
+			uint8_t* out = dst + ((size_t)y * dst_w + x) * TEXTURE_BYTES_PER_PIXEL;
+
+			for (int k = 0; k < TEXTURE_BYTES_PER_PIXEL; k++) out[k] = (uint8_t)((a[k] + b[k] + c[k] + d[k] + 2) / 4);
+		}
+	}
+}
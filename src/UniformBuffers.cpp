@@ -0,0 +1,109 @@
+#include "UniformBuffers.h"
+
+#include <cstdio>
+#include <cstring>
+
+//HELPER FUNCTION DECLARATIONS
+static MaterialBlock toBlock(Material& m);
+
+/*----------------------------*/
+// FRAME UNIFORMS
+/*----------------------------*/
+void FrameUniforms::update(const FrameBlock& frame, StreamBuffer& stream)
+{
+	StreamAlloc a = stream.allocUniform(sizeof(FrameBlock));
+	memcpy(a.ptr, &frame, sizeof(FrameBlock));
+	glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, a.buffer, a.offset, sizeof(FrameBlock));
+}
+
+/*----------------------------*/
+// MATERIAL TABLE
+/*----------------------------*/
+MaterialTable::MaterialTable()
+{
+	dirty_begin = 0;
+	dirty_end = 0;
+	ubo = 0;
+}
+
+MaterialTable::~MaterialTable()
+{
+	if (ubo != 0) glDeleteBuffers(1, &ubo);
+}
+
+int MaterialTable::getCount()
+{
+	return (int)blocks.size();
+}
+
+void MaterialTable::set(int id, Material m)
+{
+	if (id < 0 || id >= (int)blocks.size()) return;
+	blocks[id] = toBlock(m);
+	markDirty(id);
+}
+
+int MaterialTable::add(Material m)
+{
+	MaterialBlock b = toBlock(m);
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		if (memcmp(&blocks[i], &b, sizeof(b)) == 0) return (int)i;
+	}
+
+	if (blocks.size() >= MAX_MATERIALS)
+	{
+		printf("ERROR: More than %d materials, using material 0.\n", MAX_MATERIALS);
+		return 0;
+	}
+
+	blocks.push_back(b);
+	markDirty((int)blocks.size() - 1);
+	return (int)blocks.size() - 1;
+}
+
+void MaterialTable::upload()
+{
+	if (ubo == 0)
+	{
+		//always the full array, so indexing past the used entries stays defined
+		glGenBuffers(1, &ubo);
+		glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+		glBufferData(GL_UNIFORM_BUFFER, MAX_MATERIALS * sizeof(MaterialBlock), NULL, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, ubo);
+	}
+
+	if (dirty_begin < dirty_end)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+		glBufferSubData(GL_UNIFORM_BUFFER, dirty_begin * sizeof(MaterialBlock),
+			(dirty_end - dirty_begin) * sizeof(MaterialBlock), &blocks[dirty_begin]);
+		dirty_begin = dirty_end = 0;
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void MaterialTable::markDirty(int id)
+{
+	if (dirty_begin == dirty_end)
+	{
+		dirty_begin = id;
+		dirty_end = id + 1;
+		return;
+	}
+	if (id < dirty_begin) dirty_begin = id;
+	if (id + 1 > dirty_end) dirty_end = id + 1;
+}
+
+/*----------------------------*/
+// HELPER FUNCTIONS
+/*----------------------------*/
+static MaterialBlock toBlock(Material& m)
+{
+	//no padding between the vec4s, so identical materials compare equal with memcmp
+	MaterialBlock b;
+	b.ka = glm::vec4(m.getAmbient(), 0.0f);
+	b.kd = glm::vec4(m.getDiffuse(), 0.0f);
+	b.ks_s = glm::vec4(m.getSpecular(), m.getNS());
+	return b;
+}
@@ -1,5 +1,8 @@
 #include "Util.h"
 
+#include "timerutil.h"
+#include "ShaderCache.h"
+
 /*--------------------------------------------------------------*/
 // initSDL : initializes SDL and returns window pointer
 /*--------------------------------------------------------------*/
@@ -37,9 +40,46 @@ SDL_Window* util::initSDL(SDL_GLContext& context, float width, float height)
 
 /*--------------------------------------------------------------*/
 // loadModel : loads specified model file into float* (vert array)
-//				returns number of triangles
+//				parsed in parallel straight out of the mmap'd file
 /*--------------------------------------------------------------*/
 float* util::loadModel(string filename, int& num_verts)
+{
+	MappedFile modelFile;
+	int numLines = 0;
+	size_t body_offset = 0;
+
+	if (!modelFile.open(filename)
+		|| !modelparser::readHeader(modelFile.getData(), modelFile.getSize(), numLines, body_offset))
+	{
+		cout << "\nCan't load model file '" << filename << "'" << endl;
+		printf("%s\n", strerror(errno));
+		return nullptr;
+	}
+
+	float* m_array = new float[numLines];
+	modelparser::ParseStats stats;
+	if (!modelparser::parseModel(modelFile, m_array, numLines, &stats))
+	{
+		cout << "\nFailed to parse model file '" << filename << "'" << endl;
+		delete[] m_array;
+		return nullptr;
+	}
+
+	cout << "--------------------------------------------------" << endl;
+	cout << "Loaded model file " << filename << " successfully." << endl;
+
+	printf("Lines : %d\n", numLines);
+	printf("Parsed %.2f MB in %.3f ms on %d thread(s) : %.1f MB/s\n", stats.bytes / (1024.0 * 1024.0),
+		stats.seconds * 1000.0, stats.num_threads, stats.mbPerSec());
+	num_verts = numLines / 8;
+
+	return m_array;
+}
+
+/*--------------------------------------------------------------*/
+// loadModelStream : original ifstream based loadModel
+/*--------------------------------------------------------------*/
+float* util::loadModelStream(string filename, int& num_verts)
 {
 	ifstream modelFile;
 	modelFile.open(filename);
@@ -51,6 +91,9 @@ float* util::loadModel(string filename, int& num_verts)
 		return nullptr;
 	}
 
+	timerutil t;
+	t.start();
+
 	int numLines = 0;
 	modelFile >> numLines; //first number in the model file is the number of lines
 
@@ -62,7 +105,11 @@ float* util::loadModel(string filename, int& num_verts)
 	cout << "--------------------------------------------------" << endl;
 	cout << "Loaded model file " << filename << " successfully." << endl;
 
+	t.end();
+	double mb = (double)modelFile.tellg() / (1024.0 * 1024.0);
+	double ms = t.usec() / 1000.0;
 	printf("Lines : %d\n", numLines);
+	printf("Parsed %.2f MB in %.3f ms with ifstream : %.1f MB/s\n", mb, ms, ms > 0 ? mb / (ms / 1000.0) : 0.0);
 	num_verts = numLines / 8;
 	modelFile.close();
 
@@ -78,26 +125,30 @@ glm::vec3 util::vec3DtoGLM(Vec3D v)
 }
 
 /*--------------------------------------------------------------*/
-// readFile : builds string out of shader file
+// ReadShaderFile : builds string out of shader file
 // copied from:
 // http://www.nexcius.net/2012/11/20/how-to-load-a-glsl-shader-in-opengl-using-c/
 /*--------------------------------------------------------------*/
-std::string readFile(const char *filePath)
+std::string util::ReadShaderFile(const char *filePath)
 {
 	printf("Parsing shader file %s\n", filePath);
 
 	std::string content;
-	std::ifstream fileStream(filePath, std::ios::in);
+	std::ifstream fileStream(filePath, std::ios::in | std::ios::binary);
 
 	if (!fileStream.is_open()) {
 		std::cerr << "Could not read file " << filePath << ". File does not exist." << std::endl;
 		return "";
 	}
 
-	std::string line = "";
-	while (!fileStream.eof()) {
-		std::getline(fileStream, line);
-		content.append(line + "\n");
+	//one read of the whole file instead of a string append per line
+	fileStream.seekg(0, std::ios::end);
+	std::streamoff size = fileStream.tellg();
+	fileStream.seekg(0, std::ios::beg);
+	if (size > 0) {
+		content.resize((size_t)size);
+		fileStream.read(&content[0], size);
+		content.resize((size_t)fileStream.gcount());
 	}
 
 	fileStream.close();
@@ -111,15 +162,31 @@ std::string readFile(const char *filePath)
 /*--------------------------------------------------------------*/
 GLuint util::LoadShader(const char *vertex_path, const char *fragment_path)
 {
+	// Read shaders
+	std::string vertShaderStr = ReadShaderFile(vertex_path);
+	std::string fragShaderStr = ReadShaderFile(fragment_path);
+
+	return CompileShader(vertShaderStr.c_str(), fragShaderStr.c_str());
+}
+
+/*--------------------------------------------------------------*/
+// CompileShader : compiles and links already loaded shader sources
+//				or relinks the program from the shader cache (Shaders/*.pbin)
+/*--------------------------------------------------------------*/
+GLuint util::CompileShader(const char *vertShaderSrc, const char *fragShaderSrc)
+{
+	bool useCache = shadercache::supported();
+	uint64_t cacheKey = 0;
+
+	if (useCache) {
+		cacheKey = shadercache::programKey(vertShaderSrc, fragShaderSrc);
+		GLuint cached = shadercache::load(cacheKey);
+		if (cached != 0) return cached;
+	}
+
 	GLuint vertShader = glCreateShader(GL_VERTEX_SHADER);
 	GLuint fragShader = glCreateShader(GL_FRAGMENT_SHADER);
 
-	// Read shaders
-	std::string vertShaderStr = readFile(vertex_path);
-	std::string fragShaderStr = readFile(fragment_path);
-	const char *vertShaderSrc = vertShaderStr.c_str();
-	const char *fragShaderSrc = fragShaderStr.c_str();
-
 	GLint result = GL_FALSE;
 	int logLength;
 
@@ -164,6 +231,17 @@ GLuint util::LoadShader(const char *vertex_path, const char *fragment_path)
 	GLuint program = glCreateProgram();
 	glAttachShader(program, vertShader);
 	glAttachShader(program, fragShader);
+
+	//same attribute layout for every program (names a shader lacks are ignored)
+	glBindAttribLocation(program, POSITION_ATTRIB, "position");
+	glBindAttribLocation(program, TEXCOORD_ATTRIB, "inTexcoord");
+	glBindAttribLocation(program, NORMAL_ATTRIB, "inNormal");
+	glBindAttribLocation(program, INSTANCE_MVP_ATTRIB, "instanceMVP");
+	glBindAttribLocation(program, INSTANCE_MODELVIEW_ATTRIB, "instanceModelView");
+	glBindAttribLocation(program, INSTANCE_NORMAL_ATTRIB, "instanceNormalMatrix");
+	glBindAttribLocation(program, INSTANCE_MATERIAL_ATTRIB, "instanceMaterial");
+	glBindAttribLocation(program, INSTANCE_MESH_ATTRIB, "instanceMesh");
+	if (useCache) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(program);
 
 	glGetProgramiv(program, GL_LINK_STATUS, &result);
@@ -175,6 +253,8 @@ GLuint util::LoadShader(const char *vertex_path, const char *fragment_path)
 	glDeleteShader(vertShader);
 	glDeleteShader(fragShader);
 
+	if (useCache && result) shadercache::save(cacheKey, program);
+
 	return program;
 }
 
@@ -182,15 +262,36 @@ GLuint util::LoadShader(const char *vertex_path, const char *fragment_path)
 // LoadTexture :
 /*--------------------------------------------------------------*/
 GLuint util::LoadTexture(const char * texFile)
+{
+	MappedFile cache;
+	vector<uint8_t> pixels;
+	TextureImage image;
+
+	if (!texcache::load(texFile, cache, pixels, image)) return -1;
+
+	return UploadTexture(image);
+}
+
+/*--------------------------------------------------------------*/
+// DecodeTexture : reads the image into a surface (no GL calls)
+/*--------------------------------------------------------------*/
+SDL_Surface* util::DecodeTexture(const char* texFile)
 {
 	printf("Loading %s texture.\n", texFile);
 	SDL_Surface* surface = SDL_LoadBMP(texFile);
 
 	if (surface == NULL) { //If it failed, print the error
 		printf("Error: \"%s\"\n", SDL_GetError());
-		return -1;
 	}
 
+	return surface;
+}
+
+/*--------------------------------------------------------------*/
+// UploadTexture : builds a GL texture out of a cached mip chain
+/*--------------------------------------------------------------*/
+GLuint util::UploadTexture(const TextureImage& image)
+{
 	GLuint tex;
 	glGenTextures(1, &tex);
 
@@ -202,13 +303,15 @@ GLuint util::LoadTexture(const char * texFile)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.num_levels - 1);
 
 	//Load the texture into memory
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, surface->w, surface->h, 0, GL_BGR, GL_UNSIGNED_BYTE, surface->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-
-	SDL_FreeSurface(surface);
+	//the pixels are already in the format GL stores, so this is a straight copy
+	for (int l = 0; l < image.num_levels; l++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, max(1, image.width >> l), max(1, image.height >> l), 0,
+			GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, image.levels[l]);
+	}
 
 	return tex;
 }
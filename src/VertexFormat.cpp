@@ -0,0 +1,299 @@
+#include "VertexFormat.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "Util.h"
+#include "glm/gtc/packing.hpp"
+
+//HELPER FUNCTION DECLARATIONS
+static int positionSize(PositionFormat f);
+static int texcoordSize(TexcoordFormat f);
+static int normalSize(NormalFormat f);
+static void octEncode(const float* n, uint16_t* out);
+static void bounds(const float* verts, int num_verts, int first, int count, float* lo, float* hi);
+
+/*----------------------------*/
+// CONSTRUCTORS AND DESTRUCTORS
+/*----------------------------*/
+MeshQuantization::MeshQuantization()
+{
+	for (int c = 0; c < 3; c++)
+	{
+		pos_scale[c] = 1;
+		pos_bias[c] = 0;
+	}
+	for (int c = 0; c < 2; c++)
+	{
+		uv_scale[c] = 1;
+		uv_bias[c] = 0;
+	}
+}
+
+/*--------------------------------------------------------------*/
+// stride : bytes per vertex
+/*--------------------------------------------------------------*/
+int vertexformat::stride(const VertexFormat& fmt)
+{
+	return positionSize(fmt.position) + texcoordSize(fmt.texcoord) + normalSize(fmt.normal);
+}
+
+/*--------------------------------------------------------------*/
+// supported : falls back on formats the context can fetch
+/*--------------------------------------------------------------*/
+VertexFormat vertexformat::supported(const VertexFormat& fmt)
+{
+	VertexFormat out = fmt;
+	if (out.normal == NORMAL_SNORM10 && !GLAD_GL_VERSION_3_3 && !GLAD_GL_ARB_vertex_type_2_10_10_10_rev)
+	{
+		cout << "GL_INT_2_10_10_10_REV not supported, using octahedral normals." << endl;
+		out.normal = NORMAL_OCT_SNORM16;
+	}
+	return out;
+}
+
+/*--------------------------------------------------------------*/
+// pack : converts a float mesh to fmt
+/*--------------------------------------------------------------*/
+void vertexformat::pack(const VertexFormat& fmt, const MeshView& mesh, PackedMesh& out)
+{
+	out.quant = MeshQuantization();
+	out.num_verts = mesh.num_verts;
+	out.num_indices = mesh.num_indices;
+
+	/////////////////////////////////
+	//BOUNDS
+	/////////////////////////////////
+	MeshBounds& b = out.bounds;
+	b = MeshBounds();
+	bounds(mesh.verts, mesh.num_verts, 0, 3, b.min, b.max);
+	for (int c = 0; c < 3; c++) b.center[c] = 0.5f * (b.min[c] + b.max[c]);
+
+	//the farthest vertex from the box center, often well inside the box's corners
+	float r2 = 0.0f;
+	for (int i = 0; i < mesh.num_verts; i++)
+	{
+		const float* v = mesh.verts + i * MODEL_VERT_FLOATS;
+		float dx = v[0] - b.center[0], dy = v[1] - b.center[1], dz = v[2] - b.center[2];
+		r2 = max(r2, dx * dx + dy * dy + dz * dz);
+	}
+	b.radius = sqrt(r2);
+
+	/////////////////////////////////
+	//QUANTIZATION RANGES
+	/////////////////////////////////
+	if (fmt.position == POSITION_UNORM16)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			out.quant.pos_bias[c] = b.min[c];
+			out.quant.pos_scale[c] = b.max[c] - b.min[c];
+		}
+	}
+
+	if (fmt.texcoord == TEXCOORD_UNORM16)
+	{
+		float lo[2], hi[2];
+		bounds(mesh.verts, mesh.num_verts, 3, 2, lo, hi);
+		for (int c = 0; c < 2; c++)
+		{
+			out.quant.uv_bias[c] = lo[c];
+			out.quant.uv_scale[c] = hi[c] - lo[c];
+		}
+	}
+
+	/////////////////////////////////
+	//VERTICES
+	/////////////////////////////////
+	int size = stride(fmt);
+	out.verts.assign((size_t)mesh.num_verts * size, 0);
+
+	for (int i = 0; i < mesh.num_verts; i++)
+	{
+		const float* v = mesh.verts + i * MODEL_VERT_FLOATS;
+		uint8_t* dst = &out.verts[(size_t)i * size];
+
+		//position
+		if (fmt.position == POSITION_FLOAT3)
+		{
+			memcpy(dst, v, 3 * sizeof(float));
+		}
+		else
+		{
+			uint16_t q[4] = { 0, 0, 0, 0 };
+			for (int c = 0; c < 3; c++)
+			{
+				float s = out.quant.pos_scale[c];
+				q[c] = glm::packUnorm1x16(s > 0 ? (v[c] - out.quant.pos_bias[c]) / s : 0.0f);
+			}
+			memcpy(dst, q, sizeof(q));
+		}
+		dst += positionSize(fmt.position);
+
+		//texcoord
+		if (fmt.texcoord == TEXCOORD_FLOAT2)
+		{
+			memcpy(dst, v + 3, 2 * sizeof(float));
+		}
+		else
+		{
+			uint16_t q[2];
+			for (int c = 0; c < 2; c++)
+			{
+				if (fmt.texcoord == TEXCOORD_HALF2)
+				{
+					q[c] = glm::packHalf1x16(v[3 + c]);
+				}
+				else
+				{
+					float s = out.quant.uv_scale[c];
+					q[c] = glm::packUnorm1x16(s > 0 ? (v[3 + c] - out.quant.uv_bias[c]) / s : 0.0f);
+				}
+			}
+			memcpy(dst, q, sizeof(q));
+		}
+		dst += texcoordSize(fmt.texcoord);
+
+		//normal
+		if (fmt.normal == NORMAL_FLOAT3)
+		{
+			memcpy(dst, v + 5, 3 * sizeof(float));
+		}
+		else if (fmt.normal == NORMAL_SNORM10)
+		{
+			glm::uint32 q = glm::packSnorm3x10_1x2(glm::vec4(v[5], v[6], v[7], 0.0f));
+			memcpy(dst, &q, sizeof(q));
+		}
+		else
+		{
+			uint16_t q[2];
+			octEncode(v + 5, q);
+			memcpy(dst, q, sizeof(q));
+		}
+	}
+
+	/////////////////////////////////
+	//INDICES
+	/////////////////////////////////
+	out.index_size = (mesh.num_verts <= 65535) ? 2 : 4;
+	out.indices.resize((size_t)mesh.num_indices * out.index_size);
+
+	if (out.index_size == 4)
+	{
+		memcpy(&out.indices[0], mesh.indices, out.indices.size());
+	}
+	else
+	{
+		uint16_t* dst = (uint16_t*)&out.indices[0];
+		for (int i = 0; i < mesh.num_indices; i++) dst[i] = (uint16_t)mesh.indices[i];
+	}
+
+	//a mesh without LODs is its own LOD 0
+	if (mesh.num_lods > 0)
+	{
+		out.lods.assign(mesh.lods, mesh.lods + mesh.num_lods);
+	}
+	else
+	{
+		MeshLOD full;
+		full.first_index = 0;
+		full.num_indices = (uint32_t)mesh.num_indices;
+		full.error = 0.0f;
+		out.lods.assign(1, full);
+	}
+}
+
+/*--------------------------------------------------------------*/
+// setAttribs : attribute pointers for fmt
+/*--------------------------------------------------------------*/
+void vertexformat::setAttribs(const VertexFormat& fmt)
+{
+	GLsizei size = stride(fmt);
+	size_t offset = 0;
+
+	//Attribute, vals/attrib., type, normalized?, stride, offset
+	if (fmt.position == POSITION_FLOAT3) glVertexAttribPointer(POSITION_ATTRIB, 3, GL_FLOAT, GL_FALSE, size, (void*)offset);
+	else glVertexAttribPointer(POSITION_ATTRIB, 3, GL_UNSIGNED_SHORT, GL_TRUE, size, (void*)offset);
+	glEnableVertexAttribArray(POSITION_ATTRIB);
+	offset += positionSize(fmt.position);
+
+	if (fmt.texcoord == TEXCOORD_FLOAT2) glVertexAttribPointer(TEXCOORD_ATTRIB, 2, GL_FLOAT, GL_FALSE, size, (void*)offset);
+	else if (fmt.texcoord == TEXCOORD_HALF2) glVertexAttribPointer(TEXCOORD_ATTRIB, 2, GL_HALF_FLOAT, GL_FALSE, size, (void*)offset);
+	else glVertexAttribPointer(TEXCOORD_ATTRIB, 2, GL_UNSIGNED_SHORT, GL_TRUE, size, (void*)offset);
+	glEnableVertexAttribArray(TEXCOORD_ATTRIB);
+	offset += texcoordSize(fmt.texcoord);
+
+	if (fmt.normal == NORMAL_FLOAT3) glVertexAttribPointer(NORMAL_ATTRIB, 3, GL_FLOAT, GL_FALSE, size, (void*)offset);
+	else if (fmt.normal == NORMAL_SNORM10) glVertexAttribPointer(NORMAL_ATTRIB, 4, GL_INT_2_10_10_10_REV, GL_TRUE, size, (void*)offset);
+	else glVertexAttribPointer(NORMAL_ATTRIB, 2, GL_SHORT, GL_TRUE, size, (void*)offset);
+	glEnableVertexAttribArray(NORMAL_ATTRIB);
+}
+
+/*--------------------------------------------------------------*/
+// indexType : GL type of an index size
+/*--------------------------------------------------------------*/
+GLenum vertexformat::indexType(int index_size)
+{
+	return (index_size == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+/*----------------------------*/
+// HELPER FUNCTIONS
+/*----------------------------*/
+static int positionSize(PositionFormat f)
+{
+	return (f == POSITION_FLOAT3) ? 3 * sizeof(float) : 4 * sizeof(uint16_t);
+}
+
+static int texcoordSize(TexcoordFormat f)
+{
+	return (f == TEXCOORD_FLOAT2) ? 2 * sizeof(float) : 2 * sizeof(uint16_t);
+}
+
+static int normalSize(NormalFormat f)
+{
+	return (f == NORMAL_FLOAT3) ? 3 * sizeof(float) : sizeof(uint32_t);
+}
+
+//octahedral mapping : the normal is projected onto |x|+|y|+|z| = 1 and the
+//lower half folded over the upper one (zero normals come out as +z)
+static void octEncode(const float* n, uint16_t* out)
+{
+	float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+	float x = 0, y = 0;
+	if (l1 > 0)
+	{
+		x = n[0] / l1;
+		y = n[1] / l1;
+		if (n[2] < 0)
+		{
+			float fx = (1.0f - fabsf(y)) * (x >= 0 ? 1.0f : -1.0f);
+			float fy = (1.0f - fabsf(x)) * (y >= 0 ? 1.0f : -1.0f);
+			x = fx;
+			y = fy;
+		}
+	}
+
+	out[0] = glm::packSnorm1x16(x);
+	out[1] = glm::packSnorm1x16(y);
+}
+
+//per component min / max of count floats starting at first in every vertex
+static void bounds(const float* verts, int num_verts, int first, int count, float* lo, float* hi)
+{
+	for (int c = 0; c < count; c++)
+	{
+		lo[c] = num_verts > 0 ? verts[first + c] : 0;
+		hi[c] = lo[c];
+	}
+
+	for (int i = 0; i < num_verts; i++)
+	{
+		const float* v = verts + i * MODEL_VERT_FLOATS + first;
+		for (int c = 0; c < count; c++)
+		{
+			if (v[c] < lo[c]) lo[c] = v[c];
+			if (v[c] > hi[c]) hi[c] = v[c];
+		}
+	}
+}
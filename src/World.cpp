@@ -1,38 +1,50 @@
 #include "World.h"
 
+#include "Profiler.h"
+
 using namespace std;
 
-//HELPER FUNCTION DECLARATIONS
-static bool TinyOBJLoad(const char* filename, const char* basepath, tinyobj::attrib_t &attrib,
-												vector<tinyobj::shape_t> &shapes, vector<tinyobj::material_t> &materials);
+const char* World::model_files[NUM_MODELS] = { "models/cube.txt", "models/sphere.txt", "models/cylinder.obj",
+	"models/teapot.txt", "models/knot.txt" };
+const char* World::texture_files[NUM_TEXTURES] = { "textures/wood.bmp", "textures/grey_stones.bmp" };
+const char* World::bench_scenes[NUM_BENCH_SCENES] = { "cubes", "spheres", "teapots", "knots", "overdraw", "materials", "mixed" };
 
 /*----------------------------*/
 // CONSTRUCTORS AND DESTRUCTORS
 /*----------------------------*/
-World::World()
+World::World(ResourceManager* res)
 {
 	width = 0;
 	height = 0;
+	resources = res;
 }
 
-World::World(int w, int h)
+World::World(int w, int h, ResourceManager* res)
 {
 	width = w;
 	height = h;
+	resources = res;
 }
 
 World::~World()
 {
-	delete[] modelData;
-	delete floor;
-	delete obj;
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		releaseObject(objects[i]);
+		delete objects[i];
+	}
+
+	for (int i = 0; i < NUM_MODELS; i++) resources->release(models[i]);
+	for (int i = 0; i < NUM_TEXTURES; i++) resources->release(textures[i]);
+	resources->release(phongProgram);
 }
 
 void World::init()
 {
 	//initialize floor
 	floor = new WorldObject(Vec3D(0,-0.5*height - 2, 0));
-	floor->setVertexInfo(CUBE_START, CUBE_VERTS);
+	floor->setMesh(resources->addRef(models[CUBE_MODEL]));
+	floor->setTexture(resources->addRef(textures[STONE_TEXTURE]));
 
 	Material mat = Material();
 	mat.setAmbient(glm::vec3(0.7, 0.7, 0.7));
@@ -40,19 +52,159 @@ void World::init()
 	mat.setSpecular(glm::vec3(0, 0, 0));
 
 	floor->setMaterial(mat);
+	floor->setMaterialID(materials.add(mat));
 	floor->setSize(Vec3D(width*5, 0.1, width)); //xz plane
 
 	//initialize obj cylinder
 	obj = new WorldObject(Vec3D(0,-3,0));
-	obj->setVertexInfo(0, total_obj_triangles);
+	obj->setMesh(resources->addRef(models[CYLINDER_MODEL]));	//drawn once the OBJ is uploaded
 	obj->setMaterial(mat);
+	obj->setMaterialID(materials.add(mat));
 	obj->setSize(Vec3D(1,1,1));
-	obj->hasIBO = true;
+
+	//initialize crowd, alternating teapots and knots further and further away
+	Material wood = Material();
+	wood.setAmbient(glm::vec3(0.6, 0.6, 0.6));
+	wood.setDiffuse(glm::vec3(0.8, 0.8, 0.8));
+	wood.setSpecular(glm::vec3(0.2, 0.2, 0.2));
+	int wood_id = materials.add(wood);
+
+	for (int i = 0; i < CROWD_SIZE; i++)
+	{
+		float z = -8.0f - 4.5f * i;	//inside the far plane
+		WorldObject* wobj = new WorldObject(Vec3D((i % 2) ? 6 : -6, -2, z));
+		wobj->setMesh(resources->addRef(models[(i % 2) ? KNOT_MODEL : TEAPOT_MODEL]));
+		wobj->setTexture(resources->addRef(textures[WOOD_TEXTURE]));
+		wobj->setMaterial(wood);
+		wobj->setMaterialID(wood_id);
+		wobj->setSize(Vec3D(2, 2, 2));
+		crowd.push_back(wobj);
+	}
+
+	//the cylinder bounces on BOUNCE_BOTTOM
+	obj->setPos(Vec3D(0, BOUNCE_BOTTOM, 0));
+	obj->setVel(Vec3D(0, sqrt(-2 * BOUNCE_GRAVITY * BOUNCE_HEIGHT), 0));
+	obj->setAcc(Vec3D(0, BOUNCE_GRAVITY, 0));
+
+	objects.push_back(floor);
+	objects.push_back(obj);
+	objects.insert(objects.end(), crowd.begin(), crowd.end());
+
+	//placed in the BVH once their meshes are uploaded
+	unplaced = objects;
+}
+
+//the camera is expected where main puts it : at z = 10 looking down -z
+void World::initBench(BenchScene scene, int count)
+{
+	Material grey = Material();
+	grey.setAmbient(glm::vec3(0.6, 0.6, 0.6));
+	grey.setDiffuse(glm::vec3(0.8, 0.8, 0.8));
+	grey.setSpecular(glm::vec3(0.2, 0.2, 0.2));
+	int grey_id = materials.add(grey);
+
+	if (scene == BENCH_OVERDRAW)
+	{
+		//every layer covers the whole view, only front to back sorting and early depth rejection save fill
+		int layers = min(count, BENCH_OVERDRAW_LAYERS);
+		for (int i = 0; i < layers; i++)
+		{
+			WorldObject* wobj = new WorldObject(Vec3D(0, 0, -20.0f + 0.25f * i));
+			wobj->setMesh(resources->addRef(models[SPHERE_MODEL]));
+			wobj->setTexture(resources->addRef(textures[WOOD_TEXTURE]));
+			wobj->setMaterial(grey);
+			wobj->setMaterialID(grey_id);
+			wobj->setSize(Vec3D(40, 40, 1));
+			objects.push_back(wobj);
+		}
+	}
+	else
+	{
+		//a cube of instances in front of the camera, the far corners outside the view
+		int side = (int)ceil(cbrt((double)count));
+		float spacing = 3.0f;
+		float half = 0.5f * spacing * (side - 1);
+
+		WorldModel model = CUBE_MODEL;
+		if (scene == BENCH_SPHERES) model = SPHERE_MODEL;
+		else if (scene == BENCH_TEAPOTS) model = TEAPOT_MODEL;
+		else if (scene == BENCH_KNOTS) model = KNOT_MODEL;
+		const WorldModel mixed[4] = { CUBE_MODEL, SPHERE_MODEL, TEAPOT_MODEL, KNOT_MODEL };
+
+		for (int i = 0; i < count; i++)
+		{
+			int x = i % side, y = (i / side) % side, z = i / (side * side);
+			WorldObject* wobj = new WorldObject(Vec3D(x * spacing - half, y * spacing - half, -10.0f - z * spacing));
+			wobj->setMesh(resources->addRef(models[(scene == BENCH_MIXED) ? mixed[i % 4] : model]));
+			wobj->setSize(Vec3D(1.5, 1.5, 1.5));
+
+			if (scene == BENCH_MATERIALS)
+			{
+				//colors spread around the hue circle, as many as the table holds
+				float hue = 6.0f * (i % (MAX_MATERIALS - 1)) / (MAX_MATERIALS - 1);
+				glm::vec3 color = glm::clamp(glm::vec3(fabs(hue - 3) - 1, 2 - fabs(hue - 2), 2 - fabs(hue - 4)), 0.0f, 1.0f);
+				Material m = Material();
+				m.setAmbient(0.5f * color);
+				m.setDiffuse(color);
+				m.setSpecular(glm::vec3(0.2, 0.2, 0.2));
+				wobj->setMaterial(m);
+				wobj->setMaterialID(materials.add(m));
+				wobj->setTexture(resources->addRef(textures[(i % 2) ? STONE_TEXTURE : WOOD_TEXTURE]));
+			}
+			else
+			{
+				wobj->setMaterial(grey);
+				wobj->setMaterialID(grey_id);
+				wobj->setTexture(resources->addRef(textures[WOOD_TEXTURE]));
+			}
+			objects.push_back(wobj);
+		}
+	}
+
+	//the objects hold their own references, so whatever this scene doesn't draw
+	//goes at the next evictUnused
+	for (int i = 0; i < NUM_MODELS; i++)
+	{
+		resources->release(models[i]);
+		models[i] = MeshHandle();
+	}
+	for (int i = 0; i < NUM_TEXTURES; i++)
+	{
+		resources->release(textures[i]);
+		textures[i] = TextureHandle();
+	}
+
+	unplaced = objects;
 }
 
 /*----------------------------*/
 // SETTERS
 /*----------------------------*/
+void World::setWeldEpsilon(float eps)
+{
+	resources->setWeldEpsilon(eps);
+}
+
+void World::setOptimizeOverdraw(bool on)
+{
+	resources->setOptimizeOverdraw(on);
+}
+
+void World::setVertexFormat(VertexFormat fmt)
+{
+	resources->setVertexFormat(fmt);
+}
+
+void World::setFreezeFrustum(bool on)
+{
+	freeze_frustum = on;
+}
+
+void World::setViewport(int w, int h)
+{
+	view_width = w;
+	view_height = h;
+}
 
 /*----------------------------*/
 // GETTERS
@@ -67,270 +219,259 @@ int World::getHeight()
 	return height;
 }
 
+const RenderStats& World::getRenderStats()
+{
+	return queue.getStats();
+}
+
+const CullStats& World::getCullStats()
+{
+	return cull_stats;
+}
+
+const StreamStats& World::getStreamStats()
+{
+	return stream.getStats();
+}
+
+bool World::getFreezeFrustum()
+{
+	return freeze_frustum;
+}
+
+SceneBVH* World::getScene()
+{
+	return &scene;
+}
+
 /*----------------------------*/
 // OTHERS
 /*----------------------------*/
-//load in all models and store data into the modelData array
+//queues the model loading
+//importing, welding and optimizing happen on the loader's worker threads
 bool World::loadModelData()
 {
-	/////////////////////////////////
-	//LOAD IN MODELS
-	/////////////////////////////////
-	//CUBE
-	CUBE_START = 0;
-	CUBE_VERTS = 0;
-	float* cubeData = util::loadModel("models/cube.txt", CUBE_VERTS);
-	cout << "\nNumber of vertices in cube model : " << CUBE_VERTS << endl;
-	total_model_verts += CUBE_VERTS;
-
-	//SPHERE
-	SPHERE_START = CUBE_VERTS;
-	SPHERE_VERTS = 0;
-	float* sphereData = util::loadModel("models/sphere.txt", SPHERE_VERTS);
-	cout << "\nNumber of vertices in sphere model : " << SPHERE_VERTS << endl;
-	total_model_verts += SPHERE_VERTS;
-
-	/////////////////////////////////
-	//BUILD MODELDATA ARRAY
-	/////////////////////////////////
-	if (!(cubeData != nullptr && sphereData != nullptr))
-	{
-		delete[] cubeData;
-		delete[] sphereData;
-		return false;
-	}
-	modelData = new float[total_model_verts * 8];
-	//copy data into modelData array
-	copy(cubeData, cubeData + CUBE_VERTS * 8, modelData);
-	copy(sphereData, sphereData + SPHERE_VERTS * 8, modelData + (CUBE_VERTS * 8));
-	delete[] cubeData;
-	delete[] sphereData;
+	for (int i = 0; i < NUM_MODELS; i++) models[i] = resources->acquireMesh(model_files[i]);
 
-	/////////////////////////////////
-	//LOAD IN OBJ
-	/////////////////////////////////
-	if (!TinyOBJLoad("models/cylinder.obj", "models/", obj_attrib, obj_shapes, obj_materials))
-	{
-		return false;
-	}
-
-	total_obj_triangles = (int)obj_attrib.vertices.size() / 3;
-	cout << "\nOBJ loaded successfully" << endl;
-	cout << "--------------------------------------------------" << endl;
 	return true;
 }
 
-//
+//queues the shader and texture loads
+//objects start drawing as soon as their assets have been uploaded
 bool World::setupGraphics()
 {
 	/////////////////////////////////
-	//BUILD MODEL VAO
+	//QUEUE SHADERS
 	/////////////////////////////////
-	//This stores the VBO and attribute mappings in one object
-	glGenVertexArrays(1, &model_vao); //Create a model_vao
-	glBindVertexArray(model_vao); //Bind the above created model_vao to the current context
+	phongProgram = resources->acquireProgram("Shaders/phongTex.vert", "Shaders/phongTex.frag");
 
 	/////////////////////////////////
-	//BUILD MODEL VBO
+	//QUEUE TEXTURES
 	/////////////////////////////////
-	//Allocate memory on the graphics card to store geometry (vertex buffer object)
-	glGenBuffers(1, model_vbo);  //Create 1 buffer called model_vbo
-	glBindBuffer(GL_ARRAY_BUFFER, model_vbo[0]); //Set the model_vbo as the active array buffer (Only one buffer can be active at a time)
-	glBufferData(GL_ARRAY_BUFFER, total_model_verts * 8 * sizeof(float), modelData, GL_STATIC_DRAW); //upload vertices to model_vbo
+	for (int i = 0; i < NUM_TEXTURES; i++) textures[i] = resources->acquireTexture(texture_files[i]);
 
-	/////////////////////////////////
-	//SETUP SHADERS
-	/////////////////////////////////
-	phongProgram = util::LoadShader("Shaders/phongTex.vert", "Shaders/phongTex.frag");
+	glEnable(GL_DEPTH_TEST);
 
-	//load in textures
-	tex0 = util::LoadTexture("textures/wood.bmp");
-	tex1 = util::LoadTexture("textures/grey_stones.bmp");
+	cout << "--------------------------------------------------" << endl;
+	cout << "--------------GRAPHICS SETUP COMPLETE-------------" << endl;
+	cout << "--------------------------------------------------" << endl;
+
+	return true;
+}
+
+//moves every object one tick
+void World::update(float dt)
+{
+	for (size_t i = 0; i < objects.size(); i++) objects[i]->step(dt);
 
-	if (tex0 == -1 || tex1 == -1 || phongProgram == -1)
+	//bounce the cylinder back up, keeping the speed it hit the ground with
+	if (obj == nullptr) return;
+	Vec3D p = obj->getPos();
+	Vec3D v = obj->getVel();
+	if (p.getY() < BOUNCE_BOTTOM && v.getY() < 0)
 	{
-		cout << "\nCan't load texture(s)" << endl;
-		printf(strerror(errno));
-		return false;
+		obj->setVel(Vec3D(v.getX(), -v.getY(), v.getZ()));
 	}
+}
 
-	//Tell OpenGL how to set shader input (how the data in the VBO is organized)
-	GLint posAttrib = glGetAttribLocation(phongProgram, "position");
-	glVertexAttribPointer(posAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), 0); //Attribute, vals/attrib., type, normalized?, stride, offset
-	glEnableVertexAttribArray(posAttrib);
+//submits every WObj to the render queue and draws it
+//also draws floor
+void World::draw(Camera * cam, float alpha)
+{
+	PROFILE_GPU_ZONE("Draw");
 
-	GLint texAttrib = glGetAttribLocation(phongProgram, "inTexcoord");
-	glEnableVertexAttribArray(texAttrib);
-	glVertexAttribPointer(texAttrib, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+	glClearColor(.2f, 0.4f, 0.8f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	GLint normAttrib = glGetAttribLocation(phongProgram, "inNormal");
-	glVertexAttribPointer(normAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
-	glEnableVertexAttribArray(normAttrib);
+	//the region this frame writes, free once the GPU is done with it from STREAM_REGIONS frames ago
+	stream.beginFrame();
 
-	glBindVertexArray(0); //Unbind the vao in case we want to create a new one
+	//build view matrix from Camera
+	glm::mat4 view = glm::lookAt(
+		util::vec3DtoGLM(cam->getPos()),
+		util::vec3DtoGLM(cam->getPos() + cam->getDir()),  //Look at point
+		util::vec3DtoGLM(cam->getUp()));
 
-	/////////////////////////////////
-	//BUILD OBJ VAO
-	/////////////////////////////////
-	glGenVertexArrays(1, &obj_vao);
-	glBindVertexArray(obj_vao);
+	glm::mat4 proj = glm::perspective(2 * cam->getHA(), view_width / (float)view_height, 0.1f, 100.0f); //FOV, aspect, near, far
 
-	/////////////////////////////////
-	//BUILD OBJ VBOs + IBO
-	/////////////////////////////////
-	glGenBuffers(3, obj_vbos);
+	//LODs are picked by how many pixels their error covers
+	glm::vec3 eye = util::vec3DtoGLM(cam->getPos());
+	float proj_scale = view_height / (2 * tan(cam->getHA()));
 
-	//1.1 POSITIONS --> obj_vbos[0]
-	glBindBuffer(GL_ARRAY_BUFFER, obj_vbos[0]);
-	glBufferData(GL_ARRAY_BUFFER, obj_attrib.vertices.size() * sizeof(float), &obj_attrib.vertices.at(0), GL_STATIC_DRAW);
+	//camera and frame constants, written once for every program and object
+	FrameBlock frame;
+	frame.view = view;
+	frame.proj = proj;
+	frame.light_dir = view * glm::vec4(glm::normalize(glm::vec3(-1, 1, -1)), 0.0f); //It's a vector!
+	frame.time = SDL_GetTicks() / 1000.0f;
+	frame.oct_normals = resources->getVertexFormat().normal == NORMAL_OCT_SNORM16;
+	frame.pad[0] = frame.pad[1] = 0.0f;
+	frame_uniforms.update(frame, stream);
 
-	//1.2 setup position attributes --> need to set now while obj_vbos[0] is bound
-	GLint obj_posAttrib = glGetAttribLocation(phongProgram, "position");
-	glVertexAttribPointer(obj_posAttrib, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
-	glEnableVertexAttribArray(obj_posAttrib);
+	//only materials added or changed since the last frame are written
+	materials.upload();
 
-	//2.1 NORMALS --> obj_vbos[1]
-	if (obj_attrib.normals.size() == 0)
+	//objects that moved since the last frame
 	{
-		//fill with (0,0,0) normal vectors
-		for (int i = 0; i < total_obj_triangles*3; i++)	//same number of normals as vertices
+		PROFILE_ZONE("Cull");
+		updateScene();
+
+		//cull against the same matrices the shaders use, unless the frustum is frozen
+		if (!freeze_frustum) frustum.setFromMatrix(proj * view);
+
+		inside.clear();
+		partial.clear();
+		scene.queryFrustum(frustum, inside, partial);
+
+		culler.clear();
+		cull_objects.clear();
+		for (size_t i = 0; i < partial.size(); i++)
 		{
-			obj_attrib.normals.push_back(0);
-			obj_attrib.normals.push_back(0);
-			obj_attrib.normals.push_back(0);
+			glm::vec3 center, extents;
+			float radius;
+			if (!getObjectBounds(partial[i], center, extents, radius)) continue;
+			culler.add(center, extents, radius);
+			cull_objects.push_back(partial[i]);
 		}
-	}
+		culler.cull(frustum, visible, cull_stats);
 
-	glBindBuffer(GL_ARRAY_BUFFER, obj_vbos[1]);
-	glBufferData(GL_ARRAY_BUFFER, obj_attrib.normals.size() * sizeof(float), &obj_attrib.normals.at(0), GL_STATIC_DRAW);
-
-	//2.2 setup normal attributes
-	GLint obj_normAttrib = glGetAttribLocation(phongProgram, "inNormal");
-	glVertexAttribPointer(obj_normAttrib, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
-	glEnableVertexAttribArray(obj_normAttrib);
+		cull_stats.tested = scene.getCount();
+		cull_stats.visible += (int)inside.size();
+		cull_stats.culled = cull_stats.tested - cull_stats.visible;
+		cull_stats.frozen = freeze_frustum;
+	}
 
-	//3.1 TEXCOORDS --> obj_vbos[2]
-	if (obj_attrib.texcoords.size() == 0)
+	//visible objects, sorted by state and depth
+	//(objects appear once their program and mesh are uploaded)
+	queue.setDepthRange(0.1f, 100.0f);
+	queue.setCamera(view, proj);
 	{
-		//fill with (-1, -1) text coords --> no texture
-		for (int i = 0; i < total_obj_triangles*3; i++)	//same number of texcoords as vertices
+		PROFILE_ZONE("Submit");
+		queue.clear();
+		for (size_t i = 0; i < inside.size(); i++) submitObject(inside[i], view, eye, proj_scale, alpha);
+		for (size_t i = 0; i < cull_objects.size(); i++)
 		{
-			obj_attrib.texcoords.push_back(-1);
-			obj_attrib.texcoords.push_back(-1);
+			if (visible[i]) submitObject(cull_objects[i], view, eye, proj_scale, alpha);
 		}
 	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, obj_vbos[2]);
-	glBufferData(GL_ARRAY_BUFFER, obj_attrib.texcoords.size() * sizeof(float), &obj_attrib.texcoords.at(0), GL_STATIC_DRAW);
-
-	//3.2 setup texcoord attributes
-	GLint obj_texAttrib = glGetAttribLocation(phongProgram, "inTexcoord");
-	glVertexAttribPointer(obj_texAttrib, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
-	glEnableVertexAttribArray(obj_texAttrib);
-
-	//4. INDICES --> obj_ibo
-	glGenBuffers(1, obj_ibo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, obj_ibo[0]);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, obj_shapes.at(0).mesh.indices.size() * sizeof(int), &obj_shapes.at(0).mesh.indices, GL_STATIC_DRAW);
-
-	glBindVertexArray(0);
-	glEnable(GL_DEPTH_TEST);
-
-	cout << "--------------------------------------------------" << endl;
-	cout << "--------------GRAPHICS SETUP COMPLETE-------------" << endl;
-	cout << "--------------------------------------------------" << endl;
+	{
+		PROFILE_GPU_ZONE("Execute");
+		queue.execute(resources, stream);
+	}
+	stream.endFrame();
+}
 
-	return true;
+/*----------------------------*/
+// PRIVATE FUNCTIONS
+/*----------------------------*/
+//queues wobj where it is alpha of the way through the last tick, with its view depth and LOD
+void World::submitObject(WorldObject* wobj, const glm::mat4& view, const glm::vec3& eye, float proj_scale, float alpha)
+{
+	glm::mat4 model = wobj->getModelMatrix(alpha);
+	float depth = -(view * model[3]).z;	//model[3] : object origin
+	int lod = selectLOD(wobj, eye, proj_scale);
+	queue.submit(PASS_OPAQUE, phongProgram, wobj->getTexture(), resources->getMeshVAO(), wobj->getMesh(), lod,
+		model, wobj->getMaterialID(), depth);
 }
 
-//loops through WObj array and draws each
-//also draws floor
-void World::draw(Camera * cam)
+//LOD for wobj seen from eye, starting from the one it drew last frame
+//an LOD's error is in object space, so it's scaled by the object's largest
+//size and projected at the distance to the nearest point of its bounding sphere
+int World::selectLOD(WorldObject* wobj, const glm::vec3& eye, float proj_scale)
 {
-	glClearColor(.2f, 0.4f, 0.8f, 1.0f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	const MeshResource* m = resources->getMesh(wobj->getMesh());
+	if (m == nullptr || m->num_lods <= 1) return 0;
 
-	glUseProgram(phongProgram); //Set the active shader (only one can be used at a time)
+	glm::vec3 center, extents;
+	float radius;
+	wobj->getWorldBounds(m->bounds, center, extents, radius);
 
-	//vertex shader uniforms
-	GLint uniView = glGetUniformLocation(phongProgram, "view");
-	GLint uniProj = glGetUniformLocation(phongProgram, "proj");
-	GLint uniTexID = glGetUniformLocation(phongProgram, "texID");
+	glm::vec3 size = glm::abs(util::vec3DtoGLM(wobj->getSize()));
+	float scale = max(size.x, max(size.y, size.z));
+	float dist = max(glm::length(center - eye) - radius, 0.1f);
+	float pixels = proj_scale * scale / dist;	//per unit of object space error
 
-	//build view matrix from Camera
-	glm::mat4 view = glm::lookAt(
-		util::vec3DtoGLM(cam->getPos()),
-		util::vec3DtoGLM(cam->getPos() + cam->getDir()),  //Look at point
-		util::vec3DtoGLM(cam->getUp()));
+	int lod = min(wobj->getLOD(), m->num_lods - 1);
+	while (lod > 0 && m->lods[lod].error * pixels > LOD_ERROR_PIXELS) lod--;
+	while (lod + 1 < m->num_lods && m->lods[lod + 1].error * pixels < LOD_ERROR_PIXELS * (1 - LOD_HYSTERESIS)) lod++;
 
-	glUniformMatrix4fv(uniView, 1, GL_FALSE, glm::value_ptr(view));
+	wobj->setLOD(lod);
+	return lod;
+}
 
-	glm::mat4 proj = glm::perspective(3.14f / 4, 800.0f / 600.0f, 0.1f, 100.0f); //FOV, aspect, near, far
-	glUniformMatrix4fv(uniProj, 1, GL_FALSE, glm::value_ptr(proj));
+//places objects whose mesh has arrived, refits the ones that moved and lets
+//the BVH rebuild itself when the refits have loosened it enough
+void World::updateScene()
+{
+	glm::vec3 center, extents;
+	float radius;
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tex0);
-	glUniform1i(glGetUniformLocation(phongProgram, "tex0"), 0);
+	for (size_t i = 0; i < unplaced.size(); )
+	{
+		WorldObject* wobj = unplaced[i];
+		if (!getObjectBounds(wobj, center, extents, radius))
+		{
+			i++;
+			continue;
+		}
 
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, tex1);
-	glUniform1i(glGetUniformLocation(phongProgram, "tex1"), 1);
+		wobj->setSceneProxy(&scene, scene.insertDeferred(wobj, AABB(center - extents, center + extents)));
+		unplaced[i] = unplaced.back();
+		unplaced.pop_back();
+	}
 
-	glBindVertexArray(model_vao);
-	glBindBuffer(GL_ARRAY_BUFFER, model_vbo[0]); //Set the model_vbo as the active VBO
-	glUniform1i(uniTexID, 1);
+	scene.takeMoved(moved);
+	for (size_t i = 0; i < moved.size(); i++)
+	{
+		WorldObject* wobj = scene.getObject(moved[i]);
+		if (getObjectBounds(wobj, center, extents, radius)) scene.refit(moved[i], AABB(center - extents, center + extents));
+	}
 
-	floor->draw(phongProgram);
+	scene.maintain();
+}
 
-	//draw obj cylinder
-	glBindVertexArray(obj_vao);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, obj_ibo[0]);
-	glUniform1i(uniTexID, -1);
+//world space bounds of wobj, false until its mesh is uploaded
+bool World::getObjectBounds(WorldObject* wobj, glm::vec3& center, glm::vec3& extents, float& radius)
+{
+	const MeshResource* m = resources->getMesh(wobj->getMesh());
+	if (m == nullptr) return false;
 
-	obj->draw(phongProgram);
+	wobj->getWorldBounds(m->bounds, center, extents, radius);
+	return true;
 }
 
-/*----------------------------*/
-// PRIVATE FUNCTIONS
-/*----------------------------*/
-
-/*----------------------------*/
-// HELPER FUNCTIONS
-/*----------------------------*/
-static bool TinyOBJLoad(const char* filename, const char* basepath, tinyobj::attrib_t &attrib,
-												vector<tinyobj::shape_t> &shapes, vector<tinyobj::material_t> &materials)
+//drops the references wobj holds
+void World::releaseObject(WorldObject* wobj)
 {
-	cout << "--------------------------------------------------" << endl;
-  cout << "Loading " << filename << "......"<< endl;
-
-  timerutil t;
-  t.start();
-  std::string err;
-  bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filename,
-                              basepath, true);
-  t.end();
-  printf("Parsing time: %lu [msecs]\n", t.msec());
-
-  if (!err.empty()) {
-    cerr << err << endl;
-  }
-
-  if (!ret) {
-    printf("Failed to load/parse .obj.\n");
-    return false;
-  }
-
-	printf("# of vertices  = %d\n", (int)(attrib.vertices.size()) / 3);
-  printf("# of normals   = %d\n", (int)(attrib.normals.size()) / 3);
-  printf("# of texcoords = %d\n", (int)(attrib.texcoords.size()) / 2);
-  printf("# of materials = %d\n", (int)materials.size());
-  printf("# of shapes    = %d\n", (int)shapes.size());
-
-	for (int s = 0; s < shapes.size(); s++)
-	{
-		printf("-->shapes[%i] : %s\n", s, shapes.at(s).name.c_str());
-		printf("----> # of indices = %d\n", (int)shapes.at(s).mesh.indices.size());
-	}
+	if (wobj == nullptr) return;
+
+	if (wobj->getSceneProxy() >= 0) scene.remove(wobj->getSceneProxy());
+	wobj->setSceneProxy(nullptr, -1);
+	unplaced.erase(std::remove(unplaced.begin(), unplaced.end(), wobj), unplaced.end());
 
-  return true;
+	resources->release(wobj->getMesh());
+	resources->release(wobj->getTexture());
+	wobj->setMesh(MeshHandle());
+	wobj->setTexture(TextureHandle());
 }
@@ -4,6 +4,8 @@
 #include "WorldObject.h"
 #endif
 
+#include "SceneBVH.h"
+
 using namespace std;
 
 /*----------------------------*/
@@ -12,23 +14,29 @@ using namespace std;
 WorldObject::WorldObject()
 {
 	pos = Vec3D();
+	prev_pos = pos;
 	vel = Vec3D();
 	acc = Vec3D();
 	size = Vec3D(1, 1, 1);
-	start_vertex_index = 0;
-	total_vertices = 0;
 	mat = Material();
+	material_id = 0;
+	scene = nullptr;
+	scene_proxy = -1;
+	lod = 0;
 }
 
 WorldObject::WorldObject(Vec3D init_pos)
 {
 	pos = init_pos;
+	prev_pos = pos;
 	vel = Vec3D();
 	acc = Vec3D();
 	size = Vec3D(1, 1, 1);
-	start_vertex_index = 0;
-	total_vertices = 0;
 	mat = Material();
+	material_id = 0;
+	scene = nullptr;
+	scene_proxy = -1;
+	lod = 0;
 }
 
 WorldObject::~WorldObject()
@@ -41,6 +49,8 @@ WorldObject::~WorldObject()
 void WorldObject::setPos(Vec3D p)
 {
   pos = p;
+	prev_pos = p;
+	if (scene != nullptr) scene->markMoved(scene_proxy);
 }
 
 void WorldObject::setVel(Vec3D v)
@@ -53,10 +63,14 @@ void WorldObject::setAcc(Vec3D a)
   acc = a;
 }
 
-void WorldObject::setVertexInfo(int start, int total)
+void WorldObject::setMesh(MeshHandle m)
+{
+	mesh = m;
+}
+
+void WorldObject::setTexture(TextureHandle t)
 {
-  start_vertex_index = start;
-  total_vertices = total;
+	texture = t;
 }
 
 void WorldObject::setMaterial(Material m)
@@ -64,9 +78,15 @@ void WorldObject::setMaterial(Material m)
 	mat = m;
 }
 
+void WorldObject::setMaterialID(int id)
+{
+	material_id = id;
+}
+
 void WorldObject::setSize(Vec3D s)
 {
 	size = s;
+	if (scene != nullptr) scene->markMoved(scene_proxy);
 }
 
 void WorldObject::setColor(Vec3D color)
@@ -76,6 +96,17 @@ void WorldObject::setColor(Vec3D color)
 	mat.setDiffuse(c);
 }
 
+void WorldObject::setSceneProxy(SceneBVH* s, int proxy)
+{
+	scene = s;
+	scene_proxy = proxy;
+}
+
+void WorldObject::setLOD(int l)
+{
+	lod = l;
+}
+
 /*----------------------------*/
 // GETTERS
 /*----------------------------*/
@@ -99,55 +130,90 @@ Material WorldObject::getMaterial()
 	return mat;
 }
 
+int WorldObject::getMaterialID()
+{
+	return material_id;
+}
+
 Vec3D WorldObject::getSize()
 {
 	return size;
 }
 
-/*----------------------------*/
-// VIRTUALS
-/*----------------------------*/
-int WorldObject::getType()
+MeshHandle WorldObject::getMesh()
 {
-	return DEFAULT_WOBJ;
+	return mesh;
 }
 
-/*----------------------------*/
-// OTHERS
-/*----------------------------*/
-//assumes that the models have already been loaded into the VBO before this call
-void WorldObject::draw(GLuint shaderProgram)
+TextureHandle WorldObject::getTexture()
 {
-	GLint uniModel = glGetUniformLocation(shaderProgram, "model");
+	return texture;
+}
 
+int WorldObject::getSceneProxy()
+{
+	return scene_proxy;
+}
+
+int WorldObject::getLOD()
+{
+	return lod;
+}
+
+glm::mat4 WorldObject::getModelMatrix()
+{
+	return getModelMatrix(1.0f);
+}
+
+glm::mat4 WorldObject::getModelMatrix(float alpha)
+{
 	glm::mat4 model;
 	glm::vec3 size_v = util::vec3DtoGLM(size);
-	glm::vec3 pos_v = util::vec3DtoGLM(pos);
+	glm::vec3 pos_v = glm::mix(util::vec3DtoGLM(prev_pos), util::vec3DtoGLM(pos), alpha);
 
 	//build model mat specific to this WObj
 	model = glm::translate(model, pos_v);
 	model = glm::scale(model, size_v);
-	glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model));
+	return model;
+}
+
+void WorldObject::getWorldBounds(const MeshBounds& b, glm::vec3& center, glm::vec3& extents, float& radius)
+{
+	glm::vec3 size_v = util::vec3DtoGLM(size);
+	glm::vec3 lo = glm::vec3(b.min[0], b.min[1], b.min[2]);
+	glm::vec3 hi = glm::vec3(b.max[0], b.max[1], b.max[2]);
 
-	//fragment shader uniforms (from Material)
-	GLint uniform_ka = glGetUniformLocation(shaderProgram, "ka");
-	GLint uniform_kd = glGetUniformLocation(shaderProgram, "kd");
-	GLint uniform_ks = glGetUniformLocation(shaderProgram, "ks");
-	GLint uniform_s = glGetUniformLocation(shaderProgram, "s");
+	//drawing blends between prev_pos and pos, so the bounds cover the whole step
+	glm::vec3 prev_v = util::vec3DtoGLM(prev_pos);
+	glm::vec3 pos_v = util::vec3DtoGLM(pos);
+	glm::vec3 half_step = 0.5f * (pos_v - prev_v);
 
-	glm::vec3 mat_AMB = mat.getAmbient();
-	glUniform3f(uniform_ka, mat_AMB[0], mat_AMB[1], mat_AMB[2]);
+	//no rotation, so the scaled box stays axis aligned
+	center = prev_v + half_step + size_v * glm::vec3(b.center[0], b.center[1], b.center[2]);
+	extents = 0.5f * glm::abs(size_v * (hi - lo)) + glm::abs(half_step);
 
-	glm::vec3 mat_DIF = mat.getDiffuse();
-	glUniform3f(uniform_kd, mat_DIF[0], mat_DIF[1], mat_DIF[2]);
+	glm::vec3 s = glm::abs(size_v);
+	radius = b.radius * max(s.x, max(s.y, s.z)) + glm::length(half_step);
+}
 
-	glm::vec3 mat_SPEC = mat.getSpecular();
-	glUniform3f(uniform_ks, mat_SPEC[0], mat_SPEC[1], mat_SPEC[2]);
+/*----------------------------*/
+// OTHERS
+/*----------------------------*/
+void WorldObject::step(float dt)
+{
+	prev_pos = pos;
+	if (vel.getX() == 0 && vel.getY() == 0 && vel.getZ() == 0 && acc.getX() == 0 && acc.getY() == 0 && acc.getZ() == 0) return;
 
-	glUniform1f(uniform_s, mat.getNS());
+	//velocity first, so the position uses the new one (stable where explicit Euler gains energy)
+	vel = vel + dt * acc;
+	pos = pos + dt * vel;
+	if (scene != nullptr) scene->markMoved(scene_proxy);
+}
 
-	//starts at an offset of start_vertex_index
-	//(Primitive Type, Start Vertex, End Vertex)
-	if (hasIBO) glDrawArrays(GL_TRIANGLE_STRIP, start_vertex_index, total_vertices);
-	else glDrawArrays(GL_TRIANGLES, start_vertex_index, total_vertices);
+/*----------------------------*/
+// VIRTUALS
+/*----------------------------*/
+int WorldObject::getType()
+{
+	return DEFAULT_WOBJ;
 }
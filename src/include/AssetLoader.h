@@ -0,0 +1,88 @@
+#ifndef ASSETLOADER_INCLUDED
+#define ASSETLOADER_INCLUDED
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//higher priorities are decoded first
+enum AssetPriority
+{
+	PRIORITY_OBJ = 0,
+	PRIORITY_TEXTURE = 1,
+	PRIORITY_MODEL = 2,
+	PRIORITY_SHADER = 3
+};
+
+//Loads assets in two steps : decode (file reading / parsing) runs on worker
+//threads, upload (anything touching GL) runs on the GL thread inside pump().
+class AssetLoader
+{
+public:
+	//CONSTRUCTORS AND DESTRUCTORS
+	AssetLoader();
+	AssetLoader(int num_workers);	//<= 0 : one per core, leaving one for the GL thread
+	~AssetLoader();	//waits for running decodes, drops everything not started yet
+
+	//GETTERS
+	int getTotal();
+	int getCompleted();	//uploaded or failed
+	int getFailed();
+	float getProgress();	//0 to 1
+	bool isDone();
+
+	//OTHERS
+	//decode runs on a worker, upload on the GL thread once decode succeeded
+	//either returning false marks the asset as failed
+	void queue(string name, int priority, function<bool()> decode, function<bool()> upload);
+
+	//GL thread : uploads decoded assets until budget_ms is used up
+	//returns the number of assets finished by this call
+	int pump(double budget_ms = 4.0);
+
+	//GL thread : blocks until every queued asset is uploaded or failed
+	void finish();
+
+private:
+	struct Job
+	{
+		string name;
+		int priority;
+		unsigned long seq;	//keeps equal priorities in queue order
+		function<bool()> decode;
+		function<bool()> upload;
+		bool decoded;
+	};
+
+	struct JobOrder
+	{
+		bool operator()(const Job* a, const Job* b) const;
+	};
+
+	priority_queue<Job*, vector<Job*>, JobOrder> pending;
+	deque<Job*> decoded;	//waiting for the GL thread
+	vector<thread> workers;
+
+	mutex lock;
+	condition_variable work_ready;	//signals workers
+	condition_variable job_decoded;	//signals finish()
+
+	unsigned long next_seq;
+	int total;
+	int completed;
+	int failed;
+	bool stopping;
+
+	void start(int num_workers);
+	void workerLoop();
+	bool finishJob(Job* job);
+};
+
+#endif
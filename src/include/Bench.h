@@ -0,0 +1,68 @@
+#ifndef BENCH_INCLUDED
+#define BENCH_INCLUDED
+
+#include "glad.h"  //Include order can matter here
+
+#ifdef __APPLE__
+#include <SDL2/SDL.h>
+#elif __linux__
+#include <SDL2/SDL.h>
+#else
+#include <SDL.h>
+#endif
+
+#include <string>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "ResourceManager.h"
+
+using namespace std;
+
+//frames drawn and thrown away before measuring each scene (first uploads, shader warm-up)
+#define BENCH_WARMUP_FRAMES 10
+
+struct BenchOptions
+{
+	int frames = 200;				//measured per scene, at most PROFILER_FRAMES
+	int count = 512;				//instances per scene
+	int width = 800;				//viewport
+	int height = 600;
+	string out;							//results JSON, not written if empty
+	string baseline;				//results JSON to compare against, none if empty
+	double threshold = 10.0;	//% slower than the baseline that counts as a regression
+};
+
+//one scene's measurements, times in ms
+struct BenchResult
+{
+	string scene;
+	int count = 0;
+	int frames = 0;
+	double cpu[3] = { 0, 0, 0 };	//p50, p95, p99 of the frame's CPU time (update, draw, swap)
+	double gpu[3] = { 0, 0, 0 };	//p50, p95, p99 of GL_TIME_ELAPSED over the frame, -1 without timer queries
+	int draws = 0;
+	int triangles = 0;
+};
+
+//Scripted scene benchmark : draws every BenchScene for a fixed number of frames,
+//headless or in a window, and reports frame time percentiles and draw counts.
+//Results are written as JSON, one scene per line, and the same files are read
+//back as the baseline.
+namespace bench
+{
+	//GL thread : every scene through a World of its own, window NULL when headless
+	//false if a scene regressed against the baseline or the results couldn't be written
+	bool run(ResourceManager* resources, AssetLoader* loader, SDL_Window* window, const BenchOptions& options);
+
+	//value p (0 - 100) percent of values are at or under, nearest rank
+	double percentile(vector<double> values, double p);
+
+	bool writeResults(string filename, const vector<BenchResult>& results);
+	bool readResults(string filename, vector<BenchResult>& results, string& renderer);
+
+	//prints every scene next to its baseline, false if any p50 or p95 time is more than threshold % slower
+	bool compare(const vector<BenchResult>& results, const vector<BenchResult>& baseline, double threshold);
+}
+
+#endif
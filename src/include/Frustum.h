@@ -0,0 +1,99 @@
+#ifndef FRUSTUM_INCLUDED
+#define FRUSTUM_INCLUDED
+
+#define GLM_FORCE_RADIANS
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+enum FrustumPlane
+{
+	FRUSTUM_LEFT,
+	FRUSTUM_RIGHT,
+	FRUSTUM_BOTTOM,
+	FRUSTUM_TOP,
+	FRUSTUM_NEAR,
+	FRUSTUM_FAR,
+	NUM_FRUSTUM_PLANES
+};
+
+//classifyBox results
+enum FrustumTest
+{
+	FRUSTUM_OUTSIDE,
+	FRUSTUM_INTERSECTS,
+	FRUSTUM_INSIDE
+};
+
+#define FRUSTUM_ALL_PLANES ((1 << NUM_FRUSTUM_PLANES) - 1)
+
+//what the last cull did
+struct CullStats
+{
+	int tested = 0;
+	int visible = 0;
+	int culled = 0;
+	bool frozen = false;	//tested against a frustum kept from an earlier frame
+
+	void print() const;
+};
+
+//world space frustum as six planes (normal, distance), normals pointing inside
+class Frustum
+{
+public:
+	//CONSTRUCTORS AND DESTRUCTORS
+	Frustum();	//everything is inside until set
+
+	//SETTERS
+	//planes of the clip space cube pulled back through proj * view
+	void setFromMatrix(const glm::mat4& view_proj);
+
+	//GETTERS
+	glm::vec4 getPlane(FrustumPlane p) const;
+
+	//OTHERS
+	//false only when the volume is entirely outside one plane
+	bool testSphere(const glm::vec3& center, float radius) const;
+	bool testBox(const glm::vec3& center, const glm::vec3& extents) const;
+
+	//plane_mask : a bit per plane left to test (FRUSTUM_ALL_PLANES to start with)
+	//planes the box is entirely inside are cleared, so a hierarchy can pass the
+	//mask down and children skip them
+	FrustumTest classifyBox(const glm::vec3& center, const glm::vec3& extents, int& plane_mask) const;
+
+private:
+	glm::vec4 planes[NUM_FRUSTUM_PLANES];
+};
+
+//World space bounds of the objects to cull, one array per component (structure of
+//arrays), so cull tests four objects per SSE instruction. An object is culled when its
+//sphere or its box is outside any plane.
+class FrustumCuller
+{
+public:
+	//GETTERS
+	int getCount();
+
+	//OTHERS
+	void clear();
+
+	//extents : half size of the box, returns the object's index
+	int add(const glm::vec3& center, const glm::vec3& extents, float radius);
+
+	//visible[i] is 1 for every object added since clear that is at least partly inside
+	void cull(const Frustum& frustum, vector<uint8_t>& visible, CullStats& stats);
+
+private:
+	vector<float> cx, cy, cz;	//box and sphere center
+	vector<float> ex, ey, ez;	//box extents
+	vector<float> radius;
+	int count = 0;
+
+	void cullScalar(const Frustum& frustum, int first, vector<uint8_t>& visible);
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef HEADLESS_INCLUDED
+#define HEADLESS_INCLUDED
+
+#include "glad.h"
+
+#include <string>
+
+using namespace std;
+
+//Rendering without a window or display, for batch jobs and CI : a GL 3.2 core
+//context made through EGL (surfaceless when the driver has it, a 1x1 pbuffer
+//otherwise) and an offscreen framebuffer that World::draw renders into.
+//libEGL is opened at runtime, so builds that never go headless don't link it.
+//Mesa's llvmpipe works, with no GPU : EGL_PLATFORM=surfaceless LIBGL_ALWAYS_SOFTWARE=1
+namespace headless
+{
+	//makes the context current and loads GL, false if there's no usable EGL
+	bool initContext();
+
+	//width x height color + depth framebuffer, bound and set as the viewport
+	bool createTarget(int width, int height);
+
+	//back to no framebuffer, then no context
+	void shutdown();
+
+	//the target's pixels as a binary PPM, top row first (waits for the GPU)
+	bool saveImage(string filename);
+}
+
+#endif
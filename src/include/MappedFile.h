@@ -0,0 +1,38 @@
+#ifndef MAPPEDFILE_INCLUDED
+#define MAPPEDFILE_INCLUDED
+
+#include <cstddef>
+#include <string>
+
+//read-only memory mapping of a whole file
+//the mapping stays valid until close() or destruction
+class MappedFile
+{
+public:
+	//CONSTRUCTORS AND DESTRUCTORS
+	MappedFile();
+	~MappedFile();
+
+	//GETTERS
+	const char* getData();
+	size_t getSize();
+	bool isOpen();
+
+	//OTHERS
+	bool open(const std::string& filename);
+	void close();
+
+private:
+	const char* data;
+	size_t size;
+#ifdef _WIN32
+	void* file_handle;
+	void* map_handle;
+#endif
+
+	//mappings are owned, so no copies
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef MESHDATA_INCLUDED
+#define MESHDATA_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+//floats per vertex in the .txt models : pos (3), texcoord (2), normal (3)
+#define MODEL_VERT_FLOATS 8
+
+//most levels of detail a mesh gets, the full mesh included
+#define MAX_MESH_LODS 6
+
+//a level of detail : a range of the mesh's indices drawing a simplified version
+//of it out of the same vertices
+struct MeshLOD
+{
+	uint32_t first_index;
+	uint32_t num_indices;
+	float error;	//object space, the most any vertex simplified away lies off this LOD (upper bound)
+};
+
+//indexed triangle mesh owning its data
+struct MeshData
+{
+	vector<float> verts;	//MODEL_VERT_FLOATS interleaved floats per vertex
+	vector<uint32_t> indices;	//3 per triangle, every LOD one after another
+	vector<MeshLOD> lods;	//empty : all of indices is the only LOD
+
+	int numVerts() const { return (int)(verts.size() / MODEL_VERT_FLOATS); }
+	int numIndices() const { return (int)indices.size(); }
+};
+
+//indexed triangle mesh pointing at data owned elsewhere (a MeshData or a cache mapping)
+struct MeshView
+{
+	const float* verts;
+	int num_verts;
+	const uint32_t* indices;
+	int num_indices;
+	const MeshLOD* lods;
+	int num_lods;
+
+	MeshView() : verts(nullptr), num_verts(0), indices(nullptr), num_indices(0), lods(nullptr), num_lods(0) {}
+	MeshView(const MeshData& m)
+		: verts(m.verts.empty() ? nullptr : &m.verts[0]), num_verts(m.numVerts()),
+		indices(m.indices.empty() ? nullptr : &m.indices[0]), num_indices(m.numIndices()),
+		lods(m.lods.empty() ? nullptr : &m.lods[0]), num_lods((int)m.lods.size()) {}
+};
+
+//object space bounding volumes of a mesh's positions
+struct MeshBounds
+{
+	float min[3];
+	float max[3];
+	float center[3];	//sphere center, the middle of the box
+	float radius;			//distance to the farthest vertex
+
+	MeshBounds() : min{ 0, 0, 0 }, max{ 0, 0, 0 }, center{ 0, 0, 0 }, radius(0) {}
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef MESHOPTIMIZE_INCLUDED
+#define MESHOPTIMIZE_INCLUDED
+
+#include "MeshData.h"
+
+//post-transform cache size the optimizer targets and the stats are measured with
+#define MESHOPT_CACHE_SIZE 16
+
+//Import-time reordering of indexed triangle meshes :
+//triangles for the post-transform vertex cache (Tipsify, Sander et al. 2007),
+//then optionally whole clusters for less overdraw, then vertices in fetch order.
+namespace meshopt
+{
+	struct CacheStats
+	{
+		float acmr;	//average cache miss ratio : transformed vertices per triangle (0.5 - 3)
+		float atvr;	//average transformed vertex ratio : transformed / unique vertices (>= 1)
+	};
+
+	//simulates a FIFO post-transform cache of cache_size entries over the index stream
+	CacheStats analyzeCache(const uint32_t* indices, int num_indices, int num_verts, int cache_size = MESHOPT_CACHE_SIZE);
+
+	//reorders triangles in place for the vertex cache
+	//clusters (optional) receives the index offsets where the cache restarts cold,
+	//the pieces in between can be moved around without hurting the cache much
+	void optimizeVertexCache(uint32_t* indices, int num_indices, int num_verts,
+		int cache_size = MESHOPT_CACHE_SIZE, vector<int>* clusters = nullptr);
+
+	//sorts the clusters from optimizeVertexCache so the ones facing away from the
+	//mesh center draw first and occlude the rest (positions are the first 3 floats of each vertex)
+	void optimizeOverdraw(uint32_t* indices, int num_indices, const float* verts, const vector<int>& clusters);
+
+	//renumbers vertices in the order the indices first use them
+	void optimizeVertexFetch(MeshData& mesh);
+
+	//runs every pass above on mesh and prints the cache stats before and after
+	void optimize(MeshData& mesh, const char* name, bool overdraw = true);
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef MESHSIMPLIFY_INCLUDED
+#define MESHSIMPLIFY_INCLUDED
+
+#include "MeshData.h"
+
+//every LOD aims at this fraction of the previous one's triangles
+#define MESHSIMPLIFY_LOD_RATIO 0.5f
+
+//no LODs below this many triangles
+#define MESHSIMPLIFY_MIN_TRIANGLES 32
+
+//Import-time levels of detail by quadric error edge collapse (Garland & Heckbert 1997).
+//A vertex is only ever collapsed onto one of its neighbours, so a simplified mesh is
+//just new indices into the same vertices. Vertices whose position is shared with
+//another vertex (UV and normal seams) or that lie on an open border never move,
+//which keeps seams and borders closed.
+namespace meshsimplify
+{
+	//simplifies the triangles in indices[0, num_indices) of mesh down to about
+	//target_indices indices (more when no collapse is left that keeps the mesh intact), into out
+	//returns the error : an upper bound on the distance from any vertex the collapses
+	//removed to the simplified surface, in the mesh's units
+	float simplify(const MeshView& mesh, const uint32_t* indices, int num_indices, int target_indices,
+		vector<uint32_t>& out);
+
+	//replaces mesh.lods with LOD 0 (the current indices) followed by simplified
+	//levels appended to mesh.indices, each optimized for the vertex cache
+	void generateLODs(MeshData& mesh, const char* name);
+}
+
+#endif
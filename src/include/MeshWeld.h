@@ -0,0 +1,14 @@
+#ifndef MESHWELD_INCLUDED
+#define MESHWELD_INCLUDED
+
+#include "MeshData.h"
+
+namespace meshweld
+{
+	//turns num_verts triangle soup vertices into unique vertices + an index buffer
+	//epsilon 0 merges bit-identical vertices only, otherwise every component is
+	//snapped to an epsilon grid before comparing (first vertex in a cell is kept)
+	void weld(const float* soup, int num_verts, float epsilon, MeshData& out);
+}
+
+#endif
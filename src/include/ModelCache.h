@@ -0,0 +1,61 @@
+#ifndef MODELCACHE_INCLUDED
+#define MODELCACHE_INCLUDED
+
+#include <cstdint>
+#include <string>
+
+#include "MappedFile.h"
+#include "MeshData.h"
+
+using namespace std;
+
+//Binary sidecar for the models (models/cube.txt -> models/cube.txt.mcache)
+//written after the first import so later runs can mmap the welded and optimized
+//vertex and index data and hand it straight to GL without parsing the source again.
+#define MODEL_CACHE_MAGIC 0x48534D42	//"BMSH" little endian
+#define MODEL_CACHE_VERSION 6
+#define MODEL_CACHE_EXT ".mcache"
+
+//vertex layouts a cache can hold
+enum ModelCacheLayout
+{
+	LAYOUT_POS3_TEX2_NORM3 = 0	//interleaved float pos (3), texcoord (2), normal (3)
+};
+
+struct ModelCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t layout;					//ModelCacheLayout
+	uint32_t floats_per_vert;
+	uint32_t num_verts;
+	uint32_t num_indices;
+	float weld_epsilon;				//epsilon the vertices were welded with
+	uint32_t optimize_overdraw;	//1 if the triangles were sorted for overdraw
+	uint64_t source_size;			//byte size of the .txt this cache was built from
+	uint64_t source_hash;			//FNV-1a of the .txt contents
+	uint64_t data_offset;			//byte offset of the vertex data from the file start
+	uint64_t index_offset;		//byte offset of the uint32 indices from the file start
+	uint32_t num_lods;				//MeshLOD entries, 0 when the indices are a single LOD
+	uint32_t pad2;
+	uint64_t lod_offset;			//byte offset of the MeshLOD table from the file start
+};
+
+namespace modelcache
+{
+	//path of the cache sidecar for txtFile
+	string cachePath(const string& txtFile);
+
+	//64-bit FNV-1a over a byte range
+	uint64_t hashBytes(const char* bytes, size_t len);
+
+	//maps the cache for txtFile into cache and checks it against the current .txt
+	//on success mesh points into the mapping, false if the cache is missing,
+	//stale, from another version, or welded or optimized differently (cache is closed then)
+	bool open(const string& txtFile, float weld_epsilon, bool optimize_overdraw, MappedFile& cache, MeshView& mesh);
+
+	//writes a fresh cache for txtFile holding mesh
+	bool write(const string& txtFile, float weld_epsilon, bool optimize_overdraw, const MeshView& mesh);
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef MODELPARSER_INCLUDED
+#define MODELPARSER_INCLUDED
+
+#include <cstddef>
+
+#include "MappedFile.h"
+
+//Parser for the .txt model format: a float count followed by that many floats,
+//separated by whitespace and/or commas (models/face.txt uses commas).
+//Large files are split into separator-aligned chunks parsed on all cores.
+namespace modelparser
+{
+	struct ParseStats
+	{
+		size_t bytes;			//bytes of float text parsed
+		int num_floats;
+		int num_threads;
+		double seconds;
+
+		double mbPerSec();
+	};
+
+	//reads the leading float count, body_offset is where the floats start
+	bool readHeader(const char* data, size_t size, int& num_floats, size_t& body_offset);
+
+	//locale-free float parse of the token starting at p
+	//returns the first char after the number, or p if it isn't one
+	const char* parseFloat(const char* p, const char* end, float& out);
+
+	//parses num_floats floats of a mapped model file straight into dst
+	//num_threads <= 0 picks one thread per core (fewer for small files)
+	bool parseModel(MappedFile& file, float* dst, int num_floats, ParseStats* stats = nullptr, int num_threads = 0);
+}
+
+#endif
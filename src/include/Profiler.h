@@ -0,0 +1,104 @@
+#ifndef PROFILER_INCLUDED
+#define PROFILER_INCLUDED
+
+#include "glad.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+//frames kept for printSummary and writeChromeTrace
+#define PROFILER_FRAMES 256
+
+//GPU query sets in flight : a frame's results are read once the GPU has them,
+//and only waited on when its set comes round again still unread
+#define PROFILER_QUERY_SETS 3
+
+//GPU zones recorded per frame, later ones are dropped
+#define PROFILER_GPU_ZONES 64
+
+//thread id of GPU events, CPU threads count up from 1
+#define PROFILER_GPU_THREAD 0
+
+//a finished zone, times in ns on the profiler's clock
+struct ProfileEvent
+{
+	const char* name;	//string literal, events keep the pointer
+	uint64_t start;
+	uint64_t end;
+	int thread;
+	int depth;				//zones open on the same thread around it
+};
+
+struct ProfileFrame
+{
+	uint64_t index;
+	uint64_t start;
+	uint64_t end;
+	uint64_t gpu_time;	//GL_TIME_ELAPSED over the frame, once resolved
+	bool gpu_resolved;
+	vector<ProfileEvent> events;	//CPU zones that ended during the frame, then its GPU zones
+};
+
+//Scoped zone profiler : CPU zones are timed with a monotonic ns clock on whatever
+//thread opens them, GPU zones with GL_TIMESTAMP queries read back a few frames
+//later so the CPU never waits on them. Frames are kept in a ring that can be
+//written out as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+namespace profiler
+{
+	//GL thread, once the context exists : names it "main" and checks for timer queries
+	void init();
+	void shutdown();	//GL thread, deletes the queries
+
+	//shows in the trace instead of "thread N"
+	void setThreadName(const char* name);
+
+	//ns since the profiler started
+	uint64_t now();
+
+	//GL thread, around everything a frame does (swap included)
+	void beginFrame();
+	void endFrame();
+
+	//any thread, zones nest and must close in reverse order
+	void beginZone(const char* name);
+	void endZone();
+
+	//GL thread, inside a frame
+	void beginGPUZone(const char* name);
+	void endGPUZone();
+
+	//GL thread, between frames : waits for every GPU result still out
+	void resolveAll();
+
+	//back frames before the last finished one, nullptr past the ring
+	const ProfileFrame* getFrame(int back);
+
+	//average ms per frame of each zone over the last frames
+	void printSummary(int frames);
+
+	//every frame in the ring, false if the file can't be written
+	bool writeChromeTrace(const char* path);
+}
+
+//times the enclosing scope
+struct ProfileZone
+{
+	ProfileZone(const char* name) { profiler::beginZone(name); }
+	~ProfileZone() { profiler::endZone(); }
+};
+
+//times the enclosing scope on the CPU and on the GPU
+struct ProfileGPUZone
+{
+	ProfileGPUZone(const char* name) { profiler::beginZone(name); profiler::beginGPUZone(name); }
+	~ProfileGPUZone() { profiler::endGPUZone(); profiler::endZone(); }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define PROFILE_GPU_ZONE(name) ProfileGPUZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+
+#endif
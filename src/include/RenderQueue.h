@@ -0,0 +1,180 @@
+#ifndef RENDERQUEUE_INCLUDED
+#define RENDERQUEUE_INCLUDED
+
+#include "glad.h"
+
+#define GLM_FORCE_RADIANS
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "ResourceManager.h"
+#include "ShaderProgram.h"
+#include "StreamBuffer.h"
+#include "UniformBuffers.h"
+
+using namespace std;
+
+//passes run in this order (the top bits of the sort key)
+enum RenderPass
+{
+	PASS_OPAQUE = 0,				//front to back
+	PASS_TRANSPARENT = 1,		//back to front
+	NUM_PASSES
+};
+
+//sort key, most significant first :
+//pass (2) | program (10) | texture (12) | VAO (6) | mesh (9) | LOD (3) | material (8) | depth (14)
+//Fields hold the low bits of the slot indices, so two resources can share a value once
+//there are more than the field holds. That only costs a few extra binds, because the
+//queue compares the real handles when it runs.
+#define KEY_PASS_SHIFT 62
+#define KEY_PROGRAM_SHIFT 52
+#define KEY_TEXTURE_SHIFT 40
+#define KEY_VAO_SHIFT 34
+#define KEY_MESH_SHIFT 25
+#define KEY_LOD_SHIFT 22
+#define KEY_MATERIAL_SHIFT 14
+#define KEY_DEPTH_BITS 14
+
+//per-instance vertex attributes (INSTANCE_*_ATTRIB in Util.h)
+//the matrices are worked out once per object, so vertex shaders only transform by them
+struct InstanceData
+{
+	glm::mat4 mvp;					//proj * view * model
+	glm::mat4 model_view;		//view * model
+	glm::vec4 normal[3];		//inverse transpose of model_view's 3x3, a column per vec4 (w unused)
+	int32_t material;				//index into the Materials block
+	int32_t mesh;						//index into the Meshes block, for the packed vertex format
+	int32_t pad[2];					//keeps every matrix 16-byte aligned
+};
+
+static_assert(sizeof(InstanceData) == 192, "InstanceData is read as vertex attributes at fixed offsets");
+
+//one mesh / LOD and its instances, laid out as glMultiDrawElementsIndirect reads it
+struct DrawCommand
+{
+	uint32_t count;						//indices
+	uint32_t instance_count;
+	uint32_t first_index;			//in the model IBO, in indices
+	int32_t base_vertex;
+	uint32_t base_instance;		//first instance in the frame's instances
+};
+
+//one object to draw this frame
+struct DrawPacket
+{
+	uint64_t key;
+	ProgramHandle program;
+	TextureHandle texture;	//null : untextured
+	GLuint vao;							//holding mesh
+	MeshHandle mesh;
+	int lod;								//into the mesh's LODs, clamped to the ones it has
+	glm::mat4 model;
+	int material;
+};
+
+//what the last execute did
+struct RenderStats
+{
+	int packets = 0;
+	int draws = 0;			//GL draw calls
+	int commands = 0;		//meshes / LODs drawn, a multi-draw covers several
+	int triangles = 0;
+	int program_switches = 0;
+	int texture_switches = 0;
+	int vao_switches = 0;
+	int binds_skipped = 0;	//program / texture / VAO binds a packet would have needed on its own
+	bool indirect = false;	//drawn with glMultiDrawElementsIndirect
+
+	void print() const;
+};
+
+//Objects submit one packet per frame. execute radix sorts the packets by key, works out
+//every instance's matrices in one pass (four floats at a time with SSE), then
+//walks them binding only what changed, and draws every run sharing program, texture,
+//VAO, mesh and LOD with one glDrawElementsInstancedBaseVertex out of the frame's
+//instances in the StreamBuffer. Each mesh's dequantization goes into the frame's
+//Meshes block and every instance carries its index, so nothing per mesh is a uniform.
+//With GL 4.3's multi-draw indirect (and base instance, which points each command at
+//its own instances) every run sharing program, texture, VAO and index type is a single
+//glMultiDrawElementsIndirect instead, so the draw calls no longer grow with the meshes
+//in view. Without attribute divisors (GL 3.3 or
+//ARB_instanced_arrays) each instance is drawn on its own, with the same attributes set
+//as constant vertex attributes, so the shaders have a single path.
+class RenderQueue
+{
+public:
+	//CONSTRUCTORS AND DESTRUCTORS
+	RenderQueue();
+
+	//GETTERS
+	int getNumPackets();	//submitted since clear
+	const RenderStats& getStats();	//of the last execute
+
+	//SETTERS
+	void setDepthRange(float near_z, float far_z);	//view depths quantized into the key
+	void setCamera(const glm::mat4& view, const glm::mat4& proj);	//for the instance matrices
+
+	//OTHERS
+	void clear();
+
+	//lod : 0 for the full mesh, depth : distance along the view direction
+	void submit(RenderPass pass, ProgramHandle program, TextureHandle tex, GLuint vao, MeshHandle mesh, int lod,
+		const glm::mat4& model, int material, float depth);
+
+	//GL thread : per-frame uniform blocks already written
+	//the instances go into stream, which is flushed before drawing
+	//packets whose program or mesh isn't uploaded yet are skipped
+	void execute(ResourceManager* resources, StreamBuffer& stream);
+
+private:
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t index;	//into packets
+	};
+
+	//runs drawn with the same state : program, texture, VAO, index type and
+	//copy of the Meshes block
+	struct DrawBatch
+	{
+		ProgramHandle program;
+		TextureHandle texture;
+		GLuint vao;
+		GLenum index_type;
+		int mesh_table;		//MAX_DRAW_MESHES entries of mesh_blocks from mesh_table * MAX_DRAW_MESHES
+		int first_command;
+		int num_commands;
+	};
+
+	vector<DrawPacket> packets;
+	vector<SortEntry> order;
+	vector<SortEntry> sort_tmp;
+	vector<glm::mat4> models;			//model matrices in draw order
+	vector<InstanceData> staging;	//instances in draw order
+	vector<DrawBatch> batches;
+	vector<DrawCommand> commands;
+	vector<MeshBlock> mesh_blocks;	//every mesh drawn this frame, MAX_DRAW_MESHES per copy of the block
+	unordered_map<uint32_t, int> mesh_entries;	//mesh slot -> entry in the last copy
+	vector<StreamAlloc> mesh_tables;	//this frame's copies of mesh_blocks
+
+	float depth_near;
+	float depth_far;
+	glm::mat4 view;
+	glm::mat4 proj;
+
+	StreamAlloc instances;	//this frame's copy of staging
+	StreamAlloc indirect;		//this frame's copy of commands
+	RenderStats stats;
+
+	uint64_t makeKey(RenderPass pass, ProgramHandle program, TextureHandle tex, GLuint vao,
+		MeshHandle mesh, int lod, int material, float depth);
+	void radixSort();
+	void buildBatches(ResourceManager* resources);
+	void setInstanceAttribs(size_t first);
+};
+
+#endif
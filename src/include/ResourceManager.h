@@ -0,0 +1,203 @@
+#ifndef RESOURCEMANAGER_INCLUDED
+#define RESOURCEMANAGER_INCLUDED
+
+#include "glad.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "MeshData.h"
+#include "ShaderProgram.h"
+#include "VertexFormat.h"
+
+using namespace std;
+
+enum ResourceType
+{
+	RESOURCE_MESH,
+	RESOURCE_TEXTURE,
+	RESOURCE_PROGRAM,
+	NUM_RESOURCE_TYPES
+};
+
+enum ResourceState
+{
+	RESOURCE_LOADING,		//queued on the AssetLoader
+	RESOURCE_READY,			//uploaded, usable on the GL thread
+	RESOURCE_FAILED
+};
+
+//slot index plus the generation the slot had when the handle was made, so a handle
+//to an evicted resource stays invalid after its slot is reused. Generation 0 is null.
+template <ResourceType T>
+struct ResourceHandle
+{
+	uint32_t index;
+	uint32_t generation;
+
+	ResourceHandle() : index(0), generation(0) {}
+	ResourceHandle(uint32_t i, uint32_t g) : index(i), generation(g) {}
+
+	bool isNull() const { return generation == 0; }
+	bool operator==(const ResourceHandle& o) const { return index == o.index && generation == o.generation; }
+	bool operator!=(const ResourceHandle& o) const { return !(*this == o); }
+};
+
+typedef ResourceHandle<RESOURCE_MESH> MeshHandle;
+typedef ResourceHandle<RESOURCE_TEXTURE> TextureHandle;
+typedef ResourceHandle<RESOURCE_PROGRAM> ProgramHandle;
+
+//a model packed into the shared model VBO / IBO
+struct MeshResource
+{
+	GLenum index_type = GL_UNSIGNED_INT;	//GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	size_t index_offset = 0;	//byte offset of the indices in the model IBO
+	int num_indices = 0;			//LOD 0's
+	int base_vertex = 0;			//offset of the vertices in the model VBO
+	int num_verts = 0;
+	MeshQuantization quant;		//undoes the packed vertex format in the shader
+	MeshBounds bounds;				//object space, for culling
+	MeshLOD lods[MAX_MESH_LODS];	//index ranges relative to index_offset, finest first
+	int num_lods = 0;
+	size_t index_bytes = 0;		//every LOD's
+	size_t bytes = 0;					//vertex + index bytes on the GPU
+};
+
+struct TextureResource
+{
+	GLuint tex = 0;
+	int width = 0;
+	int height = 0;
+	int num_levels = 0;
+	size_t bytes = 0;					//every mip level
+};
+
+struct ProgramResource
+{
+	ShaderProgram shader;			//uniforms and attributes resolved at link time
+	size_t bytes = 0;					//driver binary size, 0 when the driver doesn't say
+};
+
+//Owns every mesh, texture and shader program, each loaded once per path and
+//shared through handles. acquire* loads on first use (through the AssetLoader)
+//or adds a reference, release drops one, and evictUnused frees whatever nobody
+//references any more. Everything except the decode steps runs on the GL thread.
+class ResourceManager
+{
+public:
+	//CONSTRUCTORS AND DESTRUCTORS
+	ResourceManager(AssetLoader* loader);
+	~ResourceManager();	//GL thread : frees every GL object, the loader has to be stopped first
+
+	//SETTERS
+	//mesh import settings, fixed once the first mesh is acquired
+	void setWeldEpsilon(float eps);	//0 : only bit-identical vertices are welded
+	void setOptimizeOverdraw(bool on);	//sort triangle clusters outside-in on import
+	void setVertexFormat(VertexFormat fmt);	//layout of every vertex in the model VBO
+
+	//GETTERS
+	VertexFormat getVertexFormat();
+	GLuint getMeshVAO();	//0 until the first mesh is uploaded
+
+	//null handle, or the resource once it is ready
+	const MeshResource* getMesh(MeshHandle h);
+	const TextureResource* getTexture(TextureHandle h);
+	const ProgramResource* getProgram(ProgramHandle h);
+
+	ResourceState getState(MeshHandle h);	//RESOURCE_FAILED for stale handles
+	ResourceState getState(TextureHandle h);
+	ResourceState getState(ProgramHandle h);
+
+	int getCount(ResourceType type);	//live resources
+	size_t getMemory(ResourceType type);	//GPU bytes of the ready resources
+
+	//OTHERS
+	//loads the path the first time, otherwise adds a reference to the loaded copy
+	//(a path that failed to load is queued again, the file may be there now)
+	MeshHandle acquireMesh(const string& file);	//.txt or .obj
+	TextureHandle acquireTexture(const string& file);	//.bmp
+	ProgramHandle acquireProgram(const string& vertFile, const string& fragFile);
+
+	//one more reference to an already acquired resource, returns h
+	MeshHandle addRef(MeshHandle h);
+	TextureHandle addRef(TextureHandle h);
+	ProgramHandle addRef(ProgramHandle h);
+
+	//unreferenced resources stay loaded until evictUnused, so a release followed by
+	//an acquire of the same path doesn't reload it
+	void release(MeshHandle h);
+	void release(TextureHandle h);
+	void release(ProgramHandle h);
+
+	//GL thread : frees every unreferenced resource that isn't still loading
+	//and compacts the model buffers when a mesh went. Returns the number freed.
+	int evictUnused();
+
+	//prints every resource with its references and GPU memory
+	void printReport();
+
+private:
+	template <typename Resource>
+	struct Slot
+	{
+		string path;
+		int refs = 0;
+		uint32_t generation = 0;	//bumped on every reuse, so 0 never matches a live handle
+		bool live = false;
+		ResourceState state = RESOURCE_LOADING;
+		Resource res;
+	};
+
+	//slots of one resource type, with a path lookup and a free list
+	template <typename Resource, ResourceType T>
+	struct Pool
+	{
+		vector<Slot<Resource> > slots;
+		vector<uint32_t> free_slots;
+		unordered_map<string, uint32_t> by_path;
+
+		Slot<Resource>* get(ResourceHandle<T> h);	//nullptr for null or stale handles
+		ResourceHandle<T> find(const string& path);
+		ResourceHandle<T> add(const string& path);	//fresh slot holding one reference
+		void remove(uint32_t index);
+		int count();
+		size_t memory();
+	};
+
+	AssetLoader* loader;
+
+	Pool<MeshResource, RESOURCE_MESH> meshes;
+	Pool<TextureResource, RESOURCE_TEXTURE> textures;
+	Pool<ProgramResource, RESOURCE_PROGRAM> programs;
+
+	//mesh import settings
+	float weld_epsilon = 0.0f;
+	bool optimize_overdraw = true;
+	VertexFormat vertex_format;
+	bool format_fixed = false;	//set on the first acquireMesh
+
+	//every mesh shares one VAO, VBO and IBO
+	GLuint model_vao = 0;
+	GLuint model_vbo = 0;	//interleaved vertices in vertex_format
+	GLuint model_ibo = 0;	//ushort or uint indices, relative to each mesh's base vertex
+	size_t model_ibo_bytes = 0;	//bytes used in model_ibo
+	int total_model_verts = 0;	//vertices used in model_vbo
+	size_t model_vbo_capacity = 0;	//bytes allocated for model_vbo
+	size_t model_ibo_capacity = 0;	//bytes allocated for model_ibo
+
+	//queue the load of a slot in RESOURCE_LOADING, on acquire or again after it failed
+	void queueMesh(MeshHandle h, const string& file);
+	void queueTexture(TextureHandle h, const string& file);
+	void queueProgram(ProgramHandle h, const string& vertFile, const string& fragFile);
+
+	bool uploadMesh(MeshHandle h, PackedMesh& mesh);
+	void createModelBuffers();
+	void growModelBuffers(size_t vbo_bytes, size_t ibo_bytes);	//at least these sizes
+	void compactModelBuffers();
+	void setModelAttribs();
+};
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef SCENEBVH_INCLUDED
+#define SCENEBVH_INCLUDED
+
+#define GLM_FORCE_RADIANS
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include "Frustum.h"
+
+using namespace std;
+
+class WorldObject;
+
+//leaves are stored this much bigger than the bounds they're given (a fraction of
+//their size plus a minimum), so small moves don't touch the tree
+#define BVH_FAT_SCALE 0.1f
+#define BVH_FAT_MIN 0.05f
+
+//SAH bins per axis when rebuilding
+#define BVH_BINS 16
+
+//world space axis aligned box
+struct AABB
+{
+	glm::vec3 min;
+	glm::vec3 max;
+
+	AABB() : min(0.0f), max(0.0f) {}
+	AABB(const glm::vec3& lo, const glm::vec3& hi) : min(lo), max(hi) {}
+
+	glm::vec3 center() const { return 0.5f * (min + max); }
+	glm::vec3 extents() const { return 0.5f * (max - min); }
+	float area() const;	//surface area
+	bool contains(const AABB& b) const;
+	bool overlaps(const AABB& b) const;
+
+	static AABB merge(const AABB& a, const AABB& b);
+};
+
+//Dynamic bounding volume hierarchy over WorldObject bounds (a binary tree of boxes,
+//objects at the leaves). insert / remove / refit change the tree in place, walking
+//up only as far as boxes change. Moving objects make the tree looser over time, so
+//maintain compares its SAH cost against the cost after the last rebuild and rebuilds
+//it with binned SAH splits once it has degraded enough.
+//
+//Proxies (returned by insert) stay valid across rebuilds until removed.
+class SceneBVH
+{
+public:
+	//CONSTRUCTORS AND DESTRUCTORS
+	SceneBVH();
+
+	//SETTERS
+	void setRebuildRatio(float r);	//maintain rebuilds past this many times the built cost
+
+	//GETTERS
+	int getCount();	//objects
+	int getHeight();	//longest root to leaf path, walks the whole tree
+	float getCost();	//SAH cost : summed internal node areas over the root's area
+	WorldObject* getObject(int proxy);
+	AABB getBounds(int proxy);	//as last given to insert / refit
+
+	//OTHERS
+	int insert(WorldObject* obj, const AABB& box);	//returns the object's proxy
+	void remove(int proxy);
+
+	//insert for bulk loads : the object is only linked into the tree by the next
+	//maintain or rebuild (one rebuild beats many inserts), queries miss it until then
+	int insertDeferred(WorldObject* obj, const AABB& box);
+
+	//new bounds for proxy, returns true when the tree had to change
+	//ancestors only ever grow here, it's maintain that tightens them again
+	bool refit(int proxy, const AABB& box);
+
+	//refits are often collected first (an object doesn't know its bounds) and run once
+	//per frame : markMoved queues a proxy once, takeMoved hands the queue over
+	void markMoved(int proxy);
+	void takeMoved(vector<int>& out);
+
+	//links deferred objects, and rebuilds when there are many of them or when the
+	//cost grew past the rebuild ratio, returns true if it rebuilt
+	bool maintain();
+	void rebuild();
+
+	//queries append to out
+	void queryAABB(const AABB& box, vector<WorldObject*>& out);
+	void querySphere(const glm::vec3& center, float radius, vector<WorldObject*>& out);
+
+	//inside : objects in subtrees entirely inside the frustum, no further test needed
+	//partial : objects whose tree nodes straddle a plane, left for a finer test
+	void queryFrustum(const Frustum& frustum, vector<WorldObject*>& inside, vector<WorldObject*>& partial);
+
+	//closest object whose bounds dir hits within max_t (dir needn't be normalized,
+	//hit_t is in units of it), nullptr if none
+	WorldObject* raycast(const glm::vec3& origin, const glm::vec3& dir, float max_t, float& hit_t);
+
+private:
+	//leaf : child[0] is -1 and child[1] the leaf index
+	struct Node
+	{
+		AABB box;			//fattened for leaves, union of both children otherwise
+		int parent;		//-1 for the root
+		int child[2];
+	};
+
+	struct Leaf
+	{
+		AABB bounds;	//exact
+		WorldObject* obj = nullptr;
+		int node = -1;	//-1 while free or deferred
+		bool live = false;
+		bool moved = false;
+	};
+
+	//a leaf being built, kept together so the build streams through memory
+	struct BuildRef
+	{
+		AABB bounds;
+		int proxy;
+	};
+
+	vector<Node> nodes;
+	vector<int> free_nodes;
+	vector<Leaf> leaves;	//indexed by proxy
+	vector<int> free_leaves;
+	int root;
+	int num_leaves;
+
+	vector<int> moved;
+	vector<int> deferred;
+
+	//summed surface area of the internal nodes, kept up to date as they change
+	double internal_area;
+	float built_cost;
+	float rebuild_ratio;
+
+	vector<int> stack;	//query scratch
+	vector<BuildRef> build_refs;
+
+	bool isLeaf(int n) const { return nodes[n].child[0] < 0; }
+	int allocNode();
+	void freeNode(int n);
+	void setBox(int n, const AABB& box);	//internal nodes, tracks internal_area
+	void insertNode(int leaf_node);
+	void removeNode(int leaf_node);
+	void refitUp(int n);
+	int addLeaf(WorldObject* obj, const AABB& box);
+	int linkLeaf(int proxy);
+	int build(int begin, int end, int parent, const AABB& centers);
+	int height(int n);
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef SHADERCACHE_INCLUDED
+#define SHADERCACHE_INCLUDED
+
+#include "glad.h"
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+//Linked program binaries (glGetProgramBinary) saved as Shaders/program_<key>.pbin
+//so later runs skip compiling and linking. The key hashes the shader sources and
+//the GL vendor / renderer / version, so a driver update or an edited shader
+//simply misses the cache; a binary the driver rejects is recompiled and rewritten.
+#define SHADER_CACHE_MAGIC 0x47525042	//"BPRG" little endian
+#define SHADER_CACHE_VERSION 1
+#define SHADER_CACHE_DIR "Shaders/"
+#define SHADER_CACHE_EXT ".pbin"
+
+struct ShaderCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t binary_format;		//GLenum from glGetProgramBinary
+	uint32_t binary_length;
+};
+
+namespace shadercache
+{
+	//true when the context can hand out program binaries (ARB_get_program_binary, core in GL 4.1)
+	bool supported();
+
+	//GL thread : cache key of a program built from these sources on this driver
+	uint64_t programKey(const char* vertShaderSrc, const char* fragShaderSrc);
+
+	string cachePath(uint64_t key);
+
+	//GL thread : program linked from the cached binary, 0 if missing or rejected
+	GLuint load(uint64_t key);
+
+	//GL thread : saves a linked program (linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT)
+	bool save(uint64_t key, GLuint program);
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef SHADERPROGRAM_INCLUDED
+#define SHADERPROGRAM_INCLUDED
+
+#include "glad.h"
+
+#define GLM_FORCE_RADIANS
+#include "glm/glm.hpp"
+
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+//uniforms the draw code sets, resolved once per program
+//a uniform the program doesn't use resolves to -1, which GL ignores
+//(camera, frame, material and dequantization data live in the uniform blocks of
+//UniformBuffers.h, transforms and the indices into them in the instance attributes of RenderQueue.h)
+enum ShaderUniform
+{
+	UNIFORM_TEX0,
+	UNIFORM_TEX1,
+	UNIFORM_TEX_ID,
+	NUM_UNIFORMS
+};
+
+//A linked GL program with every active uniform and attribute looked up once,
+//so draws set uniforms through pre-resolved locations instead of asking the
+//driver for them by name. The setters need the program to be in use.
+//The FrameData, Materials and Meshes blocks are bound to their shared binding points.
+class ShaderProgram
+{
+public:
+	//CONSTRUCTORS AND DESTRUCTORS
+	ShaderProgram();
+	ShaderProgram(GLuint linked_program);	//reflects the program, which stays owned by the caller
+	~ShaderProgram();
+
+	//GETTERS
+	GLuint getID() const;
+	GLint getLocation(ShaderUniform u) const;
+	GLint getUniformLocation(const string& name) const;	//-1 if not active
+	GLint getAttribLocation(const string& name) const;	//-1 if not active
+	int getNumUniforms() const;
+	int getNumAttribs() const;
+
+	//OTHERS
+	void use() const;
+
+	void set(ShaderUniform u, int v) const;
+	void set(ShaderUniform u, bool v) const;
+	void set(ShaderUniform u, float v) const;
+	void set(ShaderUniform u, const glm::vec2& v) const;
+	void set(ShaderUniform u, const glm::vec3& v) const;
+	void set(ShaderUniform u, const glm::mat4& v) const;
+	void set2(ShaderUniform u, const float* v) const;
+	void set3(ShaderUniform u, const float* v) const;
+
+private:
+	GLuint program;
+	GLint locations[NUM_UNIFORMS];
+	unordered_map<string, GLint> uniforms;	//every active uniform, array names without "[0]"
+	unordered_map<string, GLint> attribs;
+
+	void reflect();
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef STREAMBUFFER_INCLUDED
+#define STREAMBUFFER_INCLUDED
+
+#include "glad.h"
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+//frames the CPU can write ahead of the GPU, each with its own region of the buffer
+#define STREAM_REGIONS 3
+
+//starting region size, regions at least double whenever a frame overflows one
+#define STREAM_REGION_BYTES (1024 * 1024)
+
+//a piece of this frame's region, write-only until the frame's draws are done with it
+struct StreamAlloc
+{
+	void* ptr = nullptr;	//where to write
+	GLuint buffer = 0;		//GL buffer to bind, the allocation starts offset bytes in
+	size_t offset = 0;
+	size_t size = 0;
+};
+
+//what the last frame did
+struct StreamStats
+{
+	size_t bytes = 0;			//handed out
+	int allocs = 0;
+	int waits = 0;				//beginFrame found the GPU still reading the region (a stall)
+	bool persistent = false;
+
+	void print() const;
+};
+
+//Ring buffer for data written once per frame (uniform blocks, instance attributes,
+//transient vertices) : one GL buffer split into STREAM_REGIONS regions used in turn.
+//A fence goes in after each frame's draws, and a region is only written again once
+//the fence from its last use has passed, so writes never wait on the driver and
+//never overwrite data the GPU still has to read.
+//
+//With ARB_buffer_storage the buffer is mapped once, persistently and coherently.
+//Otherwise the free part of the region is mapped unsynchronized (the fences do the
+//syncing) with the range invalidated, and flush unmaps it before drawing.
+class StreamBuffer
+{
+public:
+	//CONSTRUCTORS AND DESTRUCTORS
+	StreamBuffer();
+	~StreamBuffer();	//GL thread
+
+	//GETTERS
+	const StreamStats& getStats();	//of the last frame
+	size_t getRegionSize();
+
+	//OTHERS (all GL thread)
+	//waits for the region's fence if the GPU is still on it, creates the buffer on first use
+	void beginFrame();
+
+	//size bytes at an offset that is a multiple of alignment (a power of two)
+	//never fails : a full region is replaced by a bigger buffer, earlier allocations
+	//this frame stay valid in the old one
+	StreamAlloc alloc(size_t size, size_t alignment);
+	StreamAlloc allocUniform(size_t size);	//aligned for glBindBufferRange(GL_UNIFORM_BUFFER)
+
+	//makes everything written so far visible to GL, call before drawing from it
+	void flush();
+
+	//fences the frame's region once its draws have been issued
+	void endFrame();
+
+private:
+	GLuint buffer;
+	size_t region_size;
+	size_t wanted_size;		//region size the next create uses
+	bool persistent;
+	GLint uniform_alignment;
+
+	int region;						//being written this frame
+	size_t head;					//next free byte in the region
+	GLsync fences[STREAM_REGIONS];
+
+	//non-persistent mapping of [map_begin, region end)
+	char* mapped;
+	size_t map_begin;
+
+	vector<GLuint> retired;	//outgrown this frame, deleted at the next beginFrame
+
+	StreamStats stats;
+	StreamStats frame_stats;
+
+	void create(size_t bytes);
+	void destroy();
+	char* regionPtr(size_t offset);	//maps if needed
+
+	//owns a GL buffer, so no copies
+	StreamBuffer(const StreamBuffer&);
+	StreamBuffer& operator=(const StreamBuffer&);
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef TEXTURECACHE_INCLUDED
+#define TEXTURECACHE_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+using namespace std;
+
+struct SDL_Surface;
+
+//Binary sidecar for the textures (textures/wood.bmp -> textures/wood.bmp.tcache)
+//holding every mip level already converted to the upload format, so later runs
+//mmap it and hand the pixels straight to glTexImage2D without decoding the BMP.
+#define TEXTURE_CACHE_MAGIC 0x58455442	//"BTEX" little endian
+#define TEXTURE_CACHE_VERSION 1
+#define TEXTURE_CACHE_EXT ".tcache"
+#define TEXTURE_CACHE_MAX_LEVELS 16
+
+//pixels are 4 bytes, B G R A in memory : GL_BGRA + GL_UNSIGNED_INT_8_8_8_8_REV
+//into GL_RGBA8, which drivers take without converting. Rows are tightly packed
+//and always a multiple of 4 bytes, so the default GL_UNPACK_ALIGNMENT works.
+#define TEXTURE_BYTES_PER_PIXEL 4
+
+struct TextureCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t num_levels;
+	uint32_t bytes_per_pixel;
+	uint64_t source_size;			//byte size of the image this cache was built from
+	uint64_t source_hash;			//FNV-1a of the image contents
+	uint64_t level_offset[TEXTURE_CACHE_MAX_LEVELS];	//byte offset of every mip level from the file start
+};
+
+//every mip level of a texture, level 0 first, each half the size of the one before
+struct TextureImage
+{
+	int width = 0;
+	int height = 0;
+	int num_levels = 0;
+	const uint8_t* levels[TEXTURE_CACHE_MAX_LEVELS];	//into a cache mapping or converted pixels
+};
+
+namespace texcache
+{
+	//path of the cache sidecar for imageFile
+	string cachePath(const string& imageFile);
+
+	//maps the cache for imageFile into cache and checks it against the current image
+	//false if the cache is missing, stale or from another version (cache is closed then)
+	bool open(const string& imageFile, MappedFile& cache, TextureImage& image);
+
+	//converts surface to the cache pixel format and builds its mip chain in pixels
+	bool convert(SDL_Surface* surface, vector<uint8_t>& pixels, TextureImage& image);
+
+	//writes a fresh cache for imageFile holding image
+	bool write(const string& imageFile, const TextureImage& image);
+
+	//open, or decode + convert + write when there is no valid cache
+	//image points into cache or pixels, which have to outlive it
+	bool load(const string& imageFile, MappedFile& cache, vector<uint8_t>& pixels, TextureImage& image);
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef UNIFORMBUFFERS_INCLUDED
+#define UNIFORMBUFFERS_INCLUDED
+
+#include "glad.h"
+
+#define GLM_FORCE_RADIANS
+#include "glm/glm.hpp"
+
+#include <vector>
+
+#include "Material.h"
+#include "StreamBuffer.h"
+
+using namespace std;
+
+//uniform block binding points, shared by every program (set by ShaderProgram at link time)
+#define FRAME_BLOCK_BINDING 0
+#define MATERIAL_BLOCK_BINDING 1
+#define MESH_BLOCK_BINDING 2
+
+//block names in the shaders
+#define FRAME_BLOCK_NAME "FrameData"
+#define MATERIAL_BLOCK_NAME "Materials"
+#define MESH_BLOCK_NAME "Meshes"
+
+//size of the materials[] array in the Materials block, has to match the shaders
+//(256 * 48 bytes stays under the 16 KB every GL 3.x driver allows per block)
+#define MAX_MATERIALS 256
+
+//size of the meshes[] array in the Meshes block, has to match the shaders
+//(meshes drawn in one frame past this start another copy of the block)
+#define MAX_DRAW_MESHES 256
+
+//std140 layout of the FrameData block
+struct FrameBlock
+{
+	glm::mat4 view;
+	glm::mat4 proj;
+	glm::vec4 light_dir;	//view space, w unused
+	float time;						//seconds since SDL_Init
+	int oct_normals;			//model VBO holds octahedral normals
+	float pad[2];
+};
+
+//std140 layout of one materials[] entry
+struct MaterialBlock
+{
+	glm::vec4 ka;		//w unused
+	glm::vec4 kd;		//w unused
+	glm::vec4 ks_s;	//specular color, phong exponent in w
+};
+
+//std140 layout of one meshes[] entry : undoes a mesh's packed vertex format
+//(MeshQuantization), so meshes packed differently can share a draw
+struct MeshBlock
+{
+	glm::vec4 pos_scale;		//w unused
+	glm::vec4 pos_bias;			//w unused
+	glm::vec4 uv_scale_bias;	//scale in xy, bias in zw
+};
+
+static_assert(sizeof(FrameBlock) == 160, "FrameBlock has to match the std140 FrameData block");
+static_assert(sizeof(MaterialBlock) == 48, "MaterialBlock has to match the std140 MaterialData struct");
+static_assert(sizeof(MeshBlock) == 48, "MeshBlock has to match the std140 MeshData struct");
+
+//per-frame camera and frame constants, written once per frame and bound to FRAME_BLOCK_BINDING
+class FrameUniforms
+{
+public:
+	//OTHERS
+	//GL thread : writes frame into this frame's part of stream, so the GPU can still
+	//be reading earlier frames' copies, and binds it
+	void update(const FrameBlock& frame, StreamBuffer& stream);
+};
+
+//every material in the scene, bound to MATERIAL_BLOCK_BINDING
+//draws don't set any material uniforms, each instance carries its index (InstanceData::material)
+class MaterialTable
+{
+public:
+	//CONSTRUCTORS AND DESTRUCTORS
+	MaterialTable();
+	~MaterialTable();	//GL thread
+
+	//GETTERS
+	int getCount();
+
+	//SETTERS
+	void set(int id, Material m);
+
+	//OTHERS
+	int add(Material m);	//id of m, reusing an identical material (0 once the table is full)
+	void upload();	//GL thread : writes the entries changed since the last upload
+
+private:
+	vector<MaterialBlock> blocks;
+	int dirty_begin;	//changed range [dirty_begin, dirty_end)
+	int dirty_end;
+	GLuint ubo;
+
+	void markDirty(int id);
+
+	//owns a GL buffer, so no copies
+	MaterialTable(const MaterialTable&);
+	MaterialTable& operator=(const MaterialTable&);
+};
+
+#endif
@@ -29,9 +29,23 @@
 
 #include "Vec3D.h"
 #include "Camera.h"
+#include "MappedFile.h"
+#include "ModelParser.h"
+#include "TextureCache.h"
 
 using namespace std;
 
+//fixed vertex attribute locations, bound to every program before linking
+//so VAOs can be built before their shaders are compiled
+#define POSITION_ATTRIB 0
+#define TEXCOORD_ATTRIB 1
+#define NORMAL_ATTRIB 2
+#define INSTANCE_MVP_ATTRIB 3			//mat4, takes 3 to 6
+#define INSTANCE_MODELVIEW_ATTRIB 7	//mat4, takes 7 to 10
+#define INSTANCE_NORMAL_ATTRIB 11		//mat3, takes 11 to 13
+#define INSTANCE_MATERIAL_ATTRIB 14
+#define INSTANCE_MESH_ATTRIB 15			//the last of the 16 attributes GL 3.2 guarantees
+
 namespace util
 {
 	//
@@ -41,6 +55,9 @@ namespace util
 	//stores number of vertices within ref param num_verts
 	float* loadModel(string filename, int& num_verts);
 
+	//original ifstream >> loader, kept to compare parse throughput against
+	float* loadModelStream(string filename, int& num_verts);
+
 	//converts Vec3D to glm vec3
 	glm::vec3 vec3DtoGLM(Vec3D v);
 
@@ -48,7 +65,18 @@ namespace util
 	//http://www.nexcius.net/2012/11/20/how-to-load-a-glsl-shader-in-opengl-using-c/
 	GLuint LoadShader(const char *vertex_path, const char *fragment_path);
 
+	//LoadShader split in two for the AssetLoader :
+	//ReadShaderFile is safe on any thread, CompileShader needs the GL thread
+	std::string ReadShaderFile(const char *filePath);
+	GLuint CompileShader(const char *vertShaderSrc, const char *fragShaderSrc);
+
+	//goes through the texture cache (textures/*.tcache)
 	GLuint LoadTexture(const char* texFile);
+
+	//LoadTexture split in two for the AssetLoader :
+	//texcache::load / DecodeTexture are safe on any thread, UploadTexture needs the GL thread
+	SDL_Surface* DecodeTexture(const char* texFile);
+	GLuint UploadTexture(const TextureImage& image);
 }
 
 #endif
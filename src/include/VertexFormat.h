@@ -0,0 +1,88 @@
+#ifndef VERTEXFORMAT_INCLUDED
+#define VERTEXFORMAT_INCLUDED
+
+#include "glad.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "MeshData.h"
+
+using namespace std;
+
+//GPU layouts for the MODEL_VERT_FLOATS vertices, picked once for the shared model VBO
+enum PositionFormat
+{
+	POSITION_FLOAT3,		//12 bytes
+	POSITION_UNORM16		//8 bytes (4th short is padding), quantized to the mesh bounds
+};
+
+enum TexcoordFormat
+{
+	TEXCOORD_FLOAT2,		//8 bytes
+	TEXCOORD_HALF2,			//4 bytes
+	TEXCOORD_UNORM16		//4 bytes, quantized to the mesh's texcoord range
+};
+
+enum NormalFormat
+{
+	NORMAL_FLOAT3,			//12 bytes
+	NORMAL_SNORM10,			//4 bytes, GL_INT_2_10_10_10_REV (GL 3.3 or ARB_vertex_type_2_10_10_10_rev)
+	NORMAL_OCT_SNORM16	//4 bytes, octahedral, decoded in the vertex shader
+};
+
+struct VertexFormat
+{
+	PositionFormat position;
+	TexcoordFormat texcoord;
+	NormalFormat normal;
+
+	VertexFormat() : position(POSITION_FLOAT3), texcoord(TEXCOORD_HALF2), normal(NORMAL_SNORM10) {}
+	VertexFormat(PositionFormat p, TexcoordFormat t, NormalFormat n) : position(p), texcoord(t), normal(n) {}
+};
+
+//shader side dequantization : attribute * scale + bias
+//(scale 1, bias 0 for the float and half formats)
+struct MeshQuantization
+{
+	float pos_scale[3];
+	float pos_bias[3];
+	float uv_scale[2];
+	float uv_bias[2];
+
+	MeshQuantization();
+};
+
+//a mesh converted to a VertexFormat, with 16-bit indices when they fit
+struct PackedMesh
+{
+	vector<uint8_t> verts;
+	int num_verts = 0;
+	vector<uint8_t> indices;
+	int num_indices = 0;
+	int index_size = 4;	//bytes, 2 when num_verts <= 65535
+	MeshQuantization quant;
+	MeshBounds bounds;	//of the float positions, for culling
+	vector<MeshLOD> lods;	//at least one, LOD 0 is the full mesh
+};
+
+namespace vertexformat
+{
+	//bytes per vertex
+	int stride(const VertexFormat& fmt);
+
+	//swaps formats this GL context can't fetch for ones it can
+	VertexFormat supported(const VertexFormat& fmt);
+
+	//converts mesh to fmt, picking 16 or 32-bit indices, and measures its bounds
+	void pack(const VertexFormat& fmt, const MeshView& mesh, PackedMesh& out);
+
+	//points the bound VAO's position / texcoord / normal attributes at the bound
+	//GL_ARRAY_BUFFER laid out as fmt
+	void setAttribs(const VertexFormat& fmt);
+
+	//GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	GLenum indexType(int index_size);
+}
+
+#endif
@@ -29,62 +29,158 @@
 #include "Camera.h"
 #include "Util.h"
 #include "WorldObject.h"
+#include "AssetLoader.h"
+#include "ResourceManager.h"
+#include "UniformBuffers.h"
+#include "RenderQueue.h"
+#include "Frustum.h"
+#include "SceneBVH.h"
+#include "VertexFormat.h"
+
+//models the World loads through the ResourceManager
+enum WorldModel
+{
+	CUBE_MODEL,
+	SPHERE_MODEL,
+	CYLINDER_MODEL,
+	TEAPOT_MODEL,
+	KNOT_MODEL,
+	NUM_MODELS
+};
+
+//an object draws the coarsest LOD whose error covers at most this many pixels on
+//screen, and only coarsens once the next LOD's is this fraction under it (so objects
+//sitting at a switching distance don't flicker between two LODs)
+#define LOD_ERROR_PIXELS 1.0f
+#define LOD_HYSTERESIS 0.25f
+
+//the cylinder bounces between these heights
+#define BOUNCE_BOTTOM -3.0f
+#define BOUNCE_HEIGHT 1.0f
+#define BOUNCE_GRAVITY -9.8f
+
+//a row of teapots and knots going off into the distance
+#define CROWD_SIZE 20
+
+//scripted scenes for the benchmark, built by initBench instead of init
+enum BenchScene
+{
+	BENCH_CUBES,			//count instances of one mesh in a grid
+	BENCH_SPHERES,
+	BENCH_TEAPOTS,
+	BENCH_KNOTS,
+	BENCH_OVERDRAW,		//screen-filling spheres stacked along the view
+	BENCH_MATERIALS,	//a grid of cubes, each with its own material, two textures
+	BENCH_MIXED,			//a grid of cubes, spheres, teapots and knots in turn, one texture
+	NUM_BENCH_SCENES
+};
 
-#include "timerutil.h"
-#include "tiny_obj_loader.h"
+//screen-filling layers the overdraw scene stops at, whatever the count
+#define BENCH_OVERDRAW_LAYERS 64
+
+//textures the World loads through the ResourceManager
+enum WorldTexture
+{
+	WOOD_TEXTURE,
+	STONE_TEXTURE,
+	NUM_TEXTURES
+};
 
 class World{
 private:
 	int width;
 	int height;
 
-	//modelData
-	int total_model_verts = 0;
-	float* modelData;
-	int CUBE_START = 0;
-	int CUBE_VERTS = 0;
-	int SPHERE_START = 0;
-	int SPHERE_VERTS = 0;
-
-	//OBJ data
-	int total_obj_triangles = 0;
-	tinyobj::attrib_t obj_attrib;
-	vector<tinyobj::shape_t> obj_shapes;
-	vector<tinyobj::material_t> obj_materials;
-
-	//VAO and VBO GLuints
-	GLuint model_vao;
-	GLuint model_vbo[1];	//interleaved vert pos, tex, norm
-	GLuint obj_vao;
-	GLuint obj_vbos[3];		//vertices, normals, texcoords
-	GLuint obj_ibo[1];
-
-	//Shader and Texture GLuints
-	GLuint phongProgram;
-	GLuint tex0;
-	GLuint tex1;
+	//pixels drawn to, for the projection's aspect and LOD selection
+	int view_width = 800;
+	int view_height = 600;
+
+	//assets, owned by the ResourceManager
+	//the World holds one reference to each of these, every object one to its own
+	ResourceManager* resources;
+	static const char* model_files[NUM_MODELS];	//.txt or .obj
+	static const char* texture_files[NUM_TEXTURES];
+	MeshHandle models[NUM_MODELS];
+	TextureHandle textures[NUM_TEXTURES];
+	ProgramHandle phongProgram;
+
+	//per-frame data for the GPU (frame constants, instances), written without waiting on it
+	StreamBuffer stream;
+
+	//uniform blocks shared by every program
+	FrameUniforms frame_uniforms;	//camera and frame constants, rewritten every frame
+	MaterialTable materials;			//indexed by WorldObject::getMaterialID
+
+	//every object submits a packet, sorted and drawn instanced each frame
+	RenderQueue queue;
+
+	//proj_scale : pixels per unit of size at distance 1
+	void submitObject(WorldObject* wobj, const glm::mat4& view, const glm::vec3& eye, float proj_scale, float alpha);
+	int selectLOD(WorldObject* wobj, const glm::vec3& eye, float proj_scale);
+
+	//every object whose mesh is loaded, for culling and other spatial queries
+	SceneBVH scene;
+	vector<WorldObject*> unplaced;	//waiting for their mesh's bounds
+	vector<int> moved;
+
+	void updateScene();
+	bool getObjectBounds(WorldObject* wobj, glm::vec3& center, glm::vec3& extents, float& radius);
+
+	//objects entirely outside the view frustum aren't submitted
+	//the BVH rejects and accepts whole subtrees, objects in subtrees straddling
+	//the frustum go through the culler
+	Frustum frustum;
+	bool freeze_frustum = false;	//keeps culling against the frustum it froze with
+	vector<WorldObject*> inside;
+	vector<WorldObject*> partial;
+	FrustumCuller culler;
+	vector<WorldObject*> cull_objects;	//by culler index
+	vector<uint8_t> visible;						//by culler index
+	CullStats cull_stats;
 
 	//objects in World
-	WorldObject* floor;
-	WorldObject* obj;
+	WorldObject* floor = nullptr;
+	WorldObject* obj = nullptr;
+	vector<WorldObject*> crowd;
+	vector<WorldObject*> objects;	//all of the above, for the simulation
+
+	void releaseObject(WorldObject* wobj);
 
 public:
 	//CONSTRUCTORS AND DESTRUCTORS
-	World();
-	World(int w, int h);
-	~World();
+	World(ResourceManager* res);
+	World(int w, int h, ResourceManager* res);
+	~World();	//releases its references, resources outlive the World
 	void init();
+	void initBench(BenchScene scene, int count);	//instead of init, nothing moves
+
+	static const char* bench_scenes[NUM_BENCH_SCENES];	//names in results
 
 	//SETTERS
+	void setWeldEpsilon(float eps);	//call before loadModelData
+	void setOptimizeOverdraw(bool on);	//call before loadModelData
+	void setVertexFormat(VertexFormat fmt);	//call before loadModelData
+	void setFreezeFrustum(bool on);	//debugging : move the camera around a fixed frustum
+	void setViewport(int w, int h);	//window or offscreen target size
 
 	//GETTERS
 	int getWidth();
 	int getHeight();
+	const RenderStats& getRenderStats();	//of the last draw
+	const CullStats& getCullStats();	//of the last draw
+	const StreamStats& getStreamStats();	//of the last draw
+	bool getFreezeFrustum();
+	SceneBVH* getScene();	//frustum, ray, sphere and box queries over the objects
 
 	//OTHERS
 	bool loadModelData();
 	bool setupGraphics();
-	void draw(Camera * cam);
+
+	//one fixed simulation tick of dt seconds
+	void update(float dt);
+
+	//alpha : how far the time being drawn is from the previous tick to the last one (0 - 1)
+	void draw(Camera * cam, float alpha);
 
 };
 
@@ -5,6 +5,9 @@
 #include "Util.h"
 #include "Camera.h"
 #include "Material.h"
+#include "ResourceManager.h"
+
+class SceneBVH;
 
 enum WOBJ_type
 {
@@ -17,43 +20,63 @@ protected:
 	Vec3D pos;
   Vec3D vel;
   Vec3D acc;
+	Vec3D prev_pos;	//pos before the last step, drawing blends from it to pos
 
 	Material mat;
+	int material_id;	//entry of mat in the World's MaterialTable
 	Vec3D size;
-	int start_vertex_index;	//index where vertices start in modelData array
-	int total_vertices;	//total num of vertices within modelData array
+	MeshHandle mesh;	//the references are held (and released) by whoever sets them
+	TextureHandle texture;	//null : untextured
 
-public:
-	//PUBLIC VARIABLES
-	bool hasIBO = false;
+	//the BVH holding this object, told when pos or size change
+	SceneBVH* scene;
+	int scene_proxy;
 
+	int lod;	//level of detail drawn last frame, the World picks the next one from it
+
+public:
 	//CONSTRUCTORS AND DESTRUCTORS
 	WorldObject();
 	WorldObject(Vec3D init_pos);
 	~WorldObject();
 
 	//SETTERS
-	void setPos(Vec3D p);
+	void setPos(Vec3D p);	//places the object there, without blending from where it was
 	void setVel(Vec3D v);
 	void setAcc(Vec3D a);
-	void setVertexInfo(int start, int total);
+	void setMesh(MeshHandle m);
+	void setTexture(TextureHandle t);
 	void setMaterial(Material m);
+	void setMaterialID(int id);
 	void setSize(Vec3D s);
 	void setColor(Vec3D color); //sets ambient and diffuse to 'color'
+	void setSceneProxy(SceneBVH* s, int proxy);	//by whoever inserts it, nullptr / -1 on removal
+	void setLOD(int l);
 
 	//GETTERS
 	Vec3D getPos();
 	Vec3D getVel();
 	Vec3D getAcc();
 	Material getMaterial();
+	int getMaterialID();
 	Vec3D getSize();
+	MeshHandle getMesh();
+	TextureHandle getTexture();
+	int getSceneProxy();	//-1 when not in a BVH
+	int getLOD();
+	glm::mat4 getModelMatrix();	//translation and scale
+	glm::mat4 getModelMatrix(float alpha);	//at the position alpha of the way through the last step
+
+	//b (the mesh's object space bounds) moved by pos and size, swept over the last step
+	void getWorldBounds(const MeshBounds& b, glm::vec3& center, glm::vec3& extents, float& radius);
+
+	//OTHERS
+	//one fixed simulation tick of dt seconds (semi-implicit Euler)
+	void step(float dt);
 
 	//VIRTUAL
 	virtual int getType();
 
-	//OTHER
-	void draw(GLuint shaderProgram); //shared draw function among WObjs
-
 };
 
 #endif
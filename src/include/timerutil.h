@@ -1,3 +1,6 @@
+#ifndef TIMERUTIL_INCLUDED
+#define TIMERUTIL_INCLUDED
+
 #ifdef _WIN32
 #ifdef __cplusplus
 extern "C" {
@@ -81,3 +84,5 @@ class timerutil {
 #endif
 #endif
 };
+
+#endif
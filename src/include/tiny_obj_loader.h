@@ -332,6 +332,17 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
              const char *filename, const char *mtl_basedir = NULL,
              bool triangulate = true);
 
+/// Loads .obj from a file using multiple threads.
+/// The file is memory mapped and split at line boundaries, each thread parses
+/// the `v', `vn', `vt' and `f' lines of its chunk, and the chunks are merged
+/// with relative/negative indices resolved as if read serially. The result is
+/// identical to LoadObj().
+/// 'num_threads' <= 0 uses one thread per core (small files use fewer).
+bool LoadObjParallel(attrib_t *attrib, std::vector<shape_t> *shapes,
+                     std::vector<material_t> *materials, std::string *err,
+                     const char *filename, const char *mtl_basedir = NULL,
+                     bool triangulate = true, int num_threads = 0);
+
 /// Loads .obj from a file with custom user callback.
 /// .mtl is loaded as usual and parsed material_t data will be passed to
 /// `callback.mtllib_cb`.
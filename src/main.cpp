@@ -31,6 +31,9 @@
 #include <string>
 
 //MY CLASSES
+#include "Bench.h"
+#include "Headless.h"
+#include "Profiler.h"
 #include "Util.h"
 #include "World.h"
 
@@ -43,6 +46,20 @@ bool fullscreen = false;
 int screen_width = 800;
 int screen_height = 600;
 
+//--headless : no window, renders headless_frames frames offscreen and exits
+//--size WxH : resolution (window or offscreen), --frames N, --out FILE.ppm : last frame
+bool headless_mode = false;
+int headless_frames = 100;
+string headless_out = "";
+
+//--bench : draws the benchmark scenes (headless or windowed), compares them to a baseline and exits
+//--count N, --bench-out FILE.json, --baseline FILE.json, --threshold PERCENT, --frames as above
+bool bench_mode = false;
+BenchOptions bench_options;
+
+//written by the P key, open in chrome://tracing or ui.perfetto.dev
+string profileFile = "profile.json";
+
 //shader globals
 string vertFile = "Shaders/phong.vert";
 string fragFile = "Shaders/phong.frag";
@@ -51,9 +68,15 @@ string fragFile = "Shaders/phong.frag";
 const float mouse_speed = 0.05f;
 const float step_size = 0.15f;
 
+//simulation ticks per second, and the most one frame runs
+const int sim_hz = 120;
+const int max_sim_steps = 8;
+
 /*=============================*/
 // Helper Functions
 /*=============================*/
+bool parseOptions(int argc, char *argv[]);
+void runHeadless(World* myWorld, AssetLoader* loader, ResourceManager* resources, Camera* cam);
 void onKeyDown(SDL_KeyboardEvent & event, Camera* cam, World* myWorld);
 void mouseMove(SDL_MouseMotionEvent & event, Camera * player, float horizontal_angle, float vertical_angle);
 
@@ -62,9 +85,10 @@ void mouseMove(SDL_MouseMotionEvent & event, Camera * player, float horizontal_a
 /*==============================================================*/
 int main(int argc, char *argv[]) {
 	//CHECK FOR WIDTH AND HEIGHT VALUES
-	if (argc != 3)
+	if (argc < 3 || !parseOptions(argc, argv))
 	{
-		cout << "\nERROR: Incorrect usage. Expected ./a.out WIDTH HEIGHT\n";
+		cout << "\nERROR: Incorrect usage. Expected ./a.out WIDTH HEIGHT [--headless] [--size WxH] [--frames N] [--out FILE.ppm]"
+			<< " [--bench] [--count N] [--bench-out FILE] [--baseline FILE] [--threshold PERCENT]\n";
 		exit(0);
 	}
 
@@ -74,27 +98,72 @@ int main(int argc, char *argv[]) {
 	/////////////////////////////////
 	//INITIALIZE SDL WINDOW
 	/////////////////////////////////
-	SDL_GLContext context;
-	SDL_Window* window = util::initSDL(context, screen_width, screen_height);
+	SDL_GLContext context = NULL;
+	SDL_Window* window = NULL;
+
+	if (headless_mode)
+	{
+		//no video, SDL only keeps time
+		SDL_Init(SDL_INIT_TIMER);
+		if (!headless::initContext() || !headless::createTarget(screen_width, screen_height))
+		{
+			cout << "ERROR: Headless context failed." << endl;
+			headless::shutdown();
+			SDL_Quit();
+			exit(0);
+		}
+	}
+	else
+	{
+		window = util::initSDL(context, screen_width, screen_height);
+		if (window == NULL)
+		{
+			cout << "ERROR: initSDL() failed." << endl;
+			SDL_GL_DeleteContext(context);
+			SDL_Quit();
+			exit(0);
+		}
+	}
+
+	Uint32 start_time = SDL_GetTicks();
+
+	//GPU timers need the context
+	profiler::init();
 
-	if (window == NULL)
+	//decodes assets on worker threads while the window is already drawing
+	AssetLoader* loader = new AssetLoader();
+	ResourceManager* resources = new ResourceManager(loader);	//every mesh, texture and shader, loaded once
+
+	//scripted scenes instead of the normal World, exits non-zero on a regression
+	if (bench_mode)
 	{
-		cout << "ERROR: initSDL() failed." << endl;
+		bench_options.width = screen_width;
+		bench_options.height = screen_height;
+		bool ok = bench::run(resources, loader, window, bench_options);
+
+		delete loader;
+		delete resources;
+		profiler::shutdown();
+		if (headless_mode) headless::shutdown();
 		SDL_GL_DeleteContext(context);
 		SDL_Quit();
-		exit(0);
+		return ok ? 0 : 1;
 	}
 
-	World* myWorld = new World(w, h);
+	World* myWorld = new World(w, h, resources);
+	myWorld->setViewport(screen_width, screen_height);
 
 	/////////////////////////////////
-	//LOAD MODEL DATA INTO WORLD
+	//QUEUE MODEL DATA INTO WORLD
 	/////////////////////////////////
 	if (!myWorld->loadModelData())
 	{
 		cout << "ERROR. Unable to load model data." << endl;
 		//Clean up
-		myWorld->~World();
+		delete loader;
+		delete myWorld;
+		delete resources;
+		if (headless_mode) headless::shutdown();
 		SDL_GL_DeleteContext(context);
 		SDL_Quit();
 		exit(0);
@@ -108,6 +177,7 @@ int main(int argc, char *argv[]) {
 	cam->setPos(Vec3D(0, 0, 10));					//start back along +z
 	cam->setUp(Vec3D(0, 1, 0));						//map is in xz plane
 	cam->setRight(Vec3D(1, 0, 0));				//look along -z
+	cam->setHA(22.5f);										//vertical, in degrees
 
 	/////////////////////////////////
 	//SETUP MOUSE INITIAL STATE
@@ -116,105 +186,238 @@ int main(int argc, char *argv[]) {
 	float vertical_angle = 0.0f;
 
 	/////////////////////////////////
-	//BUILD VAO + VBO + SHADERS + TEXTURES
+	//BUILD VAO + VBO, QUEUE SHADERS + TEXTURES
 	/////////////////////////////////
 	if (!myWorld->setupGraphics())
 	{
 		//Clean Up
+		delete loader;
+		delete myWorld;
+		delete resources;
+		if (headless_mode) headless::shutdown();
 		SDL_GL_DeleteContext(context);
 		SDL_Quit();
-		myWorld->~World();
 		cam->~Camera();
+		exit(0);
 	}
 
 	myWorld->init();
 
+	//a fixed number of frames instead of the event loop
+	if (headless_mode) runHeadless(myWorld, loader, resources, cam);
+
 	/*===========================================================================================
 	* EVENT LOOP (Loop forever processing each event as fast as possible)
 	* List of keycodes: https://wiki.libsdl.org/SDL_Keycode - You can catch many special keys
 	* Scancode referes to a keyboard position, keycode referes to the letter (e.g., EU keyboards)
 	===========================================================================================*/
 	SDL_Event windowEvent;
-	bool quit = false;
+	bool quit = headless_mode;
 	bool mouse_active = false;
 	bool recentering = true;
-	float last_time = SDL_GetTicks(),	delta_time = 0,	new_time = 0;
 
 	float mouse_x, mouse_y;
 
+	//the simulation runs in fixed ticks on a monotonic high resolution clock, whatever the frame rate
+	const double sim_dt = 1.0 / sim_hz;
+	const double counter_freq = (double)SDL_GetPerformanceFrequency();
+	Uint64 last_counter = SDL_GetPerformanceCounter();
+	double sim_accumulator = 0.0;	//time not simulated yet, less than a tick after each frame
+
 	//FPS calculations
-	float framecount = 0;
-	float fps = 0, last_fps_print = 0.0;
+	int framecount = 0;
+	double fps_time = 0.0;
+
+	//load time reporting
+	bool first_frame = true;
+	bool assets_loaded = false;
 
 	while (!quit)
 	{
-		if (SDL_PollEvent(&windowEvent)) {
-			switch (windowEvent.type) //event type -- key up or down
+		profiler::beginFrame();
+
+		//every pending event, so a flood of mouse motion can't queue up behind the frames
+		{
+			PROFILE_ZONE("Events");
+			while (SDL_PollEvent(&windowEvent)) {
+				switch (windowEvent.type) //event type -- key up or down
+				{
+					case SDL_QUIT:
+						quit = true; //Exit event loop
+						break;
+					case SDL_KEYDOWN:
+						//check for escape or fullscreen before checking other commands
+						if (windowEvent.key.keysym.sym == SDLK_ESCAPE) quit = true; //Exit event loop
+						else if (windowEvent.key.keysym.sym == SDLK_f)
+						{
+							fullscreen = !fullscreen;
+							SDL_SetWindowFullscreen(window, fullscreen ? SDL_WINDOW_FULLSCREEN : 0); //Set to full screen
+						}
+						onKeyDown(windowEvent.key, cam, myWorld);
+						break;
+					case SDL_MOUSEMOTION:
+						if (recentering)
+						{
+							SDL_WarpMouseInWindow(window, screen_width / 2, screen_height / 2);
+							mouse_active = true;
+						}
+						else if (mouse_active && !recentering)
+						{
+							mouse_x = windowEvent.motion.x;
+							mouse_y = windowEvent.motion.y;
+							mouseMove(windowEvent.motion, cam, horizontal_angle, vertical_angle);
+							// recentering = true;
+						}
+					default:
+						break;
+					}//END polling switch
+			}//END polling While
+
+			if (mouse_active)
 			{
-				case SDL_QUIT:
-					quit = true; //Exit event loop
-					break;
-				case SDL_KEYDOWN:
-					//check for escape or fullscreen before checking other commands
-					if (windowEvent.key.keysym.sym == SDLK_ESCAPE) quit = true; //Exit event loop
-					else if (windowEvent.key.keysym.sym == SDLK_f) fullscreen = !fullscreen;
-					onKeyDown(windowEvent.key, cam, myWorld);
-					break;
-				case SDL_MOUSEMOTION:
-					if (recentering)
-					{
-						SDL_WarpMouseInWindow(window, screen_width / 2, screen_height / 2);
-						mouse_active = true;
-					}
-					else if (mouse_active && !recentering)
-					{
-						mouse_x = windowEvent.motion.x;
-						mouse_y = windowEvent.motion.y;
-						mouseMove(windowEvent.motion, cam, horizontal_angle, vertical_angle);
-						// recentering = true;
-					}
-				default:
-					break;
-				}//END polling switch
-
-			SDL_SetWindowFullscreen(window, fullscreen ? SDL_WINDOW_FULLSCREEN : 0); //Set to full screen
-		}//END polling If
-
-		if (mouse_active)
+				recentering = false;
+			}
+		}
+
+		//upload whatever the loader finished decoding (objects appear once their assets are in)
+		{
+			PROFILE_ZONE("Upload");
+			loader->pump();
+		}
+		if (!assets_loaded && loader->isDone())
 		{
-			recentering = false;
+			assets_loaded = true;
+			printf("All assets loaded in %u ms (%d failed)\n", SDL_GetTicks() - start_time, loader->getFailed());
+			resources->printReport();
 		}
 
-		//draw all WObjs
-		myWorld->draw(cam);
+		//seconds since the last frame
+		Uint64 counter = SDL_GetPerformanceCounter();
+		double frame_time = (counter - last_counter) / counter_freq;
+		last_counter = counter;
+
+		//as many ticks as fit in the time that passed
+		//after a long stall (loading, a dragged window) the simulation skips ahead instead of catching up
+		sim_accumulator += min(frame_time, max_sim_steps * sim_dt);
+		{
+			PROFILE_ZONE("Update");
+			while (sim_accumulator >= sim_dt)
+			{
+				myWorld->update((float)sim_dt);
+				sim_accumulator -= sim_dt;
+			}
+		}
 
-		//delta_time is in seconds so convert ticks (ms) by * 1000
-		new_time = SDL_GetTicks();
-		delta_time = (new_time - last_time) / 1000.0;
-		last_time = new_time;
+		//draw all WObjs, between the last two ticks by what's left over
+		myWorld->draw(cam, (float)(sim_accumulator / sim_dt));
 
-		if ((new_time - last_fps_print) / 1000.0 >= 1.0) //only print every 1+ seconds
+		fps_time += frame_time;
+		if (fps_time >= 1.0) //only print every 1+ seconds
 		{
-			fps = framecount;
-			last_fps_print = new_time;
-			printf("FPS: %f\n", fps);
+			printf("FPS: %f\n", framecount / fps_time);
+			myWorld->getRenderStats().print();
+			myWorld->getCullStats().print();
+			myWorld->getStreamStats().print();
+			profiler::printSummary(framecount);
 			framecount = 0;
+			fps_time = 0.0;
 		}
 
-		SDL_GL_SwapWindow(window);
+		{
+			PROFILE_ZONE("SwapWindow");
+			SDL_GL_SwapWindow(window);
+		}
+		profiler::endFrame();
 		framecount++;
 
+		if (first_frame)
+		{
+			first_frame = false;
+			printf("Time to first frame: %u ms\n", SDL_GetTicks() - start_time);
+		}
+
 	}//END looping While
 
 	//Clean Up
+	delete loader;	//stop the workers before the resources they write into go away
+	delete myWorld;	//releases its references
+	resources->evictUnused();
+	delete resources;	//needs the GL context
+	profiler::shutdown();
+	if (headless_mode) headless::shutdown();
 	SDL_GL_DeleteContext(context);
 	SDL_Quit();
-	myWorld->~World();
 	cam->~Camera();
 
 	return 0;
 }//END MAIN
 
+/*--------------------------------------------------------------*/
+// parseOptions : reads the flags after WIDTH HEIGHT into the globals
+/*--------------------------------------------------------------*/
+bool parseOptions(int argc, char *argv[])
+{
+	for (int i = 3; i < argc; i++)
+	{
+		string arg = argv[i];
+		bool has_value = (i + 1 < argc);
+
+		if (arg == "--headless") headless_mode = true;
+		else if (arg == "--frames" && has_value) headless_frames = bench_options.frames = atoi(argv[++i]);
+		else if (arg == "--out" && has_value) headless_out = argv[++i];
+		else if (arg == "--bench") bench_mode = true;
+		else if (arg == "--count" && has_value) bench_options.count = atoi(argv[++i]);
+		else if (arg == "--bench-out" && has_value) bench_options.out = argv[++i];
+		else if (arg == "--baseline" && has_value) bench_options.baseline = argv[++i];
+		else if (arg == "--threshold" && has_value) bench_options.threshold = atof(argv[++i]);
+		else if (arg == "--size" && has_value)
+		{
+			if (sscanf(argv[++i], "%dx%d", &screen_width, &screen_height) != 2) return false;
+		}
+		else
+		{
+			cout << "\nERROR: Unknown option " << arg << endl;
+			return false;
+		}
+	}
+	return screen_width > 0 && screen_height > 0 && headless_frames > 0 && bench_options.count > 0;
+}
+
+/*--------------------------------------------------------------*/
+// runHeadless : draws headless_frames frames offscreen, one
+//				simulation tick each, and reports how long they took
+/*--------------------------------------------------------------*/
+void runHeadless(World* myWorld, AssetLoader* loader, ResourceManager* resources, Camera* cam)
+{
+	//every frame draws the whole scene, not whatever has streamed in so far
+	Uint32 load_start = SDL_GetTicks();
+	loader->finish();
+	printf("All assets loaded in %u ms (%d failed)\n", SDL_GetTicks() - load_start, loader->getFailed());
+	resources->printReport();
+
+	const double counter_freq = (double)SDL_GetPerformanceFrequency();
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	for (int i = 0; i < headless_frames; i++)
+	{
+		profiler::beginFrame();
+		myWorld->update(1.0f / sim_hz);
+		myWorld->draw(cam, 1.0f);
+		profiler::endFrame();
+	}
+	glFinish();	//the last frames are only queued until now
+
+	double seconds = (SDL_GetPerformanceCounter() - start) / counter_freq;
+	printf("Headless: %d frames at %dx%d in %.3f s (%.3f ms per frame, %.1f FPS)\n", headless_frames,
+		screen_width, screen_height, seconds, 1000.0 * seconds / headless_frames, headless_frames / seconds);
+	myWorld->getRenderStats().print();
+	myWorld->getCullStats().print();
+	myWorld->getStreamStats().print();
+	profiler::printSummary(headless_frames);
+
+	if (headless_out != "") headless::saveImage(headless_out);
+}
+
 /*--------------------------------------------------------------*/
 // onKeyDown : determine which key was pressed and how to edit
 //				current translation or rotation parameters
@@ -252,6 +455,18 @@ void onKeyDown(SDL_KeyboardEvent & event, Camera* cam, World* myWorld)
 		//printf("A key pressed - step to the left\n");
 		temp_pos = pos - (step_size*right);
 		break;
+	/////////////////////////////////
+	//DEBUG
+	/////////////////////////////////
+	case SDLK_c:
+		//freeze culling to walk around the frustum it was frozen with
+		myWorld->setFreezeFrustum(!myWorld->getFreezeFrustum());
+		printf("Frustum %s\n", myWorld->getFreezeFrustum() ? "frozen" : "unfrozen");
+		break;
+	case SDLK_p:
+		//the last PROFILER_FRAMES frames, zone by zone
+		profiler::writeChromeTrace(profileFile.c_str());
+		break;
 	default:
 		printf("ERROR: Invalid key pressed (%s)\n", SDL_GetKeyName(event.keysym.sym));
 		break;
@@ -1,4 +1,5 @@
 #include "tiny_obj_loader.h"
+#include "MappedFile.h"
 
 //#ifdef TINYOBJLOADER_IMPLEMENTATION
 #include <cassert>
@@ -9,8 +10,10 @@
 #include <cstring>
 #include <utility>
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
+#include <thread>
 
 namespace tinyobj {
 
@@ -647,20 +650,15 @@ static int pnpoly(int nvert, float *vertx, float *verty, float testx,
   return c;
 }
 
+// Flatten faces [0, num_faces) into mesh. Every face only appends its own
+// indices, so disjoint face ranges can be exported independently.
 // TODO(syoyo): refactor function.
-static bool exportFaceGroupToShape(shape_t *shape,
-                                   const std::vector<face_t> &faceGroup,
-                                   const std::vector<tag_t> &tags,
-                                   const int material_id,
-                                   const std::string &name, bool triangulate,
-                                   const std::vector<real_t> &v) {
-  if (faceGroup.empty()) {
-    return false;
-  }
-
+static void exportFaces(mesh_t *mesh, const face_t *faces, size_t num_faces,
+                        const int material_id, bool triangulate,
+                        const std::vector<real_t> &v) {
   // Flatten vertices and indices
-  for (size_t i = 0; i < faceGroup.size(); i++) {
-    const face_t &face = faceGroup[i];
+  for (size_t i = 0; i < num_faces; i++) {
+    const face_t &face = faces[i];
 
     if (face.vertex_indices.size() < 3) {
       // Face must have 3+ vertices.
@@ -789,13 +787,13 @@ static bool exportFaceGroupToShape(shape_t *shape,
           idx2.normal_index = ind[2].vn_idx;
           idx2.texcoord_index = ind[2].vt_idx;
 
-          shape->mesh.indices.push_back(idx0);
-          shape->mesh.indices.push_back(idx1);
-          shape->mesh.indices.push_back(idx2);
+          mesh->indices.push_back(idx0);
+          mesh->indices.push_back(idx1);
+          mesh->indices.push_back(idx2);
 
-          shape->mesh.num_face_vertices.push_back(3);
-          shape->mesh.material_ids.push_back(material_id);
-          shape->mesh.smoothing_group_ids.push_back(face.smoothing_group_id);
+          mesh->num_face_vertices.push_back(3);
+          mesh->material_ids.push_back(material_id);
+          mesh->smoothing_group_ids.push_back(face.smoothing_group_id);
         }
 
         // remove v1 from the list
@@ -824,13 +822,13 @@ static bool exportFaceGroupToShape(shape_t *shape,
           idx2.normal_index = i2.vn_idx;
           idx2.texcoord_index = i2.vt_idx;
 
-          shape->mesh.indices.push_back(idx0);
-          shape->mesh.indices.push_back(idx1);
-          shape->mesh.indices.push_back(idx2);
+          mesh->indices.push_back(idx0);
+          mesh->indices.push_back(idx1);
+          mesh->indices.push_back(idx2);
 
-          shape->mesh.num_face_vertices.push_back(3);
-          shape->mesh.material_ids.push_back(material_id);
-          shape->mesh.smoothing_group_ids.push_back(face.smoothing_group_id);
+          mesh->num_face_vertices.push_back(3);
+          mesh->material_ids.push_back(material_id);
+          mesh->smoothing_group_ids.push_back(face.smoothing_group_id);
         }
       }
     } else {
@@ -839,16 +837,68 @@ static bool exportFaceGroupToShape(shape_t *shape,
         idx.vertex_index = face.vertex_indices[k].v_idx;
         idx.normal_index = face.vertex_indices[k].vn_idx;
         idx.texcoord_index = face.vertex_indices[k].vt_idx;
-        shape->mesh.indices.push_back(idx);
+        mesh->indices.push_back(idx);
       }
 
-      shape->mesh.num_face_vertices.push_back(
+      mesh->num_face_vertices.push_back(
           static_cast<unsigned char>(npolys));
-      shape->mesh.material_ids.push_back(material_id);  // per face
-      shape->mesh.smoothing_group_ids.push_back(
+      mesh->material_ids.push_back(material_id);  // per face
+      mesh->smoothing_group_ids.push_back(
           face.smoothing_group_id);  // per face
     }
   }
+}
+
+// Face groups smaller than this are always exported on the calling thread.
+#define TINYOBJ_PARALLEL_EXPORT_FACES 65536
+
+static bool exportFaceGroupToShape(shape_t *shape,
+                                   const std::vector<face_t> &faceGroup,
+                                   const std::vector<tag_t> &tags,
+                                   const int material_id,
+                                   const std::string &name, bool triangulate,
+                                   const std::vector<real_t> &v,
+                                   int num_threads = 1) {
+  if (faceGroup.empty()) {
+    return false;
+  }
+
+  if (num_threads <= 1 || faceGroup.size() < TINYOBJ_PARALLEL_EXPORT_FACES) {
+    exportFaces(&shape->mesh, &faceGroup[0], faceGroup.size(), material_id,
+                triangulate, v);
+  } else {
+    // Triangulate contiguous face ranges in parallel, then append them in
+    // order so the result matches the single threaded export.
+    size_t n = static_cast<size_t>(num_threads);
+    std::vector<mesh_t> parts(n);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < n; t++) {
+      size_t begin = faceGroup.size() * t / n;
+      size_t end = faceGroup.size() * (t + 1) / n;
+      workers.push_back(std::thread([&, t, begin, end]() {
+        exportFaces(&parts[t], &faceGroup[0] + begin, end - begin,
+                    material_id, triangulate, v);
+      }));
+    }
+    for (size_t t = 0; t < n; t++) {
+      workers[t].join();
+    }
+
+    mesh_t &mesh = shape->mesh;
+    for (size_t t = 0; t < n; t++) {
+      mesh.indices.insert(mesh.indices.end(), parts[t].indices.begin(),
+                          parts[t].indices.end());
+      mesh.num_face_vertices.insert(mesh.num_face_vertices.end(),
+                                    parts[t].num_face_vertices.begin(),
+                                    parts[t].num_face_vertices.end());
+      mesh.material_ids.insert(mesh.material_ids.end(),
+                               parts[t].material_ids.begin(),
+                               parts[t].material_ids.end());
+      mesh.smoothing_group_ids.insert(mesh.smoothing_group_ids.end(),
+                                      parts[t].smoothing_group_ids.begin(),
+                                      parts[t].smoothing_group_ids.end());
+    }
+  }
 
   shape->name = name;
   shape->mesh.tags = tags;
@@ -1314,6 +1364,247 @@ bool MaterialStreamReader::operator()(const std::string &matId,
   return true;
 }
 
+// Parser state touched by the non geometry commands (usemtl, mtllib, g, o, t
+// and s). Shared by the serial LoadObj and the replay in LoadObjParallel so
+// both build shapes the same way.
+struct obj_state_t {
+  std::map<std::string, int> material_map;
+  int material;
+
+  // smoothing group id
+  unsigned int current_smoothing_id;  // 0 means no smoothing.
+
+  shape_t shape;
+  std::vector<face_t> faceGroup;
+  std::vector<tag_t> tags;
+  std::string name;
+
+  obj_state_t() : material(-1), current_smoothing_id(0) {}
+};
+
+// Applies one state command line to st. Returns false for lines that are not
+// state commands (they are ignored by the caller).
+static bool parseStateCommand(const char *token, obj_state_t *st,
+                              std::vector<shape_t> *shapes,
+                              std::vector<material_t> *materials,
+                              MaterialReader *readMatFn, bool triangulate,
+                              const std::vector<real_t> &v, std::string *err,
+                              int num_threads) {
+  // use mtl
+  if ((0 == strncmp(token, "usemtl", 6)) && IS_SPACE((token[6]))) {
+    token += 7;
+    std::stringstream ss;
+    ss << token;
+    std::string namebuf = ss.str();
+
+    int newMaterialId = -1;
+    if (st->material_map.find(namebuf) != st->material_map.end()) {
+      newMaterialId = st->material_map[namebuf];
+    } else {
+      // { error!! material not found }
+    }
+
+    if (newMaterialId != st->material) {
+      // Create per-face material. Thus we don't add `shape` to `shapes` at
+      // this time.
+      // just clear `faceGroup` after `exportFaceGroupToShape()` call.
+      exportFaceGroupToShape(&st->shape, st->faceGroup, st->tags, st->material,
+                             st->name, triangulate, v, num_threads);
+      st->faceGroup.clear();
+      st->material = newMaterialId;
+    }
+
+    return true;
+  }
+
+  // load mtl
+  if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) {
+    if (readMatFn) {
+      token += 7;
+
+      std::vector<std::string> filenames;
+      SplitString(std::string(token), ' ', filenames);
+
+      if (filenames.empty()) {
+        if (err) {
+          (*err) +=
+              "WARN: Looks like empty filename for mtllib. Use default "
+              "material. \n";
+        }
+      } else {
+        bool found = false;
+        for (size_t s = 0; s < filenames.size(); s++) {
+          std::string err_mtl;
+          bool ok = (*readMatFn)(filenames[s].c_str(), materials,
+                                 &st->material_map, &err_mtl);
+          if (err && (!err_mtl.empty())) {
+            (*err) += err_mtl;  // This should be warn message.
+          }
+
+          if (ok) {
+            found = true;
+            break;
+          }
+        }
+
+        if (!found) {
+          if (err) {
+            (*err) +=
+                "WARN: Failed to load material file(s). Use default "
+                "material.\n";
+          }
+        }
+      }
+    }
+
+    return true;
+  }
+
+  // group name
+  if (token[0] == 'g' && IS_SPACE((token[1]))) {
+    // flush previous face group.
+    bool ret = exportFaceGroupToShape(&st->shape, st->faceGroup, st->tags,
+                                      st->material, st->name, triangulate, v,
+                                      num_threads);
+    (void)ret;  // return value not used.
+
+    if (st->shape.mesh.indices.size() > 0) {
+      shapes->push_back(st->shape);
+    }
+
+    st->shape = shape_t();
+
+    // material = -1;
+    st->faceGroup.clear();
+
+    std::vector<std::string> names;
+    names.reserve(2);
+
+    while (!IS_NEW_LINE(token[0])) {
+      std::string str = parseString(&token);
+      names.push_back(str);
+      token += strspn(token, " \t\r");  // skip tag
+    }
+
+    assert(names.size() > 0);
+
+    // names[0] must be 'g', so skip the 0th element.
+    if (names.size() > 1) {
+      st->name = names[1];
+    } else {
+      st->name = "";
+    }
+
+    return true;
+  }
+
+  // object name
+  if (token[0] == 'o' && IS_SPACE((token[1]))) {
+    // flush previous face group.
+    bool ret = exportFaceGroupToShape(&st->shape, st->faceGroup, st->tags,
+                                      st->material, st->name, triangulate, v,
+                                      num_threads);
+    if (ret) {
+      shapes->push_back(st->shape);
+    }
+
+    // material = -1;
+    st->faceGroup.clear();
+    st->shape = shape_t();
+
+    // @todo { multiple object name? }
+    token += 2;
+    std::stringstream ss;
+    ss << token;
+    st->name = ss.str();
+
+    return true;
+  }
+
+  if (token[0] == 't' && IS_SPACE(token[1])) {
+    tag_t tag;
+
+    token += 2;
+
+    tag.name = parseString(&token);
+
+    tag_sizes ts = parseTagTriple(&token);
+
+    tag.intValues.resize(static_cast<size_t>(ts.num_ints));
+
+    for (size_t i = 0; i < static_cast<size_t>(ts.num_ints); ++i) {
+      tag.intValues[i] = parseInt(&token);
+    }
+
+    tag.floatValues.resize(static_cast<size_t>(ts.num_reals));
+    for (size_t i = 0; i < static_cast<size_t>(ts.num_reals); ++i) {
+      tag.floatValues[i] = parseReal(&token);
+    }
+
+    tag.stringValues.resize(static_cast<size_t>(ts.num_strings));
+    for (size_t i = 0; i < static_cast<size_t>(ts.num_strings); ++i) {
+      tag.stringValues[i] = parseString(&token);
+    }
+
+    st->tags.push_back(tag);
+
+    return true;
+  }
+
+  if (token[0] == 's' && IS_SPACE(token[1])) {
+    // smoothing group id
+    token += 2;
+
+    // skip space.
+    token += strspn(token, " \t");  // skip space
+
+    if (token[0] == '\0') {
+      return true;
+    }
+
+    if (token[0] == '\r' || token[1] == '\n') {
+      return true;
+    }
+
+    if (strlen(token) >= 3) {
+      if (token[0] == 'o' && token[1] == 'f' && token[2] == 'f') {
+        st->current_smoothing_id = 0;
+      }
+    } else {
+      // assume number
+      int smGroupId = parseInt(&token);
+      if (smGroupId < 0) {
+        // parse error. force set to 0.
+        // FIXME(syoyo): Report warning.
+        st->current_smoothing_id = 0;
+      } else {
+        st->current_smoothing_id = static_cast<unsigned int>(smGroupId);
+      }
+    }
+
+    return true;
+  }  // smoothing group id
+
+  return false;
+}
+
+// Flushes the last face group once the whole file has been read.
+static void finishState(obj_state_t *st, std::vector<shape_t> *shapes,
+                        bool triangulate, const std::vector<real_t> &v,
+                        int num_threads) {
+  bool ret = exportFaceGroupToShape(&st->shape, st->faceGroup, st->tags,
+                                    st->material, st->name, triangulate, v,
+                                    num_threads);
+  // exportFaceGroupToShape return false when `usemtl` is called in the last
+  // line.
+  // we also add `shape` to `shapes` when `shape.mesh` has already some
+  // faces(indices)
+  if (ret || st->shape.mesh.indices.size()) {
+    shapes->push_back(st->shape);
+  }
+  st->faceGroup.clear();  // for safety
+}
+
 bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
              std::vector<material_t> *materials, std::string *err,
              const char *filename, const char *mtl_basedir, bool trianglulate) {
@@ -1354,19 +1645,8 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
   std::vector<real_t> vn;
   std::vector<real_t> vt;
   std::vector<real_t> vc;
-  std::vector<tag_t> tags;
-  std::vector<face_t> faceGroup;
-  std::string name;
 
-  // material
-  std::map<std::string, int> material_map;
-  int material = -1;
-
-  // smoothing group id
-  unsigned int current_smoothing_id =
-      0;  // Initial value. 0 means no smoothing.
-
-  shape_t shape;
+  obj_state_t st;
 
   std::string linebuf;
   while (inStream->peek() != -1) {
@@ -1440,7 +1720,7 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
 
       face_t face;
 
-      face.smoothing_group_id = current_smoothing_id;
+      face.smoothing_group_id = st.current_smoothing_id;
       face.vertex_indices.reserve(3);
 
       while (!IS_NEW_LINE(token[0])) {
@@ -1460,217 +1740,402 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
       }
 
       // replace with emplace_back + std::move on C++11
-      faceGroup.push_back(face);
+      st.faceGroup.push_back(face);
 
       continue;
     }
 
-    // use mtl
-    if ((0 == strncmp(token, "usemtl", 6)) && IS_SPACE((token[6]))) {
-      token += 7;
-      std::stringstream ss;
-      ss << token;
-      std::string namebuf = ss.str();
+    // usemtl, mtllib, g, o, t, s
+    if (parseStateCommand(token, &st, shapes, materials, readMatFn,
+                          triangulate, v, err, 1)) {
+      continue;
+    }
 
-      int newMaterialId = -1;
-      if (material_map.find(namebuf) != material_map.end()) {
-        newMaterialId = material_map[namebuf];
-      } else {
-        // { error!! material not found }
-      }
+    // Ignore unknown command.
+  }
 
-      if (newMaterialId != material) {
-        // Create per-face material. Thus we don't add `shape` to `shapes` at
-        // this time.
-        // just clear `faceGroup` after `exportFaceGroupToShape()` call.
-        exportFaceGroupToShape(&shape, faceGroup, tags, material, name,
-                               triangulate, v);
-        faceGroup.clear();
-        material = newMaterialId;
-      }
+  finishState(&st, shapes, triangulate, v, 1);
 
-      continue;
-    }
+  if (err) {
+    (*err) += errss.str();
+  }
 
-    // load mtl
-    if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) {
-      if (readMatFn) {
-        token += 7;
+  attrib->vertices.swap(v);
+  attrib->normals.swap(vn);
+  attrib->texcoords.swap(vt);
+  attrib->colors.swap(vc);
 
-        std::vector<std::string> filenames;
-        SplitString(std::string(token), ' ', filenames);
+  return true;
+}
 
-        if (filenames.empty()) {
-          if (err) {
-            (*err) +=
-                "WARN: Looks like empty filename for mtllib. Use default "
-                "material. \n";
-          }
-        } else {
-          bool found = false;
-          for (size_t s = 0; s < filenames.size(); s++) {
-            std::string err_mtl;
-            bool ok = (*readMatFn)(filenames[s].c_str(), materials,
-                                   &material_map, &err_mtl);
-            if (err && (!err_mtl.empty())) {
-              (*err) += err_mtl;  // This should be warn message.
-            }
+// Chunks smaller than this are not worth a thread in LoadObjParallel.
+#define TINYOBJ_PARALLEL_MIN_CHUNK (1024 * 1024)
 
-            if (ok) {
-              found = true;
-              break;
-            }
-          }
+// Parse triples without resolving them against the vertex counts: i, i/j/k,
+// i//k, i/j. Missing components stay 0 (an invalid OBJ index), and like
+// parseTriple an explicit 0 index fails.
+static bool parseDeferredTriple(const char **token, vertex_index_t *ret) {
+  vertex_index_t vi(0);
 
-          if (!found) {
-            if (err) {
-              (*err) +=
-                  "WARN: Failed to load material file(s). Use default "
-                  "material.\n";
-            }
-          }
-        }
-      }
+  vi.v_idx = atoi((*token));
+  if (vi.v_idx == 0) {
+    return false;
+  }
 
-      continue;
+  (*token) += strcspn((*token), "/ \t\r");
+  if ((*token)[0] != '/') {
+    (*ret) = vi;
+    return true;
+  }
+  (*token)++;
+
+  // i//k
+  if ((*token)[0] == '/') {
+    (*token)++;
+    vi.vn_idx = atoi((*token));
+    if (vi.vn_idx == 0) {
+      return false;
     }
+    (*token) += strcspn((*token), "/ \t\r");
+    (*ret) = vi;
+    return true;
+  }
 
-    // group name
-    if (token[0] == 'g' && IS_SPACE((token[1]))) {
-      // flush previous face group.
-      bool ret = exportFaceGroupToShape(&shape, faceGroup, tags, material, name,
-                                        triangulate, v);
-      (void)ret;  // return value not used.
+  // i/j/k or i/j
+  vi.vt_idx = atoi((*token));
+  if (vi.vt_idx == 0) {
+    return false;
+  }
 
-      if (shape.mesh.indices.size() > 0) {
-        shapes->push_back(shape);
-      }
+  (*token) += strcspn((*token), "/ \t\r");
+  if ((*token)[0] != '/') {
+    (*ret) = vi;
+    return true;
+  }
+
+  // i/j/k
+  (*token)++;  // skip '/'
+  vi.vn_idx = atoi((*token));
+  if (vi.vn_idx == 0) {
+    return false;
+  }
+  (*token) += strcspn((*token), "/ \t\r");
 
-      shape = shape_t();
+  (*ret) = vi;
+  return true;
+}
 
-      // material = -1;
-      faceGroup.clear();
+enum obj_record_type_t {
+  OBJ_RECORD_FACES,    // run of faces [begin, end) in obj_chunk_t::faces
+  OBJ_RECORD_COMMAND,  // state command line [begin, end) in the file
+  OBJ_RECORD_ERROR     // bad `f' line, parsing of the chunk stopped here
+};
 
-      std::vector<std::string> names;
-      names.reserve(2);
+struct obj_record_t {
+  obj_record_type_t type;
+  size_t begin;
+  size_t end;
+};
 
-      while (!IS_NEW_LINE(token[0])) {
-        std::string str = parseString(&token);
-        names.push_back(str);
-        token += strspn(token, " \t\r");  // skip tag
-      }
+// Everything one thread read from its slice of the file.
+struct obj_chunk_t {
+  std::vector<real_t> v;
+  std::vector<real_t> vn;
+  std::vector<real_t> vt;
+  std::vector<real_t> vc;
+  std::vector<face_t> faces;
+  // chunk local v/vn/vt counts when each face was read (3 per face), what
+  // fixIndex needs to resolve negative indices once the chunk offsets are known
+  std::vector<int> face_counts;
+  std::vector<obj_record_t> records;
+};
 
-      assert(names.size() > 0);
+// Pass 1: parses the lines in data[begin, end). Geometry goes into chunk, all
+// other lines are recorded in file order for the serial replay.
+static void parseObjChunk(const char *data, size_t begin, size_t end,
+                          obj_chunk_t *chunk) {
+  std::string linebuf;
+  size_t p = begin;
 
-      // names[0] must be 'g', so skip the 0th element.
-      if (names.size() > 1) {
-        name = names[1];
-      } else {
-        name = "";
-      }
+  while (p < end) {
+    // '\r', '\n' and "\r\n" all end a line; the empty lines between them are
+    // skipped anyway, just like safeGetline + the empty line check.
+    size_t line_begin = p;
+    while (p < end && data[p] != '\n' && data[p] != '\r') p++;
+    size_t line_end = p;
+    p++;
 
-      continue;
-    }
+    if (line_end == line_begin) continue;
 
-    // object name
-    if (token[0] == 'o' && IS_SPACE((token[1]))) {
-      // flush previous face group.
-      bool ret = exportFaceGroupToShape(&shape, faceGroup, tags, material, name,
-                                        triangulate, v);
-      if (ret) {
-        shapes->push_back(shape);
-      }
+    linebuf.assign(data + line_begin, line_end - line_begin);
+
+    // Skip leading space.
+    const char *token = linebuf.c_str();
+    token += strspn(token, " \t");
 
-      // material = -1;
-      faceGroup.clear();
-      shape = shape_t();
+    if (token[0] == '\0') continue;  // empty line
 
-      // @todo { multiple object name? }
+    if (token[0] == '#') continue;  // comment line
+
+    // vertex
+    if (token[0] == 'v' && IS_SPACE((token[1]))) {
       token += 2;
-      std::stringstream ss;
-      ss << token;
-      name = ss.str();
+      real_t x, y, z;
+      real_t r, g, b;
+      parseVertexWithColor(&x, &y, &z, &r, &g, &b, &token);
+      chunk->v.push_back(x);
+      chunk->v.push_back(y);
+      chunk->v.push_back(z);
 
+      chunk->vc.push_back(r);
+      chunk->vc.push_back(g);
+      chunk->vc.push_back(b);
       continue;
     }
 
-    if (token[0] == 't' && IS_SPACE(token[1])) {
-      tag_t tag;
+    // normal
+    if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
+      token += 3;
+      real_t x, y, z;
+      parseReal3(&x, &y, &z, &token);
+      chunk->vn.push_back(x);
+      chunk->vn.push_back(y);
+      chunk->vn.push_back(z);
+      continue;
+    }
 
-      token += 2;
+    // texcoord
+    if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
+      token += 3;
+      real_t x, y;
+      parseReal2(&x, &y, &token);
+      chunk->vt.push_back(x);
+      chunk->vt.push_back(y);
+      continue;
+    }
 
-      tag.name = parseString(&token);
+    // face
+    if (token[0] == 'f' && IS_SPACE((token[1]))) {
+      token += 2;
+      token += strspn(token, " \t");
 
-      tag_sizes ts = parseTagTriple(&token);
+      face_t face;
+      face.vertex_indices.reserve(3);
 
-      tag.intValues.resize(static_cast<size_t>(ts.num_ints));
+      while (!IS_NEW_LINE(token[0])) {
+        vertex_index_t vi;
+        if (!parseDeferredTriple(&token, &vi)) {
+          obj_record_t rec = {OBJ_RECORD_ERROR, line_begin, line_end};
+          chunk->records.push_back(rec);
+          return;
+        }
 
-      for (size_t i = 0; i < static_cast<size_t>(ts.num_ints); ++i) {
-        tag.intValues[i] = parseInt(&token);
+        face.vertex_indices.push_back(vi);
+        size_t n = strspn(token, " \t\r");
+        token += n;
       }
 
-      tag.floatValues.resize(static_cast<size_t>(ts.num_reals));
-      for (size_t i = 0; i < static_cast<size_t>(ts.num_reals); ++i) {
-        tag.floatValues[i] = parseReal(&token);
-      }
+      chunk->face_counts.push_back(static_cast<int>(chunk->v.size() / 3));
+      chunk->face_counts.push_back(static_cast<int>(chunk->vn.size() / 3));
+      chunk->face_counts.push_back(static_cast<int>(chunk->vt.size() / 2));
+      chunk->faces.push_back(std::move(face));
 
-      tag.stringValues.resize(static_cast<size_t>(ts.num_strings));
-      for (size_t i = 0; i < static_cast<size_t>(ts.num_strings); ++i) {
-        tag.stringValues[i] = parseString(&token);
+      // extend the current run of faces or start a new one
+      size_t face_id = chunk->faces.size() - 1;
+      if (!chunk->records.empty() &&
+          chunk->records.back().type == OBJ_RECORD_FACES) {
+        chunk->records.back().end = face_id + 1;
+      } else {
+        obj_record_t rec = {OBJ_RECORD_FACES, face_id, face_id + 1};
+        chunk->records.push_back(rec);
       }
 
-      tags.push_back(tag);
-
       continue;
     }
 
-    if (token[0] == 's' && IS_SPACE(token[1])) {
-      // smoothing group id
-      token += 2;
+    // usemtl, mtllib, g, o, t, s (or unknown) : replayed in order later
+    obj_record_t rec = {OBJ_RECORD_COMMAND, line_begin, line_end};
+    chunk->records.push_back(rec);
+  }
+}
 
-      // skip space.
-      token += strspn(token, " \t");  // skip space
+// Pass 2: copies the chunk geometry to its place in the merged arrays and
+// resolves its face indices exactly like parseTriple would have serially.
+static void mergeObjChunk(obj_chunk_t *chunk, size_t v_offset,
+                          size_t vn_offset, size_t vt_offset,
+                          std::vector<real_t> *v, std::vector<real_t> *vn,
+                          std::vector<real_t> *vt, std::vector<real_t> *vc) {
+  std::copy(chunk->v.begin(), chunk->v.end(), v->begin() + v_offset * 3);
+  std::copy(chunk->vc.begin(), chunk->vc.end(), vc->begin() + v_offset * 3);
+  std::copy(chunk->vn.begin(), chunk->vn.end(), vn->begin() + vn_offset * 3);
+  std::copy(chunk->vt.begin(), chunk->vt.end(), vt->begin() + vt_offset * 2);
+
+  for (size_t f = 0; f < chunk->faces.size(); f++) {
+    int vsize = static_cast<int>(v_offset) + chunk->face_counts[f * 3 + 0];
+    int vnsize = static_cast<int>(vn_offset) + chunk->face_counts[f * 3 + 1];
+    int vtsize = static_cast<int>(vt_offset) + chunk->face_counts[f * 3 + 2];
+
+    std::vector<vertex_index_t> &indices = chunk->faces[f].vertex_indices;
+    for (size_t k = 0; k < indices.size(); k++) {
+      vertex_index_t raw = indices[k];
+      vertex_index_t vi(-1);
+      fixIndex(raw.v_idx, vsize, &vi.v_idx);
+      if (raw.vt_idx != 0) fixIndex(raw.vt_idx, vtsize, &vi.vt_idx);
+      if (raw.vn_idx != 0) fixIndex(raw.vn_idx, vnsize, &vi.vn_idx);
+      indices[k] = vi;
+    }
+  }
 
-      if (token[0] == '\0') {
-        continue;
-      }
+  // the merged arrays own the geometry now
+  std::vector<real_t>().swap(chunk->v);
+  std::vector<real_t>().swap(chunk->vn);
+  std::vector<real_t>().swap(chunk->vt);
+  std::vector<real_t>().swap(chunk->vc);
+}
 
-      if (token[0] == '\r' || token[1] == '\n') {
+bool LoadObjParallel(attrib_t *attrib, std::vector<shape_t> *shapes,
+                     std::vector<material_t> *materials, std::string *err,
+                     const char *filename, const char *mtl_basedir,
+                     bool triangulate, int num_threads) {
+  attrib->vertices.clear();
+  attrib->normals.clear();
+  attrib->texcoords.clear();
+  attrib->colors.clear();
+  shapes->clear();
+
+  std::stringstream errss;
+
+  MappedFile file;
+  if (!file.open(filename)) {
+    // an empty file can't be mapped, the stream loader handles that case
+    std::ifstream ifs(filename);
+    if (ifs) {
+      return LoadObj(attrib, shapes, materials, err, filename, mtl_basedir,
+                     triangulate);
+    }
+
+    errss << "Cannot open file [" << filename << "]" << std::endl;
+    if (err) {
+      (*err) = errss.str();
+    }
+    return false;
+  }
+
+  std::string baseDir;
+  if (mtl_basedir) {
+    baseDir = mtl_basedir;
+  }
+  MaterialFileReader matFileReader(baseDir);
+
+  const char *data = file.getData();
+  size_t size = file.getSize();
+
+  if (num_threads <= 0) {
+    num_threads = static_cast<int>(std::thread::hardware_concurrency());
+  }
+  if (num_threads <= 0) {
+    num_threads = 1;
+  }
+  size_t max_useful = size / TINYOBJ_PARALLEL_MIN_CHUNK + 1;
+  if (static_cast<size_t>(num_threads) > max_useful) {
+    num_threads = static_cast<int>(max_useful);
+  }
+  size_t n = static_cast<size_t>(num_threads);
+
+  // Split at line boundaries: every chunk starts right after a '\n'.
+  std::vector<size_t> bounds(n + 1);
+  bounds[0] = 0;
+  bounds[n] = size;
+  for (size_t t = 1; t < n; t++) {
+    size_t b = size * t / n;
+    if (b < bounds[t - 1]) b = bounds[t - 1];
+    while (b < size && data[b - 1] != '\n') b++;
+    bounds[t] = b;
+  }
+
+  // Pass 1: parse every chunk.
+  std::vector<obj_chunk_t> chunks(n);
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < n; t++) {
+    workers.push_back(std::thread([&, t]() {
+      parseObjChunk(data, bounds[t], bounds[t + 1], &chunks[t]);
+    }));
+  }
+  for (size_t t = 0; t < n; t++) {
+    workers[t].join();
+  }
+  workers.clear();
+
+  // Chunk offsets into the merged attribute arrays. A chunk that hit a bad
+  // `f' line stopped early, and nothing after it is used.
+  std::vector<size_t> v_offsets(n), vn_offsets(n), vt_offsets(n);
+  size_t num_v = 0, num_vn = 0, num_vt = 0;
+  size_t used = n;
+  for (size_t t = 0; t < n; t++) {
+    v_offsets[t] = num_v;
+    vn_offsets[t] = num_vn;
+    vt_offsets[t] = num_vt;
+    num_v += chunks[t].v.size() / 3;
+    num_vn += chunks[t].vn.size() / 3;
+    num_vt += chunks[t].vt.size() / 2;
+
+    if (!chunks[t].records.empty() &&
+        chunks[t].records.back().type == OBJ_RECORD_ERROR) {
+      used = t + 1;
+      break;
+    }
+  }
+
+  // Pass 2: merge geometry and fix up relative indices in parallel.
+  std::vector<real_t> v(num_v * 3);
+  std::vector<real_t> vn(num_vn * 3);
+  std::vector<real_t> vt(num_vt * 2);
+  std::vector<real_t> vc(num_v * 3);
+  for (size_t t = 0; t < used; t++) {
+    workers.push_back(std::thread([&, t]() {
+      mergeObjChunk(&chunks[t], v_offsets[t], vn_offsets[t], vt_offsets[t],
+                    &v, &vn, &vt, &vc);
+    }));
+  }
+  for (size_t t = 0; t < workers.size(); t++) {
+    workers[t].join();
+  }
+  workers.clear();
+
+  // Replay faces and state commands in file order on this thread.
+  obj_state_t st;
+  std::string linebuf;
+  for (size_t t = 0; t < used; t++) {
+    obj_chunk_t &chunk = chunks[t];
+    for (size_t r = 0; r < chunk.records.size(); r++) {
+      const obj_record_t &rec = chunk.records[r];
+
+      if (rec.type == OBJ_RECORD_FACES) {
+        for (size_t f = rec.begin; f < rec.end; f++) {
+          chunk.faces[f].smoothing_group_id = st.current_smoothing_id;
+          st.faceGroup.push_back(std::move(chunk.faces[f]));
+        }
         continue;
       }
 
-      if (strlen(token) >= 3) {
-        if (token[0] == 'o' && token[1] == 'f' && token[2] == 'f') {
-          current_smoothing_id = 0;
-        }
-      } else {
-        // assume number
-        int smGroupId = parseInt(&token);
-        if (smGroupId < 0) {
-          // parse error. force set to 0.
-          // FIXME(syoyo): Report warning.
-          current_smoothing_id = 0;
-        } else {
-          current_smoothing_id = static_cast<unsigned int>(smGroupId);
+      if (rec.type == OBJ_RECORD_ERROR) {
+        if (err) {
+          (*err) = "Failed parse `f' line(e.g. zero value for face index).\n";
         }
+        return false;
       }
 
-      continue;
-    }  // smoothing group id
+      linebuf.assign(data + rec.begin, rec.end - rec.begin);
+      const char *token = linebuf.c_str();
+      token += strspn(token, " \t");
+      parseStateCommand(token, &st, shapes, materials, &matFileReader,
+                        triangulate, v, err, num_threads);
+    }
 
-    // Ignore unknown command.
+    std::vector<face_t>().swap(chunk.faces);
   }
 
-  bool ret = exportFaceGroupToShape(&shape, faceGroup, tags, material, name,
-                                    triangulate, v);
-  // exportFaceGroupToShape return false when `usemtl` is called in the last
-  // line.
-  // we also add `shape` to `shapes` when `shape.mesh` has already some
-  // faces(indices)
-  if (ret || shape.mesh.indices.size()) {
-    shapes->push_back(shape);
-  }
-  faceGroup.clear();  // for safety
+  finishState(&st, shapes, triangulate, v, num_threads);
 
   if (err) {
     (*err) += errss.str();